@@ -0,0 +1,373 @@
+/**
+ * @file BatchDecoder.h
+ * @brief This file contains the BatchDecoder class which decodes whole buffers
+ * of `!a,b,c;` frames at once. It is meant for hosts that have a lot of
+ * traffic to get through, on x86 it classifies 16 (SSE2) or 32 (AVX2) bytes at
+ * a time and everywhere else it falls back to a scalar loop.
+ * @version 1.0.0
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "FrameParser.h"
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  typename DIALECT = MESSAGE_INTF::AsciiProtocol>
+class BatchDecoder
+{
+  static_assert(
+    DIALECT::startMarker != '\0',
+    "BatchDecoder needs a dialect with a start marker");
+
+public:
+  /**
+   * @brief Decodes every complete frame in buffer. The results are exactly the
+   * same as feeding buffer through a Message object.
+   * @param buffer the bytes to decode
+   * @param length the number of bytes in buffer
+   * @param onFrame called for every frame as
+   * onFrame(const int32_t *args, uint32_t populatedArgs, bool argOverflow)
+   * @return the number of bytes consumed. If the buffer ends in the middle of a
+   * frame this points at that frame's startMarker and the caller should pass
+   * the rest in again once more data has arrived.
+   */
+  template <typename FRAME_HANDLER>
+  uint32_t Decode(const char *buffer, uint32_t length, FRAME_HANDLER &&onFrame);
+
+private:
+#if defined(__AVX2__)
+  static constexpr uint32_t BLOCK_SIZE = 32;
+#else
+  static constexpr uint32_t BLOCK_SIZE = 16;
+#endif
+  // enough blocks to hold the delimiters of a frame that fits in the buffer
+  static constexpr uint32_t MAX_BLOCKS = SERIAL_BUFFER_SIZE / BLOCK_SIZE + 1;
+
+  /**
+   * @brief One bit per byte of a block describing what that byte is
+   */
+  struct BlockMasks
+  {
+    uint32_t end;       // the endMarker
+    uint32_t delimiter; // the delimiter between args
+    uint32_t minus;     // a minus sign
+    uint32_t invalid;   // anything that isn't a digit, minus or marker
+  };
+
+  /**
+   * @brief Classifies count bytes starting at block, count may only be less
+   * than BLOCK_SIZE at the very end of the buffer
+   */
+  static BlockMasks classify(const char *block, uint32_t count);
+
+  /**
+   * @brief Turns a run of at most 8 digits into its value
+   */
+  static uint32_t parseDigits(const char *digits, uint32_t count, bool canLoad8);
+
+  /**
+   * @brief Decodes the args of a frame whose delimiters have been found.
+   * @return false if a token needs the full atoi() rules
+   */
+  bool decodeArgs(
+    const char *body,
+    uint32_t bodyLength,
+    const char *bufferEnd,
+    uint32_t blockCount);
+
+  std::array<uint32_t, MAX_BLOCKS> delimiters; // delimiter masks per block
+  std::array<int32_t, MAX_ARGS> args;
+  uint32_t populatedArgs{0};
+  bool argOverflow{false};
+  FrameParser<SERIAL_BUFFER_SIZE, MAX_ARGS, DIALECT>
+    fallback; // handles frames that aren't plain delimited integers
+};
+
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, typename DIALECT>
+typename BatchDecoder<SERIAL_BUFFER_SIZE, MAX_ARGS, DIALECT>::BlockMasks
+BatchDecoder<SERIAL_BUFFER_SIZE, MAX_ARGS, DIALECT>::classify(
+  const char *block,
+  uint32_t count)
+{
+  BlockMasks masks{0, 0, 0, 0};
+#if defined(__AVX2__)
+  if (count == BLOCK_SIZE)
+  {
+    __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block));
+    __m256i end =
+      _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(DIALECT::endMarker));
+    __m256i delimiter =
+      _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(DIALECT::delimiter));
+    __m256i minus = _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8('-'));
+    __m256i digit = _mm256_sub_epi8(bytes, _mm256_set1_epi8('0'));
+    digit = _mm256_cmpeq_epi8(
+      _mm256_min_epu8(digit, _mm256_set1_epi8(9)), digit);
+    __m256i valid = _mm256_or_si256(
+      _mm256_or_si256(end, delimiter), _mm256_or_si256(minus, digit));
+    masks.end = static_cast<uint32_t>(_mm256_movemask_epi8(end));
+    masks.delimiter = static_cast<uint32_t>(_mm256_movemask_epi8(delimiter));
+    masks.minus = static_cast<uint32_t>(_mm256_movemask_epi8(minus));
+    masks.invalid = ~static_cast<uint32_t>(_mm256_movemask_epi8(valid));
+    return masks;
+  }
+#elif defined(__SSE2__)
+  if (count == BLOCK_SIZE)
+  {
+    __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block));
+    __m128i end = _mm_cmpeq_epi8(bytes, _mm_set1_epi8(DIALECT::endMarker));
+    __m128i delimiter =
+      _mm_cmpeq_epi8(bytes, _mm_set1_epi8(DIALECT::delimiter));
+    __m128i minus = _mm_cmpeq_epi8(bytes, _mm_set1_epi8('-'));
+    __m128i digit = _mm_sub_epi8(bytes, _mm_set1_epi8('0'));
+    digit = _mm_cmpeq_epi8(_mm_min_epu8(digit, _mm_set1_epi8(9)), digit);
+    __m128i valid =
+      _mm_or_si128(_mm_or_si128(end, delimiter), _mm_or_si128(minus, digit));
+    masks.end = static_cast<uint32_t>(_mm_movemask_epi8(end));
+    masks.delimiter = static_cast<uint32_t>(_mm_movemask_epi8(delimiter));
+    masks.minus = static_cast<uint32_t>(_mm_movemask_epi8(minus));
+    masks.invalid = ~static_cast<uint32_t>(_mm_movemask_epi8(valid)) & 0xFFFF;
+    return masks;
+  }
+#endif
+  for (uint32_t i = 0; i < count; i++)
+  {
+    char c = block[i];
+    uint32_t bit = 1u << i;
+    if (c == DIALECT::endMarker)
+    {
+      masks.end |= bit;
+    }
+    else if (c == DIALECT::delimiter)
+    {
+      masks.delimiter |= bit;
+    }
+    else if (c == '-')
+    {
+      masks.minus |= bit;
+    }
+    else if (c < '0' || c > '9')
+    {
+      masks.invalid |= bit;
+    }
+  }
+  return masks;
+}
+
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, typename DIALECT>
+uint32_t BatchDecoder<SERIAL_BUFFER_SIZE, MAX_ARGS, DIALECT>::parseDigits(
+  const char *digits,
+  uint32_t count,
+  bool canLoad8)
+{
+  // SWAR: line the digits up against the top of a 64 bit word so the unused
+  // low bytes read as leading zeros, then combine pairs, quads and octets.
+  // The first digit has to end up in the lowest byte that is used.
+  uint64_t word = 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  memcpy(&word, digits, canLoad8 ? 8 : count);
+  word <<= 8 * (8 - count);
+#else
+  (void)canLoad8;
+  for (uint32_t i = 0; i < count; i++)
+  {
+    word |= static_cast<uint64_t>(static_cast<uint8_t>(digits[i]))
+            << (8 * (8 - count + i));
+  }
+#endif
+  word = ((word & 0x0F0F0F0F0F0F0F0FULL) * 2561) >> 8;
+  word = ((word & 0x00FF00FF00FF00FFULL) * 6553601) >> 16;
+  return static_cast<uint32_t>(
+    ((word & 0x0000FFFF0000FFFFULL) * 42949672960001ULL) >> 32);
+}
+
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, typename DIALECT>
+bool BatchDecoder<SERIAL_BUFFER_SIZE, MAX_ARGS, DIALECT>::decodeArgs(
+  const char *body,
+  uint32_t bodyLength,
+  const char *bufferEnd,
+  uint32_t blockCount)
+{
+  populatedArgs = 0;
+  argOverflow = false;
+  uint32_t tokenStart = 0;
+  for (uint32_t block = 0; block <= blockCount; block++)
+  {
+    uint32_t mask = block < blockCount ? delimiters[block] : 0;
+    // the last pass handles the token that runs up to the endMarker
+    bool last = block == blockCount;
+    while (mask != 0 || last)
+    {
+      uint32_t tokenEnd = bodyLength;
+      if (!last)
+      {
+        tokenEnd = block * BLOCK_SIZE + __builtin_ctz(mask);
+        mask &= mask - 1;
+      }
+
+      uint32_t tokenLength = tokenEnd - tokenStart;
+      // empty tokens don't produce an arg, just like strtok()
+      if (tokenLength > 0)
+      {
+        const char *token = body + tokenStart;
+        bool negative = token[0] == '-';
+        uint32_t digitCount = tokenLength - (negative ? 1 : 0);
+        if (digitCount == 0 || digitCount > 10)
+        {
+          return false;
+        }
+        if (populatedArgs < MAX_ARGS)
+        {
+          const char *digits = token + (negative ? 1 : 0);
+          uint32_t value;
+          if (digitCount <= 8)
+          {
+            value = parseDigits(digits, digitCount, bufferEnd - digits >= 8);
+          }
+          else
+          {
+            // 9 or 10 digits may not fit, clamp them the way FrameParser does
+            uint32_t high = digitCount - 8;
+            uint64_t wide =
+              static_cast<uint64_t>(
+                parseDigits(digits, high, bufferEnd - digits >= 8)) *
+                100000000u +
+              parseDigits(digits + high, 8, true);
+            uint32_t limit = negative ? 0x80000000u : 0x7FFFFFFFu;
+            value = wide > limit ? limit : static_cast<uint32_t>(wide);
+          }
+          args[populatedArgs] =
+            static_cast<int32_t>(negative ? 0u - value : value);
+          populatedArgs++;
+        }
+        else
+        {
+          argOverflow = true;
+        }
+      }
+      tokenStart = tokenEnd + 1;
+
+      if (last)
+      {
+        break;
+      }
+    }
+  }
+  return true;
+}
+
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, typename DIALECT>
+template <typename FRAME_HANDLER>
+uint32_t BatchDecoder<SERIAL_BUFFER_SIZE, MAX_ARGS, DIALECT>::Decode(
+  const char *buffer,
+  uint32_t length,
+  FRAME_HANDLER &&onFrame)
+{
+  const char *bufferEnd = buffer + length;
+  const char *position = buffer;
+  while (position < bufferEnd)
+  {
+    const char *start = static_cast<const char *>(
+      memchr(position, DIALECT::startMarker, bufferEnd - position));
+    if (start == nullptr)
+    {
+      return length;
+    }
+
+    // find the endMarker a block at a time, recording the delimiters and
+    // whether the frame is anything other than plain integers on the way
+    const char *body = start + 1;
+    uint32_t offset = 0;
+    uint32_t blockCount = 0;
+    uint32_t minusAllowed = 1; // a minus may only start a token
+    bool plain = true;
+    bool found = false;
+    while (body + offset < bufferEnd)
+    {
+      uint32_t count = bufferEnd - (body + offset);
+      if (count > BLOCK_SIZE)
+      {
+        count = BLOCK_SIZE;
+      }
+      BlockMasks masks = classify(body + offset, count);
+      uint32_t limit = count == 32 ? 0xFFFFFFFFu : (1u << count) - 1;
+      if (masks.end != 0)
+      {
+        uint32_t endBit = __builtin_ctz(masks.end);
+        limit = (1u << endBit) - 1;
+        offset += endBit;
+        found = true;
+      }
+      else
+      {
+        offset += count;
+      }
+
+      minusAllowed |= masks.delimiter << 1;
+      if (((masks.invalid | (masks.minus & ~minusAllowed)) & limit) != 0)
+      {
+        plain = false;
+      }
+      minusAllowed = (masks.delimiter >> (BLOCK_SIZE - 1)) & 1;
+
+      if (blockCount < MAX_BLOCKS)
+      {
+        delimiters[blockCount] = masks.delimiter & limit;
+        blockCount++;
+      }
+      else
+      {
+        plain = false;
+      }
+
+      if (found)
+      {
+        break;
+      }
+    }
+
+    if (!found)
+    {
+      // the frame hasn't finished arriving yet
+      return start - buffer;
+    }
+
+    const char *end = body + offset;
+    position = end + 1;
+    // a checksummed frame always goes to the parser, even one that looks
+    // plain because noise turned its checksum into digits
+    if (
+      !DIALECT::checksum && plain && offset < SERIAL_BUFFER_SIZE &&
+      decodeArgs(body, offset, bufferEnd, blockCount))
+    {
+      onFrame(
+        static_cast<const int32_t *>(args.data()), populatedArgs, argOverflow);
+      continue;
+    }
+
+    // whitespace, '+', truncation, long numbers, checksums... let the parser
+    // apply the full rules to this one frame
+    fallback.Reset();
+    fallback.Parse(start, position - start);
+    // a checksummed frame that failed its checks doesn't complete
+    if (fallback.IsFrameComplete())
+    {
+      onFrame(
+        fallback.GetArgs(),
+        fallback.GetPopulatedArgs(),
+        fallback.HasArgOverflow());
+    }
+  }
+  return length;
+}
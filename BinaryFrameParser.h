@@ -0,0 +1,457 @@
+/**
+ * @file BinaryFrameParser.h
+ * @brief This file contains the compact binary wire format. Each frame is a
+ * list of zigzag varint args followed by a CRC16, COBS encoded and terminated
+ * with a zero byte. It decodes into the same args as the ASCII format so the
+ * rest of the Message class doesn't care which one is on the wire.
+ * @version 1.0.0
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "MESSAGE-INTF.h"
+
+namespace MESSAGE_BINARY
+{
+// the byte that ends every COBS encoded frame
+constexpr uint8_t FRAME_DELIMITER = 0x00;
+// the most bytes a 32 bit varint can take
+constexpr uint32_t MAX_VARINT_SIZE = 5;
+// the number of CRC bytes at the end of every payload
+constexpr uint32_t CRC_SIZE = 2;
+
+/**
+ * @brief Maps signed values onto unsigned ones so small negative numbers stay
+ * small when varint encoded
+ */
+inline uint32_t ZigZagEncode(int32_t value)
+{
+  return (static_cast<uint32_t>(value) << 1) ^
+         static_cast<uint32_t>(value >> 31);
+}
+
+/**
+ * @brief Undoes ZigZagEncode()
+ */
+inline int32_t ZigZagDecode(uint32_t value)
+{
+  return static_cast<int32_t>((value >> 1) ^ (0u - (value & 1)));
+}
+
+/**
+ * @brief CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) of length bytes. It
+ * works a nibble at a time so the table stays small enough for AVR RAM.
+ */
+inline uint16_t Crc16(const uint8_t *data, uint32_t length)
+{
+  static constexpr uint16_t NIBBLE_TABLE[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF};
+  uint16_t crc = 0xFFFF;
+  for (uint32_t i = 0; i < length; i++)
+  {
+    crc = static_cast<uint16_t>(
+      (crc << 4) ^ NIBBLE_TABLE[(crc >> 12) ^ (data[i] >> 4)]);
+    crc = static_cast<uint16_t>(
+      (crc << 4) ^ NIBBLE_TABLE[(crc >> 12) ^ (data[i] & 0x0F)]);
+  }
+  return crc;
+}
+
+/**
+ * @brief Decodes a COBS encoded block in place
+ * @return the decoded length, or -1 if the block isn't valid COBS
+ */
+inline int32_t CobsDecode(uint8_t *data, uint32_t length)
+{
+  uint32_t read = 0;
+  uint32_t write = 0;
+  while (read < length)
+  {
+    uint8_t code = data[read];
+    read++;
+    if (code == 0 || read + code - 1 > length)
+    {
+      return -1;
+    }
+    for (uint8_t i = 1; i < code; i++)
+    {
+      data[write] = data[read];
+      write++;
+      read++;
+    }
+    if (code != 0xFF && read < length)
+    {
+      data[write] = 0;
+      write++;
+    }
+  }
+  return static_cast<int32_t>(write);
+}
+
+/**
+ * @brief COBS encodes length bytes of data into out and ends them with
+ * FRAME_DELIMITER. out needs room for length + length / 254 + 2 bytes. It
+ * may be the same buffer as data if data starts at least length / 254 + 1
+ * bytes into it, since the encoding never overtakes what is left to read.
+ * @return the number of bytes written to out, including the delimiter
+ */
+inline uint32_t CobsEncode(const uint8_t *data, uint32_t length, uint8_t *out)
+{
+  uint32_t write = 1;
+  uint32_t codeIndex = 0;
+  uint8_t code = 1;
+  for (uint32_t read = 0; read < length; read++)
+  {
+    if (data[read] == 0)
+    {
+      out[codeIndex] = code;
+      codeIndex = write;
+      write++;
+      code = 1;
+      continue;
+    }
+    out[write] = data[read];
+    write++;
+    code++;
+    if (code == 0xFF)
+    {
+      out[codeIndex] = code;
+      codeIndex = write;
+      write++;
+      code = 1;
+    }
+  }
+  out[codeIndex] = code;
+  out[write] = FRAME_DELIMITER;
+  return write + 1;
+}
+
+/**
+ * @brief Encodes args as a complete binary frame, including the CRC, the COBS
+ * encoding and the trailing FRAME_DELIMITER
+ * @param args the args to encode, args[0] is the message ID
+ * @param count the number of args
+ * @param out where to write the frame
+ * @param outSize the size of out
+ * @return the length of the frame, or 0 if it doesn't fit in out
+ */
+inline uint32_t EncodeFrame(
+  const int32_t *args,
+  uint32_t count,
+  uint8_t *out,
+  uint32_t outSize)
+{
+  // COBS adds a code byte up front and one more for every 254 bytes. Build
+  // the payload at the end of out then encode it forwards over itself.
+  uint32_t payloadSize = count * MAX_VARINT_SIZE + CRC_SIZE;
+  uint32_t worstCase = payloadSize + payloadSize / 254 + 2;
+  if (worstCase > outSize)
+  {
+    return 0;
+  }
+
+  uint8_t *payload = out + (outSize - payloadSize);
+  uint32_t length = 0;
+  for (uint32_t i = 0; i < count; i++)
+  {
+    uint32_t value = ZigZagEncode(args[i]);
+    while (value >= 0x80)
+    {
+      payload[length] = static_cast<uint8_t>(value | 0x80);
+      length++;
+      value >>= 7;
+    }
+    payload[length] = static_cast<uint8_t>(value);
+    length++;
+  }
+  uint16_t crc = Crc16(payload, length);
+  payload[length] = static_cast<uint8_t>(crc >> 8);
+  payload[length + 1] = static_cast<uint8_t>(crc);
+  length += CRC_SIZE;
+  return CobsEncode(payload, length, out);
+}
+} // namespace MESSAGE_BINARY
+
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS>
+class BinaryFrameParser
+{
+public:
+  /**
+   * @brief Collects bytes until a frame has been completed or the input runs
+   * out. Frames that are too long, aren't valid COBS or fail their CRC are
+   * dropped.
+   * @param buffer the bytes to parse
+   * @param length the number of bytes in buffer
+   * @return the number of bytes consumed, this is less than length if a frame
+   * was completed before the end of the buffer
+   */
+  uint32_t Parse(const char *buffer, uint32_t length);
+
+  /**
+   * @brief Returns true if the last call to Parse() completed a frame
+   * @return true if the last call to Parse() completed a frame
+   */
+  bool IsFrameComplete() const;
+
+  /**
+   * @brief Drops any partially received frame
+   */
+  void Reset();
+
+  /**
+   * @brief Return a pointer to the args of the current frame
+   * @return a pointer to the args of the current frame
+   */
+  const int32_t *GetArgs() const;
+
+  /**
+   * @brief Returns the number of args that have been populated for the current
+   * frame
+   * @return the number of args that have been populated for the current frame
+   */
+  uint32_t GetPopulatedArgs() const;
+
+  /**
+   * @brief Returns true if the current frame had more than MAX_ARGS args.
+   * The extra args are dropped.
+   * @return true if the current frame had more than MAX_ARGS args
+   */
+  bool HasArgOverflow() const;
+
+  /**
+   * @brief Binary frames have no text, this is here so both parsers can be
+   * used the same way
+   * @return nullptr
+   */
+  const char *GetData() const;
+
+  /**
+   * @brief Binary frames have no text for an arg to span
+   * @return nullptr
+   */
+  const MESSAGE_INTF::ArgSpan *GetArgSpans() const;
+
+#ifdef MESSAGE_ENABLE_STATS
+  /**
+   * @brief Returns the counters for the bytes the parser has seen. Only
+   * bytesDiscarded, truncatedFrames and parseErrors are filled in.
+   * @return the parser's counters
+   */
+  const MESSAGE_INTF::Stats &GetStats() const;
+
+  /**
+   * @brief Sets every counter back to zero
+   */
+  void ResetStats();
+#endif
+
+private:
+  /**
+   * @brief Decodes the frame in data into the args array
+   * @return false if the frame is corrupt
+   */
+  bool decodeFrame();
+
+  bool frameComplete{false};
+  bool frameTooLong{false}; // drop everything up to the next delimiter
+  bool argOverflow{false};
+
+  uint8_t data[SERIAL_BUFFER_SIZE]; // the encoded bytes of the current frame
+  uint32_t ndx{0};
+  uint32_t populatedArgs{
+    0}; // the number of args that have been populated for the current frame
+  std::array<int32_t, MAX_ARGS> args;
+
+#ifdef MESSAGE_ENABLE_STATS
+  MESSAGE_INTF::Stats stats{};
+#endif
+};
+
+namespace MESSAGE_INTF
+{
+/**
+ * @brief Selects the compact binary wire format for a Message object
+ */
+struct BinaryProtocol
+{
+  static constexpr bool rawArgs = true; // args are sent as their 32 bits
+
+  template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS>
+  using Parser = BinaryFrameParser<SERIAL_BUFFER_SIZE, MAX_ARGS>;
+
+  static uint32_t Encode(
+    const int32_t *args,
+    uint32_t count,
+    char *out,
+    uint32_t outSize)
+  {
+    return MESSAGE_BINARY::EncodeFrame(
+      args, count, reinterpret_cast<uint8_t *>(out), outSize);
+  }
+};
+} // namespace MESSAGE_INTF
+
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS>
+uint32_t BinaryFrameParser<SERIAL_BUFFER_SIZE, MAX_ARGS>::Parse(
+  const char *buffer,
+  uint32_t length)
+{
+  frameComplete = false;
+  for (uint32_t i = 0; i < length; i++)
+  {
+    uint8_t byte = static_cast<uint8_t>(buffer[i]);
+    if (byte != MESSAGE_BINARY::FRAME_DELIMITER)
+    {
+      if (ndx < SERIAL_BUFFER_SIZE)
+      {
+        data[ndx] = byte;
+        ndx++;
+      }
+      else
+      {
+        frameTooLong = true;
+        MESSAGE_STATS_ADD(stats.bytesDiscarded, 1);
+      }
+      continue;
+    }
+
+    bool valid = ndx > 0 && !frameTooLong && decodeFrame();
+#ifdef MESSAGE_ENABLE_STATS
+    if (!valid && ndx > 0)
+    {
+      stats.bytesDiscarded += ndx;
+      if (frameTooLong)
+      {
+        stats.truncatedFrames++;
+      }
+      else
+      {
+        stats.parseErrors++;
+      }
+    }
+#endif
+    ndx = 0;
+    frameTooLong = false;
+    if (valid)
+    {
+      frameComplete = true;
+      return i + 1;
+    }
+  }
+  return length;
+}
+
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS>
+bool BinaryFrameParser<SERIAL_BUFFER_SIZE, MAX_ARGS>::decodeFrame()
+{
+  int32_t decoded = MESSAGE_BINARY::CobsDecode(data, ndx);
+  if (decoded < static_cast<int32_t>(MESSAGE_BINARY::CRC_SIZE))
+  {
+    return false;
+  }
+
+  uint32_t length = static_cast<uint32_t>(decoded) - MESSAGE_BINARY::CRC_SIZE;
+  uint16_t crc = static_cast<uint16_t>((data[length] << 8) | data[length + 1]);
+  if (crc != MESSAGE_BINARY::Crc16(data, length))
+  {
+    return false;
+  }
+
+  populatedArgs = 0;
+  argOverflow = false;
+  uint32_t value = 0;
+  uint32_t shift = 0;
+  for (uint32_t i = 0; i < length; i++)
+  {
+    // the 5th byte of a varint only has the top 4 bits of the value left
+    if (shift == 7 * (MESSAGE_BINARY::MAX_VARINT_SIZE - 1) && data[i] > 0x0F)
+    {
+      return false;
+    }
+    value |= static_cast<uint32_t>(data[i] & 0x7F) << shift;
+    if (data[i] & 0x80)
+    {
+      shift += 7;
+      continue;
+    }
+
+    if (populatedArgs < MAX_ARGS)
+    {
+      args[populatedArgs] = MESSAGE_BINARY::ZigZagDecode(value);
+      populatedArgs++;
+    }
+    else
+    {
+      argOverflow = true;
+    }
+    value = 0;
+    shift = 0;
+  }
+  // a varint that runs into the CRC is corrupt
+  return shift == 0;
+}
+
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS>
+bool BinaryFrameParser<SERIAL_BUFFER_SIZE, MAX_ARGS>::IsFrameComplete() const
+{
+  return frameComplete;
+}
+
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS>
+void BinaryFrameParser<SERIAL_BUFFER_SIZE, MAX_ARGS>::Reset()
+{
+  ndx = 0;
+  frameTooLong = false;
+  frameComplete = false;
+}
+
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS>
+const int32_t *BinaryFrameParser<SERIAL_BUFFER_SIZE, MAX_ARGS>::GetArgs() const
+{
+  return args.data();
+}
+
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS>
+uint32_t
+BinaryFrameParser<SERIAL_BUFFER_SIZE, MAX_ARGS>::GetPopulatedArgs() const
+{
+  return populatedArgs;
+}
+
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS>
+bool BinaryFrameParser<SERIAL_BUFFER_SIZE, MAX_ARGS>::HasArgOverflow() const
+{
+  return argOverflow;
+}
+
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS>
+const char *BinaryFrameParser<SERIAL_BUFFER_SIZE, MAX_ARGS>::GetData() const
+{
+  return nullptr;
+}
+
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS>
+const MESSAGE_INTF::ArgSpan *
+BinaryFrameParser<SERIAL_BUFFER_SIZE, MAX_ARGS>::GetArgSpans() const
+{
+  return nullptr;
+}
+
+#ifdef MESSAGE_ENABLE_STATS
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS>
+const MESSAGE_INTF::Stats &
+BinaryFrameParser<SERIAL_BUFFER_SIZE, MAX_ARGS>::GetStats() const
+{
+  return stats;
+}
+
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS>
+void BinaryFrameParser<SERIAL_BUFFER_SIZE, MAX_ARGS>::ResetStats()
+{
+  stats = MESSAGE_INTF::Stats{};
+}
+#endif
@@ -1,27 +1,41 @@
 #pragma once
-#include "SerialMessage.h"
+#include "Message.h"
 #include <BluetoothSerial.h>
 
 template <
   uint32_t SERIAL_BUFFER_SIZE,
   uint32_t MAX_ARGS,
-  uint32_t MAX_CALLBACKS>
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES = 1,
+  typename PROTOCOL = MESSAGE_INTF::AsciiProtocol>
 class BluetoothSerialMessage
-    : public SerialMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>
+    : public Message<
+        BluetoothSerialMessage<
+          SERIAL_BUFFER_SIZE,
+          MAX_ARGS,
+          MAX_CALLBACKS,
+          MAX_FRAMES,
+          PROTOCOL>,
+        SERIAL_BUFFER_SIZE,
+        MAX_ARGS,
+        MAX_CALLBACKS,
+        MAX_FRAMES,
+        PROTOCOL>
 {
+  friend class Message<
+    BluetoothSerialMessage,
+    SERIAL_BUFFER_SIZE,
+    MAX_ARGS,
+    MAX_CALLBACKS,
+    MAX_FRAMES,
+    PROTOCOL>;
+
 public:
-    /**
-     * @brief Construct a new Bluetooth Serial Message object
-     */
-    BluetoothSerialMessage(BluetoothSerial *serial);
+  /**
+   * @brief Construct a new Bluetooth Serial Message object
+   */
+  BluetoothSerialMessage(BluetoothSerial *serial);
 
-<<<<<<< Updated upstream
-    void Init(uint32_t baudRate) override { this->Init("BluetoothMessage"); }
-    /**
-     * @brief Initialize the BluetoothSerialMessage object
-     */
-    void Init(const char *bluetoothName);
-=======
   void Init(uint32_t baudRate) override
   {
     this->Init("BluetoothMessage");
@@ -30,75 +44,142 @@ public:
    * @brief Initialize the BluetoothSerialMessage object
    */
   void Init(const char *bluetoothName);
->>>>>>> Stashed changes
 
-    /**
-     * @brief prints the args array to the serial monitor
-     */
-    void PrintArgs() override;
+  /**
+   * @brief prints the args array to the serial monitor
+   */
+  void PrintArgs() override;
 
 private:
-    /**
-     * @brief reads the serial data and stores it in the data array
-     */
-    char getChar() override;
-    uint32_t dataAvailable() override;
+  /**
+   * @brief reads the serial data and stores it in the data array
+   */
+  char getChar();
+  uint32_t dataAvailable();
+  uint32_t readBytes(char *buffer, uint32_t length);
+  void writeBytes(const char *buffer, uint32_t length);
 
-    BluetoothSerial *serial;
+  BluetoothSerial *serial;
 };
 template <
   uint32_t SERIAL_BUFFER_SIZE,
   uint32_t MAX_ARGS,
-  uint32_t MAX_CALLBACKS>
-void BluetoothSerialMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::Init(
-  const char *bluetoothName)
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void BluetoothSerialMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::Init(const char *bluetoothName)
+{
+  serial->begin(bluetoothName);
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+char BluetoothSerialMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::getChar()
+{
+  return serial->read();
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+uint32_t BluetoothSerialMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::dataAvailable()
 {
-    serial->begin(bluetoothName);
+  return serial->available();
 }
 
 template <
   uint32_t SERIAL_BUFFER_SIZE,
   uint32_t MAX_ARGS,
-  uint32_t MAX_CALLBACKS>
-char BluetoothSerialMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::
-  getChar()
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+uint32_t BluetoothSerialMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::readBytes(char *buffer, uint32_t length)
 {
-    return serial->read();
+  // never ask for more than is buffered so readBytes() won't wait on its
+  // timeout
+  uint32_t available = serial->available();
+  if (length > available)
+  {
+    length = available;
+  }
+  if (length == 0)
+  {
+    return 0;
+  }
+  return serial->readBytes(buffer, length);
 }
 
 template <
   uint32_t SERIAL_BUFFER_SIZE,
   uint32_t MAX_ARGS,
-  uint32_t MAX_CALLBACKS>
-uint32_t BluetoothSerialMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::
-  dataAvailable()
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void BluetoothSerialMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::writeBytes(const char *buffer, uint32_t length)
 {
-    return serial->available();
+  serial->write(reinterpret_cast<const uint8_t *>(buffer), length);
 }
 
 template <
   uint32_t SERIAL_BUFFER_SIZE,
   uint32_t MAX_ARGS,
-  uint32_t MAX_CALLBACKS>
-BluetoothSerialMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::
-  BluetoothSerialMessage(BluetoothSerial *serial)
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+BluetoothSerialMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::BluetoothSerialMessage(BluetoothSerial *serial)
+    : serial(serial)
 {
-    this->serial = serial;
 }
 
 template <
   uint32_t SERIAL_BUFFER_SIZE,
   uint32_t MAX_ARGS,
-  uint32_t MAX_CALLBACKS>
-void BluetoothSerialMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::
-  PrintArgs()
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void BluetoothSerialMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::PrintArgs()
 {
-    serial->print("Current number of args: ");
-    serial->println(this->populatedArgs);
-    for (int i = 0; i < this->populatedArgs; i++)
-    {
-        serial->print(this->args[i]);
-        serial->print(" ");
-    }
-    serial->println();
-}
\ No newline at end of file
+  this->printArgs();
+}
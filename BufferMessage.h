@@ -0,0 +1,346 @@
+/**
+ * @file BufferMessage.h
+ * @brief This file contains the BufferMessage class
+ * @details This file contains the BufferMessage class which parses messages
+ * out of a block of memory and writes outgoing frames into another one. It
+ * needs no hardware, so it is handy for replaying captured traffic and for
+ * timing the parser on a host.
+ * @version 1.0.0
+ */
+
+#pragma once
+
+#include <cstring>
+
+#include "Message.h"
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES = 1,
+  typename PROTOCOL = MESSAGE_INTF::AsciiProtocol>
+class BufferMessage
+    : public Message<
+        BufferMessage<
+          SERIAL_BUFFER_SIZE,
+          MAX_ARGS,
+          MAX_CALLBACKS,
+          MAX_FRAMES,
+          PROTOCOL>,
+        SERIAL_BUFFER_SIZE,
+        MAX_ARGS,
+        MAX_CALLBACKS,
+        MAX_FRAMES,
+        PROTOCOL>
+{
+  friend class Message<
+    BufferMessage,
+    SERIAL_BUFFER_SIZE,
+    MAX_ARGS,
+    MAX_CALLBACKS,
+    MAX_FRAMES,
+    PROTOCOL>;
+
+public:
+  /**
+   * @brief Initialize the BufferMessage object, there is nothing to set up
+   */
+  void Init(uint32_t baudRate) override;
+
+  /**
+   * @brief Prints the args array into the output buffer
+   */
+  void PrintArgs() override;
+
+  /**
+   * @brief Sets the bytes the next calls to Update() will parse. The data
+   * isn't copied, it has to stay alive until it has all been read.
+   * @param data the bytes to parse
+   * @param length the number of bytes in data
+   */
+  void SetInput(const char *data, uint32_t length);
+
+  /**
+   * @brief Returns the number of input bytes that haven't been read yet
+   * @return the number of input bytes that haven't been read yet
+   */
+  uint32_t GetRemainingInput() const;
+
+  /**
+   * @brief Sets where outgoing bytes are written. Anything that doesn't fit in
+   * size bytes is dropped.
+   * @param buffer the buffer to write into
+   * @param size the size of buffer
+   */
+  void SetOutput(char *buffer, uint32_t size);
+
+  /**
+   * @brief Returns the number of bytes written into the output buffer since it
+   * was set
+   * @return the number of bytes written into the output buffer
+   */
+  uint32_t GetOutputLength() const;
+
+protected:
+  /**
+   * @brief reads the next byte of the input
+   * @return the next byte of the input, '\0' once it has all been read
+   */
+  char getChar();
+
+  /**
+   * @brief returns the number of input bytes that haven't been read yet
+   */
+  uint32_t dataAvailable();
+
+  /**
+   * @brief copies as much of the remaining input as fits into buffer
+   */
+  uint32_t readBytes(char *buffer, uint32_t length);
+
+  /**
+   * @brief returns the rest of the input so it is parsed in place
+   */
+  const char *peekBytes(uint32_t &length);
+
+  /**
+   * @brief skips over input that has been parsed
+   */
+  void consumeBytes(uint32_t length);
+
+  /**
+   * @brief appends the bytes to the output buffer
+   */
+  void writeBytes(const char *buffer, uint32_t length);
+
+private:
+  const char *input{nullptr};
+  uint32_t inputLength{0};
+  uint32_t inputIndex{0};
+
+  char *output{nullptr};
+  uint32_t outputSize{0};
+  uint32_t outputLength{0};
+};
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void BufferMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::Init(uint32_t baudRate)
+{
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void BufferMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::PrintArgs()
+{
+  this->printArgs();
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void BufferMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::SetInput(const char *data, uint32_t length)
+{
+  input = data;
+  inputLength = length;
+  inputIndex = 0;
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+uint32_t BufferMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::GetRemainingInput() const
+{
+  return inputLength - inputIndex;
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void BufferMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::SetOutput(char *buffer, uint32_t size)
+{
+  output = buffer;
+  outputSize = size;
+  outputLength = 0;
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+uint32_t BufferMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::GetOutputLength() const
+{
+  return outputLength;
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+char BufferMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::getChar()
+{
+  if (inputIndex >= inputLength)
+  {
+    return '\0';
+  }
+  char c = input[inputIndex];
+  inputIndex++;
+  return c;
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+uint32_t BufferMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::dataAvailable()
+{
+  return inputLength - inputIndex;
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+uint32_t BufferMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::readBytes(char *buffer, uint32_t length)
+{
+  uint32_t available = inputLength - inputIndex;
+  if (length > available)
+  {
+    length = available;
+  }
+  if (length > 0)
+  {
+    memcpy(buffer, input + inputIndex, length);
+    inputIndex += length;
+  }
+  return length;
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+const char *BufferMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::peekBytes(uint32_t &length)
+{
+  length = inputLength - inputIndex;
+  return input + inputIndex;
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void BufferMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::consumeBytes(uint32_t length)
+{
+  inputIndex += length;
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void BufferMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::writeBytes(const char *buffer, uint32_t length)
+{
+  uint32_t room = outputSize - outputLength;
+  if (length > room)
+  {
+    length = room;
+  }
+  if (length > 0)
+  {
+    memcpy(output + outputLength, buffer, length);
+    outputLength += length;
+  }
+}
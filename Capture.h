@@ -0,0 +1,277 @@
+/**
+ * @file Capture.h
+ * @brief This file contains the capture file format and the CaptureWriter
+ * class which records what a link received
+ * @details A capture starts with an 8 byte header, "MSGCAP", the format
+ * version and a reserved 0. Then comes one record for every chunk of bytes
+ * the transport handed to the parser: the microseconds since the previous
+ * record and the number of bytes, both as LEB128 varints, followed by the
+ * bytes themselves. A chunk of a few bytes costs 2 bytes of overhead.
+ * ReplayMessage plays a capture back into the parser.
+ * @version 1.0.0
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "MESSAGE-INTF.h"
+
+namespace MESSAGE_CAPTURE
+{
+constexpr char MAGIC[6] = {'M', 'S', 'G', 'C', 'A', 'P'};
+constexpr uint8_t VERSION = 1;
+constexpr uint32_t HEADER_SIZE = 8;
+
+// a uint32_t takes at most 5 varint bytes, a record header has two of them
+constexpr uint32_t MAX_VARINT_SIZE = 5;
+constexpr uint32_t MAX_RECORD_HEADER_SIZE = 2 * MAX_VARINT_SIZE;
+
+/**
+ * @brief One chunk of received bytes read back from a capture
+ */
+struct Record
+{
+  uint32_t delta;   // microseconds since the previous record
+  const char *data; // the bytes, they point into the capture
+  uint32_t length;  // the number of bytes
+};
+
+/**
+ * @brief Writes the capture header into out, which needs HEADER_SIZE bytes
+ */
+inline void WriteHeader(uint8_t *out)
+{
+  memcpy(out, MAGIC, sizeof(MAGIC));
+  out[6] = VERSION;
+  out[7] = 0;
+}
+
+/**
+ * @brief Returns true if data starts with a header this code can read
+ */
+inline bool CheckHeader(const uint8_t *data, uint32_t length)
+{
+  return length >= HEADER_SIZE && memcmp(data, MAGIC, sizeof(MAGIC)) == 0 &&
+         data[6] == VERSION;
+}
+
+/**
+ * @brief Writes value as an LEB128 varint, 7 bits per byte with the top bit
+ * set on every byte but the last
+ * @return the number of bytes written, at most MAX_VARINT_SIZE
+ */
+inline uint32_t WriteVarint(uint32_t value, uint8_t *out)
+{
+  uint32_t length = 0;
+  while (value >= 0x80)
+  {
+    out[length] = static_cast<uint8_t>(value | 0x80);
+    value >>= 7;
+    length++;
+  }
+  out[length] = static_cast<uint8_t>(value);
+  return length + 1;
+}
+
+/**
+ * @brief Reads a varint written by WriteVarint() and moves position past it
+ * @return false if the varint runs past end or is too long for a uint32_t
+ */
+inline bool ReadVarint(
+  const uint8_t *&position,
+  const uint8_t *end,
+  uint32_t &value)
+{
+  value = 0;
+  for (uint32_t shift = 0; shift < 7 * MAX_VARINT_SIZE; shift += 7)
+  {
+    if (position == end)
+    {
+      return false;
+    }
+    uint8_t byte = *position;
+    position++;
+    value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief Reads the record at position and moves position past it
+ * @return false at the end of the capture, or if the record is cut short
+ */
+inline bool ReadRecord(
+  const uint8_t *&position,
+  const uint8_t *end,
+  Record &record)
+{
+  const uint8_t *next = position;
+  if (
+    !ReadVarint(next, end, record.delta) ||
+    !ReadVarint(next, end, record.length) ||
+    record.length > static_cast<uint32_t>(end - next))
+  {
+    return false;
+  }
+  record.data = reinterpret_cast<const char *>(next);
+  position = next + record.length;
+  return true;
+}
+} // namespace MESSAGE_CAPTURE
+
+namespace MESSAGE_INTF
+{
+/**
+ * @brief Something a Message object hands every chunk of received bytes to,
+ * before they are parsed. Set one with SetCapture().
+ */
+class CaptureSink
+{
+public:
+  /**
+   * @brief Called with every chunk of bytes the transport returned
+   */
+  virtual void Record(const char *data, uint32_t length) = 0;
+};
+} // namespace MESSAGE_INTF
+
+/**
+ * @brief Records chunks in the capture format. They are built up in
+ * BUFFER_SIZE bytes and handed to a write function whenever that fills up,
+ * e.g. to append them to a file on an SD card or on a host.
+ */
+template <uint32_t BUFFER_SIZE>
+class CaptureWriter : public MESSAGE_INTF::CaptureSink
+{
+  static_assert(
+    BUFFER_SIZE >= MESSAGE_CAPTURE::HEADER_SIZE +
+                     MESSAGE_CAPTURE::MAX_RECORD_HEADER_SIZE,
+    "the capture buffer has to fit the header and a record header");
+
+public:
+  /**
+   * @brief Writes the next bytes of the capture, context is the one given to
+   * the constructor
+   */
+  using WriteFunction =
+    void (*)(void *context, const uint8_t *data, uint32_t length);
+
+  /**
+   * @brief Construct a new Capture Writer object. The header is written with
+   * the first record.
+   * @param clock where the timestamps come from
+   * @param write where the capture goes
+   * @param context passed back to write, e.g. a FILE * or a File *
+   */
+  CaptureWriter(
+    MESSAGE_INTF::ClockFunction clock,
+    WriteFunction write,
+    void *context);
+
+  /**
+   * @brief Adds a record for the chunk, flushing first if it doesn't fit.
+   * Chunks bigger than the buffer are written straight through.
+   */
+  void Record(const char *data, uint32_t length) override;
+
+  /**
+   * @brief Writes out whatever is buffered
+   */
+  void Flush();
+
+  /**
+   * @brief Returns the number of bytes of capture written so far, including
+   * the buffered ones
+   */
+  uint32_t GetCaptureSize() const;
+
+private:
+  /**
+   * @brief Appends length bytes to the buffer, which has to have room
+   */
+  void append(const void *data, uint32_t length);
+
+  MESSAGE_INTF::ClockFunction clock;
+  WriteFunction write;
+  void *context;
+
+  uint8_t buffer[BUFFER_SIZE];
+  uint32_t used{0};          // the number of bytes in buffer
+  uint32_t flushed{0};       // the number of bytes handed to write
+  uint32_t lastMicros{0};    // when the previous record was taken
+  bool headerWritten{false}; // the header goes out with the first record
+};
+
+template <uint32_t BUFFER_SIZE>
+CaptureWriter<BUFFER_SIZE>::CaptureWriter(
+  MESSAGE_INTF::ClockFunction clock,
+  WriteFunction write,
+  void *context)
+    : clock(clock),
+      write(write),
+      context(context)
+{
+}
+
+template <uint32_t BUFFER_SIZE>
+void CaptureWriter<BUFFER_SIZE>::Record(const char *data, uint32_t length)
+{
+  uint32_t now = clock();
+  uint8_t header[MESSAGE_CAPTURE::MAX_RECORD_HEADER_SIZE];
+  // the clock wrapping doesn't matter, the difference still comes out right
+  uint32_t headerLength =
+    MESSAGE_CAPTURE::WriteVarint(headerWritten ? now - lastMicros : 0, header);
+  headerLength += MESSAGE_CAPTURE::WriteVarint(length, header + headerLength);
+  lastMicros = now;
+
+  if (!headerWritten)
+  {
+    uint8_t fileHeader[MESSAGE_CAPTURE::HEADER_SIZE];
+    MESSAGE_CAPTURE::WriteHeader(fileHeader);
+    append(fileHeader, sizeof(fileHeader));
+    headerWritten = true;
+  }
+  if (used + headerLength + length > BUFFER_SIZE)
+  {
+    Flush();
+  }
+  append(header, headerLength);
+  if (headerLength + length > BUFFER_SIZE)
+  {
+    Flush();
+    write(context, reinterpret_cast<const uint8_t *>(data), length);
+    flushed += length;
+    return;
+  }
+  append(data, length);
+}
+
+template <uint32_t BUFFER_SIZE>
+void CaptureWriter<BUFFER_SIZE>::Flush()
+{
+  if (used > 0)
+  {
+    write(context, buffer, used);
+    flushed += used;
+    used = 0;
+  }
+}
+
+template <uint32_t BUFFER_SIZE>
+uint32_t CaptureWriter<BUFFER_SIZE>::GetCaptureSize() const
+{
+  return flushed + used;
+}
+
+template <uint32_t BUFFER_SIZE>
+void CaptureWriter<BUFFER_SIZE>::append(const void *data, uint32_t length)
+{
+  memcpy(buffer + used, data, length);
+  used += length;
+}
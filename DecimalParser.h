@@ -0,0 +1,621 @@
+/**
+ * @file DecimalParser.h
+ * @brief This file contains the functions that turn the text of one arg into
+ * an int64_t, a full range uint32_t, a fixed point number or a float
+ * @details None of them look at the locale or allocate, and all of them report
+ * values that don't fit instead of wrapping. The text may have whitespace
+ * around the number but nothing else.
+ * @version 1.0.0
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "MESSAGE-INTF.h"
+
+namespace MESSAGE_ASCII
+{
+/**
+ * @brief The digits of a decimal number, as read by ScanDecimal()
+ */
+struct Decimal
+{
+  uint64_t mantissa;  // the first 19 significant digits
+  int32_t exponent;   // the value is mantissa * 10^exponent
+  bool negative;      // a '-' came before the digits
+  bool hasFraction;   // there was a '.' or an exponent
+  uint32_t truncated; // the number of significant digits past the 19th
+};
+
+/**
+ * @brief Reads `[+-]digits[.digits][(e|E)[+-]digits]` surrounded by optional
+ * whitespace
+ * @return false if the text is anything else
+ */
+inline bool ScanDecimal(const char *text, uint32_t length, Decimal &decimal)
+{
+  const char *position = text;
+  const char *end = text + length;
+  auto isSpace = [](char c)
+  {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+  };
+  while (position < end && isSpace(*position))
+  {
+    position++;
+  }
+  while (end > position && isSpace(end[-1]))
+  {
+    end--;
+  }
+
+  decimal = Decimal{0, 0, false, false, 0};
+  if (position < end && (*position == '-' || *position == '+'))
+  {
+    decimal.negative = *position == '-';
+    position++;
+  }
+
+  // 19 digits always fit in a uint64_t, the rest only move the exponent
+  uint32_t digitCount = 0;
+  uint32_t significant = 0;
+  bool inFraction = false;
+  for (; position < end; position++)
+  {
+    char c = *position;
+    if (c == '.' && !inFraction)
+    {
+      inFraction = true;
+      decimal.hasFraction = true;
+      continue;
+    }
+    if (c < '0' || c > '9')
+    {
+      break;
+    }
+    digitCount++;
+    if (significant == 0 && c == '0')
+    {
+      decimal.exponent -= inFraction ? 1 : 0;
+      continue;
+    }
+    if (significant < 19)
+    {
+      decimal.mantissa = decimal.mantissa * 10 + static_cast<uint32_t>(c - '0');
+      significant++;
+      decimal.exponent -= inFraction ? 1 : 0;
+    }
+    else
+    {
+      decimal.truncated++;
+      decimal.exponent += inFraction ? 0 : 1;
+    }
+  }
+  if (digitCount == 0)
+  {
+    return false;
+  }
+
+  if (position < end && (*position == 'e' || *position == 'E'))
+  {
+    position++;
+    bool negativeExponent = false;
+    if (position < end && (*position == '-' || *position == '+'))
+    {
+      negativeExponent = *position == '-';
+      position++;
+    }
+    if (position == end)
+    {
+      return false;
+    }
+    int32_t exponent = 0;
+    for (; position < end && *position >= '0' && *position <= '9'; position++)
+    {
+      // anything this big is out of range of every type anyway
+      if (exponent < 100000)
+      {
+        exponent = exponent * 10 + (*position - '0');
+      }
+    }
+    decimal.exponent += negativeExponent ? -exponent : exponent;
+    decimal.hasFraction = true;
+  }
+  return position == end;
+}
+
+/**
+ * @brief Reads a whole number into a magnitude
+ * @return false if the text isn't an integer or is bigger than limit
+ */
+inline bool ScanInteger(
+  const char *text,
+  uint32_t length,
+  uint64_t limit,
+  uint64_t &magnitude,
+  bool &negative)
+{
+  Decimal decimal;
+  if (
+    !ScanDecimal(text, length, decimal) || decimal.hasFraction ||
+    decimal.truncated != 0)
+  {
+    return false;
+  }
+  magnitude = decimal.mantissa;
+  negative = decimal.negative;
+  for (int32_t i = 0; i < decimal.exponent; i++)
+  {
+    if (magnitude > limit / 10)
+    {
+      return false;
+    }
+    magnitude *= 10;
+  }
+  return magnitude <= limit;
+}
+
+/**
+ * @brief Converts the text of an arg into an int64_t
+ * @return false if it isn't an integer or doesn't fit
+ */
+inline bool ParseInt64(const char *text, uint32_t length, int64_t &value)
+{
+  uint64_t magnitude;
+  bool negative;
+  if (!ScanInteger(text, length, 1ull << 63, magnitude, negative))
+  {
+    return false;
+  }
+  if (!negative && magnitude == 1ull << 63)
+  {
+    return false;
+  }
+  value = static_cast<int64_t>(negative ? 0ull - magnitude : magnitude);
+  return true;
+}
+
+/**
+ * @brief Converts the text of an arg into a uint32_t, all the way up to
+ * 4294967295
+ * @return false if it isn't a positive integer or doesn't fit
+ */
+inline bool ParseUint32(const char *text, uint32_t length, uint32_t &value)
+{
+  uint64_t magnitude;
+  bool negative;
+  if (
+    !ScanInteger(text, length, 0xFFFFFFFFull, magnitude, negative) ||
+    (negative && magnitude != 0))
+  {
+    return false;
+  }
+  value = static_cast<uint32_t>(magnitude);
+  return true;
+}
+
+/**
+ * @brief Converts the text of an arg into a Qm.n fixed point number, rounded
+ * to the nearest step of 2^-FRAC_BITS
+ * @return false if it isn't a number or doesn't fit
+ */
+template <uint32_t FRAC_BITS>
+bool ParseFixed(
+  const char *text,
+  uint32_t length,
+  MESSAGE_INTF::Fixed<FRAC_BITS> &value)
+{
+  Decimal decimal;
+  if (!ScanDecimal(text, length, decimal))
+  {
+    return false;
+  }
+
+  // digits below 10^-18 can't change a 31 bit fraction, drop them so the
+  // fraction's scale fits in a uint64_t
+  uint64_t whole = decimal.mantissa;
+  int32_t exponent = decimal.exponent;
+  for (; exponent < -18; exponent++)
+  {
+    whole /= 10;
+  }
+  for (; exponent > 0; exponent--)
+  {
+    if (whole > (1ull << 31))
+    {
+      return false;
+    }
+    whole *= 10;
+  }
+  uint64_t scale = 1;
+  for (; exponent < 0; exponent++)
+  {
+    scale *= 10;
+  }
+  uint64_t fraction = whole % scale;
+  whole /= scale;
+  if (whole > (1ull << 31))
+  {
+    return false;
+  }
+
+  // fraction / scale rounded to FRAC_BITS bits. Up to 9 fraction digits the
+  // shifted fraction fits in a uint64_t, past that it is done a bit at a time.
+  uint64_t fractionBits = 0;
+  if (scale <= (1ull << 32))
+  {
+    fractionBits = ((fraction << FRAC_BITS) + scale / 2) / scale;
+  }
+  else
+  {
+    for (uint32_t i = 0; i < FRAC_BITS; i++)
+    {
+      fraction *= 2;
+      fractionBits <<= 1;
+      if (fraction >= scale)
+      {
+        fraction -= scale;
+        fractionBits |= 1;
+      }
+    }
+    if (fraction * 2 >= scale)
+    {
+      fractionBits++; // round to nearest
+    }
+  }
+  uint64_t magnitude = (whole << FRAC_BITS) + fractionBits;
+  if (magnitude > (decimal.negative ? (1ull << 31) : 0x7FFFFFFFull))
+  {
+    return false;
+  }
+  value.raw = static_cast<int32_t>(
+    static_cast<uint32_t>(decimal.negative ? 0ull - magnitude : magnitude));
+  return true;
+}
+
+/**
+ * @brief A fixed size unsigned integer, just big enough to compare a decimal
+ * with the point halfway between two floats without rounding either one
+ */
+struct BigUint
+{
+  static constexpr uint32_t MAX_WORDS = 32;
+
+  uint32_t words[MAX_WORDS]{}; // the least significant word first
+  uint32_t size{0};            // the number of words in use
+
+  /**
+   * @brief Sets the value to value
+   */
+  void Set(uint64_t value)
+  {
+    words[0] = static_cast<uint32_t>(value);
+    words[1] = static_cast<uint32_t>(value >> 32);
+    size = words[1] != 0 ? 2 : (words[0] != 0 ? 1 : 0);
+  }
+
+  /**
+   * @brief Sets the value to value * factor + addend
+   */
+  void MultiplyAdd(uint32_t factor, uint32_t addend = 0)
+  {
+    uint64_t carry = addend;
+    for (uint32_t i = 0; i < size; i++)
+    {
+      uint64_t product = static_cast<uint64_t>(words[i]) * factor + carry;
+      words[i] = static_cast<uint32_t>(product);
+      carry = product >> 32;
+    }
+    if (carry != 0)
+    {
+      words[size] = static_cast<uint32_t>(carry);
+      size++;
+    }
+  }
+
+  /**
+   * @brief Multiplies the value by 5^power
+   */
+  void MultiplyPow5(uint32_t power)
+  {
+    for (; power >= 13; power -= 13)
+    {
+      MultiplyAdd(1220703125u); // 5^13, the biggest power that fits
+    }
+    uint32_t factor = 1;
+    for (; power > 0; power--)
+    {
+      factor *= 5;
+    }
+    MultiplyAdd(factor);
+  }
+
+  /**
+   * @brief Multiplies the value by 2^bits
+   */
+  void ShiftLeft(uint32_t bits)
+  {
+    if (size == 0)
+    {
+      return;
+    }
+    uint32_t wordShift = bits / 32;
+    uint32_t bitShift = bits % 32;
+    words[size] = 0;
+    for (uint32_t i = size + 1; i-- > 0;)
+    {
+      uint32_t high = words[i] << bitShift;
+      uint32_t low =
+        bitShift != 0 && i > 0 ? words[i - 1] >> (32 - bitShift) : 0;
+      words[i + wordShift] = high | low;
+    }
+    for (uint32_t i = 0; i < wordShift; i++)
+    {
+      words[i] = 0;
+    }
+    size += wordShift + 1;
+    while (size > 0 && words[size - 1] == 0)
+    {
+      size--;
+    }
+  }
+
+  /**
+   * @brief Returns -1, 0 or 1 as the value is less than, equal to or greater
+   * than other
+   */
+  int32_t Compare(const BigUint &other) const
+  {
+    if (size != other.size)
+    {
+      return size < other.size ? -1 : 1;
+    }
+    for (uint32_t i = size; i-- > 0;)
+    {
+      if (words[i] != other.words[i])
+      {
+        return words[i] < other.words[i] ? -1 : 1;
+      }
+    }
+    return 0;
+  }
+};
+
+/**
+ * @brief Compares digits * 10^exponent with the point halfway between the
+ * non-negative float with bits and the next float up
+ * @return -1, 0 or 1 as the decimal is below, at or above the halfway point
+ */
+inline int32_t CompareWithHalfway(
+  const BigUint &digits,
+  int32_t exponent,
+  uint32_t bits)
+{
+  // the halfway point is (2 * significand + 1) * 2^(binaryExponent - 1)
+  uint32_t biased = bits >> 23;
+  uint32_t significand = bits & 0x7FFFFF;
+  int32_t binaryExponent = -149;
+  if (biased != 0)
+  {
+    significand |= 0x800000;
+    binaryExponent = static_cast<int32_t>(biased) - 150;
+  }
+
+  // digits * 5^exponent * 2^exponent against halfway * 2^binaryExponent,
+  // with the powers of 5 and 2 moved to whichever side keeps them whole
+  BigUint decimal = digits;
+  BigUint halfway;
+  halfway.Set(2ull * significand + 1);
+  if (exponent >= 0)
+  {
+    decimal.MultiplyPow5(static_cast<uint32_t>(exponent));
+  }
+  else
+  {
+    halfway.MultiplyPow5(static_cast<uint32_t>(-exponent));
+  }
+  int32_t shift = exponent - (binaryExponent - 1);
+  if (shift >= 0)
+  {
+    decimal.ShiftLeft(static_cast<uint32_t>(shift));
+  }
+  else
+  {
+    halfway.ShiftLeft(static_cast<uint32_t>(-shift));
+  }
+  return decimal.Compare(halfway);
+}
+
+/**
+ * @brief Rounds the decimal in text to the nearest float, ties to even, by
+ * comparing it exactly with the points halfway between floats
+ * @param text the text decimal was scanned from
+ * @param length the number of characters in text
+ * @param decimal what ScanDecimal() read from text, it isn't zero
+ * @param estimate the decimal as a double, it only has to be close
+ * @param bits set to the bits of the float, without the sign
+ * @return false if the decimal rounds to infinity
+ */
+inline bool RoundToFloat(
+  const char *text,
+  uint32_t length,
+  const Decimal &decimal,
+  double estimate,
+  uint32_t &bits)
+{
+  // A point halfway between two floats has at most 113 significant digits,
+  // so a decimal cut to 120 digits plus a sticky 1 for any nonzero digit cut
+  // off compares with it the same way the whole decimal does
+  static constexpr uint32_t MAX_DIGITS = 120;
+
+  // read the significant digits again, ScanDecimal() only kept 19
+  BigUint digits;
+  uint32_t significant = 0;
+  uint32_t kept = 0;
+  bool sticky = false;
+  for (uint32_t i = 0; i < length; i++)
+  {
+    char c = text[i];
+    if (c == 'e' || c == 'E')
+    {
+      break;
+    }
+    if (c < '0' || c > '9' || (significant == 0 && c == '0'))
+    {
+      continue;
+    }
+    significant++;
+    if (kept < MAX_DIGITS)
+    {
+      digits.MultiplyAdd(10, static_cast<uint32_t>(c - '0'));
+      kept++;
+    }
+    else
+    {
+      sticky |= c != '0';
+    }
+  }
+  // decimal.exponent goes with the first 19 of the digits
+  int32_t exponent = decimal.exponent +
+                     static_cast<int32_t>(significant < 19 ? significant : 19) -
+                     static_cast<int32_t>(kept);
+  if (sticky)
+  {
+    digits.MultiplyAdd(10, 1);
+    kept++;
+    exponent--;
+  }
+
+  // 10^39 and up is past the biggest float, below 10^-46 rounds to zero
+  int32_t magnitude = exponent + static_cast<int32_t>(kept);
+  if (magnitude >= 40)
+  {
+    return false;
+  }
+  bits = 0;
+  if (magnitude <= -46)
+  {
+    return true;
+  }
+
+  // start from FLT_MAX if the estimate went past it
+  bits = 0x7F7FFFFF;
+  if (estimate <= 3.4028234663852886e38)
+  {
+    float rounded = static_cast<float>(estimate);
+    memcpy(&bits, &rounded, sizeof(bits));
+  }
+  // step up while the decimal is past the halfway point above, and down
+  // while it is short of the one below, ties go to the even float
+  for (;;)
+  {
+    int32_t above = CompareWithHalfway(digits, exponent, bits);
+    if (above > 0 || (above == 0 && (bits & 1) != 0))
+    {
+      bits++;
+      if (bits == 0x7F800000)
+      {
+        return false;
+      }
+      continue;
+    }
+    if (bits == 0)
+    {
+      return true;
+    }
+    int32_t below = CompareWithHalfway(digits, exponent, bits - 1);
+    if (below < 0 || (below == 0 && (bits & 1) != 0))
+    {
+      bits--;
+      continue;
+    }
+    return true;
+  }
+}
+
+/**
+ * @brief Converts the text of an arg into a float, correctly rounded to the
+ * nearest float with ties to even like strtof(). Numbers with up to 7
+ * significant digits and small exponents are converted with a single float
+ * multiply or divide. Everything else is estimated with double, and only
+ * when that estimate is too close to halfway between two floats, or outside
+ * of the normal floats, is it settled with RoundToFloat().
+ * @return false if it isn't a number or is too big for a float
+ */
+inline bool ParseFloat(const char *text, uint32_t length, float &value)
+{
+  static constexpr float FLOAT_POWERS[] = {
+    1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+  static constexpr double DOUBLE_POWERS[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+  Decimal decimal;
+  if (!ScanDecimal(text, length, decimal))
+  {
+    return false;
+  }
+
+  int32_t exponent = decimal.exponent;
+  float result;
+  if (decimal.mantissa == 0)
+  {
+    result = 0.0f;
+  }
+  else if (
+    decimal.mantissa <= (1ull << 24) && exponent >= -10 && exponent <= 10)
+  {
+    // both operands are exact floats, so the one rounding is the right one
+    float mantissa = static_cast<float>(decimal.mantissa);
+    result = exponent < 0 ? mantissa / FLOAT_POWERS[-exponent]
+                          : mantissa * FLOAT_POWERS[exponent];
+  }
+  else
+  {
+    double scaled = static_cast<double>(decimal.mantissa);
+    if (exponent < -400 || exponent > 400)
+    {
+      // out of range of a float either way, don't loop for ever on it
+      exponent = exponent < 0 ? -400 : 400;
+    }
+    while (exponent > 22)
+    {
+      scaled *= 1e22;
+      exponent -= 22;
+    }
+    while (exponent < -22)
+    {
+      scaled /= 1e22;
+      exponent += 22;
+    }
+    scaled = exponent < 0 ? scaled / DOUBLE_POWERS[-exponent]
+                          : scaled * DOUBLE_POWERS[exponent];
+
+    // Every step above rounds, so scaled is a few double ulps off at most.
+    // That only matters if it is that close to halfway between two floats,
+    // i.e. the 29 bits a normal float drops are near 0x10000000.
+    uint64_t doubleBits;
+    memcpy(&doubleBits, &scaled, sizeof(doubleBits));
+    uint32_t dropped = static_cast<uint32_t>(doubleBits) & 0x1FFFFFFF;
+    if (
+      scaled >= 1.1754943508222875e-38 && scaled <= 3.4028234663852886e38 &&
+      dropped - (0x10000000 - 64) > 128)
+    {
+      result = static_cast<float>(scaled);
+    }
+    else
+    {
+      uint32_t bits;
+      if (!RoundToFloat(text, length, decimal, scaled, bits))
+      {
+        return false;
+      }
+      memcpy(&result, &bits, sizeof(result));
+    }
+  }
+  value = decimal.negative ? -result : result;
+  return true;
+}
+} // namespace MESSAGE_ASCII
@@ -0,0 +1,153 @@
+/**
+ * @file Delegate.h
+ * @brief This file contains the Delegate template, a callable that is kept in
+ * a fixed number of bytes so callbacks can carry their own context
+ * @details A Delegate holds a plain function, a member function bound to an
+ * object, or a lambda or functor that is trivially copyable and fits in
+ * CAPACITY bytes. It never allocates, copies like a struct and is called
+ * through one function pointer. A callable that is too big or needs a
+ * destructor doesn't compile instead of going to the heap.
+ * @version 1.0.0
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace MESSAGE_INTF
+{
+template <typename SIGNATURE, uint32_t CAPACITY = 2 * sizeof(void *)>
+class Delegate;
+
+/**
+ * @brief Calls a RETURN(ARGS...) callable kept inside the object, e.g. a
+ * lambda that captures `this`
+ */
+template <typename RETURN, typename... ARGS, uint32_t CAPACITY>
+class Delegate<RETURN(ARGS...), CAPACITY>
+{
+public:
+  /**
+   * @brief Construct an empty Delegate, it mustn't be called
+   */
+  Delegate() = default;
+
+  Delegate(std::nullptr_t) {}
+
+  /**
+   * @brief Construct a Delegate that calls a plain function
+   */
+  Delegate(RETURN (*function)(ARGS...));
+
+  /**
+   * @brief Construct a Delegate that calls a copy of callable, e.g. a lambda
+   * capturing a pointer or two
+   */
+  template <typename CALLABLE>
+  Delegate(const CALLABLE &callable);
+
+  /**
+   * @brief Returns a Delegate that calls METHOD on object, e.g.
+   * `Bind<Motor, &Motor::OnMove>(&motor)`. object has to outlive it.
+   */
+  template <typename OBJECT, RETURN (OBJECT::*METHOD)(ARGS...)>
+  static Delegate Bind(OBJECT *object);
+
+  /**
+   * @brief Calls the callable, the Delegate mustn't be empty
+   */
+  RETURN operator()(ARGS... args) const
+  {
+    return invoker(storage, args...);
+  }
+
+  /**
+   * @brief Returns true if there is something to call
+   */
+  explicit operator bool() const
+  {
+    return invoker != nullptr;
+  }
+
+  friend bool operator==(const Delegate &delegate, std::nullptr_t)
+  {
+    return delegate.invoker == nullptr;
+  }
+
+  friend bool operator!=(const Delegate &delegate, std::nullptr_t)
+  {
+    return delegate.invoker != nullptr;
+  }
+
+private:
+  using Invoker = RETURN (*)(const void *storage, ARGS... args);
+
+  template <typename CALLABLE>
+  static RETURN invokeCallable(const void *storage, ARGS... args)
+  {
+    return (*static_cast<const CALLABLE *>(storage))(args...);
+  }
+
+  template <typename OBJECT, RETURN (OBJECT::*METHOD)(ARGS...)>
+  static RETURN invokeMember(const void *storage, ARGS... args)
+  {
+    return ((*static_cast<OBJECT *const *>(storage))->*METHOD)(args...);
+  }
+
+  // the callable is trivially copyable, so its bytes are copied in with
+  // memcpy(). GCC 12 at -O2 lost a callable built here with placement new
+  // once the Delegate was copied into a callback table.
+  alignas(void *) unsigned char storage[CAPACITY];
+  Invoker invoker{nullptr}; // calls what is in storage
+};
+
+template <typename RETURN, typename... ARGS, uint32_t CAPACITY>
+Delegate<RETURN(ARGS...), CAPACITY>::Delegate(RETURN (*function)(ARGS...))
+{
+  using Function = RETURN (*)(ARGS...);
+  static_assert(
+    sizeof(Function) <= CAPACITY,
+    "the delegate has no room for a function pointer");
+  if (function != nullptr)
+  {
+    memcpy(storage, &function, sizeof(Function));
+    invoker = &invokeCallable<Function>;
+  }
+}
+
+template <typename RETURN, typename... ARGS, uint32_t CAPACITY>
+template <typename CALLABLE>
+Delegate<RETURN(ARGS...), CAPACITY>::Delegate(const CALLABLE &callable)
+{
+  static_assert(
+    sizeof(CALLABLE) <= CAPACITY,
+    "the callable doesn't fit in the delegate, capture less or pass a pointer "
+    "to the state");
+  static_assert(
+    alignof(CALLABLE) <= alignof(void *),
+    "the callable needs more alignment than the delegate has");
+  static_assert(
+    std::is_trivially_copyable<CALLABLE>::value,
+    "the callable has to be trivially copyable, capture pointers instead of "
+    "objects with destructors");
+  memcpy(storage, &callable, sizeof(CALLABLE));
+  invoker = &invokeCallable<CALLABLE>;
+}
+
+template <typename RETURN, typename... ARGS, uint32_t CAPACITY>
+template <typename OBJECT, RETURN (OBJECT::*METHOD)(ARGS...)>
+Delegate<RETURN(ARGS...), CAPACITY>
+Delegate<RETURN(ARGS...), CAPACITY>::Bind(OBJECT *object)
+{
+  static_assert(
+    sizeof(OBJECT *) <= CAPACITY,
+    "the delegate has no room for an object pointer");
+  Delegate delegate;
+  memcpy(delegate.storage, &object, sizeof(OBJECT *));
+  delegate.invoker = &invokeMember<OBJECT, METHOD>;
+  return delegate;
+}
+} // namespace MESSAGE_INTF
@@ -0,0 +1,427 @@
+/**
+ * @file FdMessage.h
+ * @brief This file contains the FdMessage class
+ * @details This file contains the FdMessage class which parses messages from a
+ * POSIX file descriptor. It works with termios serial ports, ptys, pipes and
+ * sockets so the same parsing code can run on a Linux host without any of the
+ * Arduino headers.
+ * @version 1.0.0
+ */
+
+#pragma once
+
+#include <cerrno>
+#include <fcntl.h>
+#include <csignal>
+#include <ctime>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "Message.h"
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES = 1,
+  typename PROTOCOL = MESSAGE_INTF::AsciiProtocol>
+class FdMessage
+    : public Message<
+        FdMessage<
+          SERIAL_BUFFER_SIZE,
+          MAX_ARGS,
+          MAX_CALLBACKS,
+          MAX_FRAMES,
+          PROTOCOL>,
+        SERIAL_BUFFER_SIZE,
+        MAX_ARGS,
+        MAX_CALLBACKS,
+        MAX_FRAMES,
+        PROTOCOL>
+{
+  friend class Message<
+    FdMessage,
+    SERIAL_BUFFER_SIZE,
+    MAX_ARGS,
+    MAX_CALLBACKS,
+    MAX_FRAMES,
+    PROTOCOL>;
+
+public:
+  /**
+   * @brief Construct a new Fd Message object. The caller keeps ownership of
+   * fd and has to close it.
+   */
+  FdMessage(int fd);
+
+  /**
+   * @brief Initialize the FdMessage object. fd is switched to non-blocking
+   * and, if it is a terminal, to raw mode at baudRate. A baudRate of 0 or one
+   * termios doesn't know leaves the terminal's speed alone.
+   */
+  void Init(uint32_t baudRate) override;
+
+  /**
+   * @brief Prints the args array to the file descriptor
+   */
+  void PrintArgs() override;
+
+  /**
+   * @brief Returns the file descriptor this object reads from, e.g. to wait on
+   * it with poll() or epoll
+   * @return the file descriptor
+   */
+  int GetFd() const;
+
+  /**
+   * @brief Sets the longest a write waits for fd to take more bytes while
+   * the kernel's buffer is full, 100 ms by default. What is left of the
+   * frame once it runs out is dropped.
+   * @param timeoutMs the wait in milliseconds, 0 never waits
+   */
+  void SetWriteTimeout(uint32_t timeoutMs);
+
+  /**
+   * @brief Returns the number of outgoing bytes dropped because fd stayed
+   * full for longer than the write timeout or the other end was gone
+   * @return the number of dropped bytes
+   */
+  uint32_t GetDroppedBytes() const;
+
+protected:
+  /**
+   * @brief reads one byte from the file descriptor
+   * @return the next byte, or '\0' if there was nothing to read
+   */
+  char getChar();
+
+  /**
+   * @brief returns the number of bytes the kernel has buffered for fd
+   * @return the number of bytes available
+   */
+  uint32_t dataAvailable();
+
+  /**
+   * @brief reads up to length bytes with a single non-blocking read()
+   * @return the number of bytes written into buffer, 0 if there was nothing to
+   * read, the other end has closed or the read failed
+   */
+  uint32_t readBytes(char *buffer, uint32_t length);
+
+  /**
+   * @brief writes the whole buffer, waiting up to the write timeout for fd
+   * to become writable whenever the kernel's buffer is full. Never raises
+   * SIGPIPE: sockets are written with MSG_NOSIGNAL, and for pipes SIGPIPE is
+   * blocked during the write and a signal the write raised is taken back.
+   * Terminals report a hung up peer with EIO instead.
+   */
+  void writeBytes(const char *buffer, uint32_t length);
+
+private:
+  /**
+   * @brief Maps a baud rate onto its termios speed
+   * @return the speed, or B0 if termios doesn't have one for baudRate
+   */
+  static speed_t toSpeed(uint32_t baudRate);
+
+  /**
+   * @brief writes buffer until it is all written, the write timeout runs out
+   * or the other end is gone
+   * @return the number of bytes that weren't written
+   */
+  uint32_t writeAll(const char *buffer, uint32_t length);
+
+  int fd{-1};
+  bool isSocket{false}; // sockets are written with MSG_NOSIGNAL
+  bool isPipe{false};   // pipes are written with SIGPIPE blocked
+  uint32_t writeTimeoutMs{100}; // the longest a write waits for room
+  uint32_t droppedBytes{0};     // bytes writeBytes() gave up on
+};
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+FdMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS, MAX_FRAMES, PROTOCOL>::
+  FdMessage(int fd)
+    : fd(fd)
+{
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void
+FdMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS, MAX_FRAMES, PROTOCOL>::
+  Init(uint32_t baudRate)
+{
+  int flags = fcntl(fd, F_GETFL);
+  if (flags >= 0)
+  {
+    fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+  }
+
+  struct stat info;
+  bool isKnown = fstat(fd, &info) == 0;
+  isSocket = isKnown && S_ISSOCK(info.st_mode);
+  isPipe = isKnown && S_ISFIFO(info.st_mode);
+
+  struct termios tty;
+  if (isatty(fd) && tcgetattr(fd, &tty) == 0)
+  {
+    cfmakeraw(&tty);
+    tty.c_cflag |= CLOCAL | CREAD;
+    tty.c_cc[VMIN] = 0;
+    tty.c_cc[VTIME] = 0;
+    speed_t speed = toSpeed(baudRate);
+    if (speed != B0)
+    {
+      cfsetispeed(&tty, speed);
+      cfsetospeed(&tty, speed);
+    }
+    tcsetattr(fd, TCSANOW, &tty);
+  }
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+speed_t
+FdMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS, MAX_FRAMES, PROTOCOL>::
+  toSpeed(uint32_t baudRate)
+{
+  switch (baudRate)
+  {
+  case 9600:
+    return B9600;
+  case 19200:
+    return B19200;
+  case 38400:
+    return B38400;
+  case 57600:
+    return B57600;
+  case 115200:
+    return B115200;
+  case 230400:
+    return B230400;
+#ifdef B460800
+  case 460800:
+    return B460800;
+#endif
+#ifdef B921600
+  case 921600:
+    return B921600;
+#endif
+#ifdef B1000000
+  case 1000000:
+    return B1000000;
+#endif
+#ifdef B2000000
+  case 2000000:
+    return B2000000;
+#endif
+  default:
+    return B0;
+  }
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+int
+FdMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS, MAX_FRAMES, PROTOCOL>::
+  GetFd() const
+{
+  return fd;
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void
+FdMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS, MAX_FRAMES, PROTOCOL>::
+  SetWriteTimeout(uint32_t timeoutMs)
+{
+  writeTimeoutMs = timeoutMs;
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+uint32_t
+FdMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS, MAX_FRAMES, PROTOCOL>::
+  GetDroppedBytes() const
+{
+  return droppedBytes;
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+char
+FdMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS, MAX_FRAMES, PROTOCOL>::
+  getChar()
+{
+  char c = '\0';
+  return this->readBytes(&c, 1) == 1 ? c : '\0';
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+uint32_t
+FdMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS, MAX_FRAMES, PROTOCOL>::
+  dataAvailable()
+{
+  int available = 0;
+  if (ioctl(fd, FIONREAD, &available) != 0 || available < 0)
+  {
+    return 0;
+  }
+  return static_cast<uint32_t>(available);
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+uint32_t
+FdMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS, MAX_FRAMES, PROTOCOL>::
+  readBytes(char *buffer, uint32_t length)
+{
+  ssize_t count = read(fd, buffer, length);
+  while (count < 0 && errno == EINTR)
+  {
+    count = read(fd, buffer, length);
+  }
+  // EAGAIN means the kernel has nothing buffered, EOF and errors are treated
+  // the same way and left for the owner of fd to notice
+  return count > 0 ? static_cast<uint32_t>(count) : 0;
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void
+FdMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS, MAX_FRAMES, PROTOCOL>::
+  writeBytes(const char *buffer, uint32_t length)
+{
+  if (!isPipe)
+  {
+    droppedBytes += writeAll(buffer, length);
+    return;
+  }
+
+  // a pipe whose reader has gone away raises SIGPIPE on this thread, block
+  // it for the write and take back a signal the write raised
+  sigset_t pipeSignal;
+  sigset_t oldMask;
+  sigset_t pending;
+  sigemptyset(&pipeSignal);
+  sigaddset(&pipeSignal, SIGPIPE);
+  pthread_sigmask(SIG_BLOCK, &pipeSignal, &oldMask);
+  sigpending(&pending);
+  bool wasPending = sigismember(&pending, SIGPIPE) == 1;
+
+  errno = 0;
+  droppedBytes += writeAll(buffer, length);
+
+  if (!wasPending && errno == EPIPE)
+  {
+    struct timespec noWait = {0, 0};
+    while (sigtimedwait(&pipeSignal, nullptr, &noWait) < 0 && errno == EINTR)
+    {
+    }
+  }
+  pthread_sigmask(SIG_SETMASK, &oldMask, nullptr);
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+uint32_t
+FdMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS, MAX_FRAMES, PROTOCOL>::
+  writeAll(const char *buffer, uint32_t length)
+{
+  while (length > 0)
+  {
+    ssize_t count = isSocket ? send(fd, buffer, length, MSG_NOSIGNAL)
+                             : write(fd, buffer, length);
+    if (count > 0)
+    {
+      buffer += count;
+      length -= static_cast<uint32_t>(count);
+      continue;
+    }
+    if (count < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+    {
+      // fd is non-blocking, wait a while for the kernel to drain its buffer
+      struct pollfd writable = {fd, POLLOUT, 0};
+      int ready = poll(&writable, 1, static_cast<int>(writeTimeoutMs));
+      while (ready < 0 && errno == EINTR)
+      {
+        ready = poll(&writable, 1, static_cast<int>(writeTimeoutMs));
+      }
+      if (ready > 0)
+      {
+        continue;
+      }
+    }
+    // the reader is too slow or gone, drop the rest of the frame
+    return length;
+  }
+  return 0;
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void
+FdMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS, MAX_FRAMES, PROTOCOL>::
+  PrintArgs()
+{
+  this->printArgs();
+}
@@ -0,0 +1,775 @@
+/**
+ * @file FrameParser.h
+ * @brief This file contains the FrameParser class which turns a stream of
+ * bytes into the args of `!a,b,c;` frames in a single pass
+ * @version 1.0.0
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#include "MESSAGE-INTF.h"
+
+namespace MESSAGE_ASCII
+{
+// the most characters FormatInt() writes, "-2147483648"
+constexpr uint32_t MAX_INT_SIZE = 11;
+
+/**
+ * @brief Returns true if c can be part of a number, a digit or a sign
+ */
+constexpr bool IsNumeric(char c)
+{
+  return (c >= '0' && c <= '9') || c == '-' || c == '+';
+}
+
+/**
+ * @brief Writes value as decimal text, two digits at a time
+ * @return the number of characters written, never more than MAX_INT_SIZE
+ */
+inline uint32_t FormatInt(int32_t value, char *out)
+{
+  static constexpr char DIGIT_PAIRS[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536"
+    "37383940414243444546474849505152535455565758596061626364656667686970717273"
+    "7475767778798081828384858687888990919293949596979899";
+
+  uint32_t length = 0;
+  uint32_t magnitude = static_cast<uint32_t>(value);
+  if (value < 0)
+  {
+    out[length] = '-';
+    length++;
+    magnitude = 0u - magnitude;
+  }
+
+  uint32_t digits = 1;
+  for (uint32_t limit = 10; digits < 10 && magnitude >= limit; limit *= 10)
+  {
+    digits++;
+  }
+  length += digits;
+
+  char *write = out + length;
+  while (magnitude >= 100)
+  {
+    uint32_t pair = (magnitude % 100) * 2;
+    magnitude /= 100;
+    write -= 2;
+    write[0] = DIGIT_PAIRS[pair];
+    write[1] = DIGIT_PAIRS[pair + 1];
+  }
+  if (magnitude >= 10)
+  {
+    write -= 2;
+    write[0] = DIGIT_PAIRS[magnitude * 2];
+    write[1] = DIGIT_PAIRS[magnitude * 2 + 1];
+  }
+  else
+  {
+    write[-1] = static_cast<char>('0' + magnitude);
+  }
+  return length;
+}
+
+// the character between the text of a frame and its checksum, `!1,2,3*EE;`
+constexpr char CHECKSUM_MARKER = '*';
+
+/**
+ * @brief CRC-8/SMBUS (poly 0x07, init 0x00) of length characters. The poly is
+ * x^8 + x^2 + x + 1, so multiplying by x^8 is t ^ t << 1 ^ t << 2 and a byte
+ * takes a few shifts instead of a table.
+ */
+inline uint8_t Crc8(const char *data, uint32_t length)
+{
+  uint8_t crc = 0;
+  for (uint32_t i = 0; i < length; i++)
+  {
+    uint32_t t = crc ^ static_cast<uint8_t>(data[i]);
+    t ^= (t << 1) ^ (t << 2);
+    // fold the two bits that went past bit 7 back in the same way
+    uint32_t high = t >> 8;
+    crc = static_cast<uint8_t>(t ^ high ^ (high << 1) ^ (high << 2));
+  }
+  return crc;
+}
+
+/**
+ * @brief Returns the value of a hex digit in either case, or -1 if c isn't one
+ */
+inline int32_t HexDigit(char c)
+{
+  if (c >= '0' && c <= '9')
+  {
+    return c - '0';
+  }
+  if (c >= 'A' && c <= 'F')
+  {
+    return c - 'A' + 10;
+  }
+  if (c >= 'a' && c <= 'f')
+  {
+    return c - 'a' + 10;
+  }
+  return -1;
+}
+
+/**
+ * @brief Encodes args as a complete frame in DIALECT, `!a,b,c;` for the
+ * default dialect
+ * @param args the args to encode, args[0] is the message ID
+ * @param count the number of args
+ * @param out where to write the frame
+ * @param outSize the size of out
+ * @return the length of the frame, or 0 if it doesn't fit in out. Every arg
+ * needs room for MAX_INT_SIZE characters while it is being written.
+ */
+template <typename DIALECT>
+uint32_t EncodeFrame(
+  const int32_t *args,
+  uint32_t count,
+  char *out,
+  uint32_t outSize)
+{
+  uint32_t length = 0;
+  if (DIALECT::startMarker != '\0')
+  {
+    out[length] = DIALECT::startMarker;
+    length++;
+  }
+  for (uint32_t i = 0; i < count; i++)
+  {
+    // room for the number, its delimiter or endMarker
+    if (length + MAX_INT_SIZE + 1 > outSize)
+    {
+      return 0;
+    }
+    length += FormatInt(args[i], out + length);
+    out[length] = i + 1 < count ? DIALECT::delimiter : DIALECT::endMarker;
+    length++;
+  }
+  if (count == 0)
+  {
+    out[length] = DIALECT::endMarker;
+    length++;
+  }
+  if (DIALECT::checksum)
+  {
+    // put `*XX` in front of the endMarker, the CRC covers the text between
+    // the markers
+    length--;
+    if (length + 4 > outSize)
+    {
+      return 0;
+    }
+    static constexpr char HEX[] = "0123456789ABCDEF";
+    uint8_t crc = Crc8(out + 1, length - 1);
+    out[length] = CHECKSUM_MARKER;
+    out[length + 1] = HEX[crc >> 4];
+    out[length + 2] = HEX[crc & 0x0F];
+    out[length + 3] = DIALECT::endMarker;
+    length += 4;
+  }
+  return length;
+}
+} // namespace MESSAGE_ASCII
+
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, typename DIALECT>
+class FrameParser;
+
+namespace MESSAGE_INTF
+{
+/**
+ * @brief Selects an ASCII wire format for a Message object. The characters
+ * are template arguments so the parser compares against constants and costs
+ * no RAM per object. Define your own dialect with an alias, e.g.
+ * `using NmeaLike = MESSAGE_INTF::AsciiDialect<'$', '\n'>;`
+ * @tparam START_MARKER the character that starts a frame. '\0' means frames
+ * have no start marker and begin with the first character after the last
+ * frame that isn't skipped.
+ * @tparam END_MARKER the character that ends a frame
+ * @tparam DELIMITER the character between args
+ * @tparam SKIP_WHITESPACE if true spaces and tabs around an arg are ignored,
+ * otherwise they make the arg invalid
+ * @tparam SKIP_LINE_ENDINGS if true '\r' and '\n' are ignored in and between
+ * frames (unless one of them is a marker), otherwise they make the arg invalid
+ * @tparam CHECKSUM if true every frame ends in `*XX` before the endMarker, the
+ * CRC-8 of the text between the markers as two hex digits. Frames with a
+ * missing or wrong checksum are dropped, and so are frames that don't fit in
+ * the buffer or that are cut short by a new startMarker.
+ */
+template <
+  char START_MARKER = '!',
+  char END_MARKER = ';',
+  char DELIMITER = ',',
+  bool SKIP_WHITESPACE = true,
+  bool SKIP_LINE_ENDINGS = true,
+  bool CHECKSUM = false>
+struct AsciiDialect
+{
+  static_assert(
+    END_MARKER != START_MARKER && END_MARKER != DELIMITER &&
+      DELIMITER != START_MARKER,
+    "the markers and the delimiter have to be different characters");
+  static_assert(
+    END_MARKER != '\0' && DELIMITER != '\0',
+    "only the start marker can be left out");
+  static_assert(
+    !MESSAGE_ASCII::IsNumeric(START_MARKER) &&
+      !MESSAGE_ASCII::IsNumeric(END_MARKER) &&
+      !MESSAGE_ASCII::IsNumeric(DELIMITER),
+    "digits and signs can't be used as markers or the delimiter");
+  static_assert(
+    !CHECKSUM || START_MARKER != '\0',
+    "checksummed frames need a start marker to resynchronize on");
+  static_assert(
+    !CHECKSUM || (START_MARKER != MESSAGE_ASCII::CHECKSUM_MARKER &&
+                  END_MARKER != MESSAGE_ASCII::CHECKSUM_MARKER &&
+                  DELIMITER != MESSAGE_ASCII::CHECKSUM_MARKER),
+    "the checksum marker can't be used as a marker or the delimiter");
+
+  static constexpr char startMarker = START_MARKER;
+  static constexpr char endMarker = END_MARKER;
+  static constexpr char delimiter = DELIMITER;
+  static constexpr bool skipWhitespace = SKIP_WHITESPACE;
+  static constexpr bool skipLineEndings = SKIP_LINE_ENDINGS;
+  static constexpr bool checksum = CHECKSUM;
+  static constexpr bool rawArgs = false; // args are clamped from the text
+
+  template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS>
+  using Parser = FrameParser<SERIAL_BUFFER_SIZE, MAX_ARGS, AsciiDialect>;
+
+  static uint32_t Encode(
+    const int32_t *args,
+    uint32_t count,
+    char *out,
+    uint32_t outSize)
+  {
+    return MESSAGE_ASCII::EncodeFrame<AsciiDialect>(args, count, out, outSize);
+  }
+};
+
+/**
+ * @brief Selects the `!a,b,c;` ASCII wire format for a Message object. This is
+ * the default.
+ */
+using AsciiProtocol = AsciiDialect<>;
+
+/**
+ * @brief Selects the `!a,b,c*XX;` ASCII wire format, the default one with a
+ * CRC-8 on every frame for noisy links
+ */
+using CheckedAsciiProtocol = AsciiDialect<'!', ';', ',', true, true, true>;
+} // namespace MESSAGE_INTF
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  typename DIALECT = MESSAGE_INTF::AsciiProtocol>
+class FrameParser
+{
+  static_assert(
+    SERIAL_BUFFER_SIZE <= 0x10000, "ArgSpan can't index a buffer this big");
+
+public:
+  /**
+   * @brief Parses bytes until a frame has been completed or the input runs out.
+   * The args of the frame are built as the bytes arrive so there is nothing
+   * left to do once the endMarker is found.
+   * @param buffer the bytes to parse
+   * @param length the number of bytes in buffer
+   * @return the number of bytes consumed, this is less than length if a frame
+   * was completed before the end of the buffer
+   */
+  uint32_t Parse(const char *buffer, uint32_t length);
+
+  /**
+   * @brief Returns true if the last call to Parse() completed a frame
+   * @return true if the last call to Parse() completed a frame
+   */
+  bool IsFrameComplete() const;
+
+  /**
+   * @brief Drops any partially received frame
+   */
+  void Reset();
+
+  /**
+   * @brief Return a pointer to the args of the current frame
+   * @return a pointer to the args of the current frame
+   */
+  const int32_t *GetArgs() const;
+
+  /**
+   * @brief Returns the number of args that have been populated for the current
+   * frame
+   * @return the number of args that have been populated for the current frame
+   */
+  uint32_t GetPopulatedArgs() const;
+
+  /**
+   * @brief Returns true if the current frame had more than MAX_ARGS args.
+   * The extra args are dropped.
+   * @return true if the current frame had more than MAX_ARGS args
+   */
+  bool HasArgOverflow() const;
+
+  /**
+   * @brief Returns the null terminated text of the current frame without its
+   * markers or checksum. Frames longer than SERIAL_BUFFER_SIZE - 1 are
+   * truncated, or dropped if DIALECT has a checksum.
+   * @return the text of the current frame
+   */
+  const char *GetData() const;
+
+  /**
+   * @brief Returns where the text of each arg of the current frame is in
+   * GetData(), so args that don't fit in an int32_t can be read in full
+   * @return GetPopulatedArgs() spans
+   */
+  const MESSAGE_INTF::ArgSpan *GetArgSpans() const;
+
+#ifdef MESSAGE_ENABLE_STATS
+  /**
+   * @brief Returns the counters for the bytes the parser has seen. Only
+   * bytesDiscarded, truncatedFrames, parseErrors, valueOverflows,
+   * checksumErrors and resyncs are filled in. Dropped frames don't add to
+   * parseErrors or valueOverflows.
+   * @return the parser's counters
+   */
+  const MESSAGE_INTF::Stats &GetStats() const;
+
+  /**
+   * @brief Sets every counter back to zero
+   */
+  void ResetStats();
+#endif
+
+private:
+  enum TokenState : uint8_t
+  {
+    TOKEN_EMPTY,      // nothing but delimiters seen yet
+    TOKEN_WHITESPACE, // leading whitespace, the number hasn't started
+    TOKEN_SIGN,       // a leading + or - has been seen
+    TOKEN_DIGITS,     // in the middle of the number
+    TOKEN_DECIMAL,    // past a '.' or an exponent, only the text has the rest
+    TOKEN_DONE        // a non-digit ended the number, ignore the rest
+  };
+
+  /**
+   * @brief Returns true if c is a character DIALECT ignores around args
+   */
+  static constexpr bool isSkipped(char c)
+  {
+    return (DIALECT::skipWhitespace &&
+            (c == ' ' || c == '\t' || c == '\v' || c == '\f')) ||
+           (DIALECT::skipLineEndings && (c == '\r' || c == '\n'));
+  }
+
+  /**
+   * @brief Resets the parser for a new frame
+   */
+  void beginFrame();
+
+  /**
+   * @brief Abandons the current frame, Parse() then skips ahead to the next
+   * startMarker
+   */
+  void dropFrame();
+
+  /**
+   * @brief Returns true if the current frame ends in the right checksum
+   */
+  bool checksumMatches() const;
+
+  /**
+   * @brief Feeds one character of a token into the number being built
+   */
+  void parseChar(char c);
+
+  /**
+   * @brief Stores the number being built into the args array
+   */
+  void commitArg();
+
+  bool inFrame{false};
+  bool frameComplete{false};
+  bool argOverflow{false};
+  TokenState tokenState{TOKEN_EMPTY};
+  bool tokenNegative{false};
+  bool tokenOverflow{false}; // the number doesn't fit in an int32_t
+  uint32_t tokenValue{0};
+  uint32_t tokenStart{0}; // the index in data of the token being built
+  // the index in data of the CHECKSUM_MARKER, SERIAL_BUFFER_SIZE until it
+  // has been seen
+  uint32_t checksumStart{SERIAL_BUFFER_SIZE};
+
+#ifdef MESSAGE_ENABLE_STATS
+  bool frameTruncated{false}; // the current frame didn't fit in data
+  bool tokenInvalid{false};   // the current token has a non-numeric character
+  // the counters when the current frame began, so a dropped frame's bad args
+  // don't count
+  uint32_t frameParseErrors{0};
+  uint32_t frameValueOverflows{0};
+  MESSAGE_INTF::Stats stats{};
+#endif
+
+  char data[SERIAL_BUFFER_SIZE]; // the text of the current frame
+  uint32_t ndx{0};
+  uint32_t populatedArgs{
+    0}; // the number of args that have been populated for the current frame
+  std::array<int32_t, MAX_ARGS> args;
+  std::array<MESSAGE_INTF::ArgSpan, MAX_ARGS> spans; // the text of each arg
+};
+
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, typename DIALECT>
+uint32_t FrameParser<SERIAL_BUFFER_SIZE, MAX_ARGS, DIALECT>::Parse(
+  const char *buffer,
+  uint32_t length)
+{
+  uint32_t i = 0;
+  frameComplete = false;
+  while (i < length)
+  {
+    if (!inFrame && DIALECT::startMarker == '\0')
+    {
+      // without a startMarker the first byte that isn't skipped starts a frame
+      if (isSkipped(buffer[i]))
+      {
+        MESSAGE_STATS_ADD(stats.bytesDiscarded, 1);
+        i++;
+        continue;
+      }
+      beginFrame();
+    }
+    // skip straight to the startMarker, ignoring anything outside of a frame
+    if (!inFrame)
+    {
+      const char *start = static_cast<const char *>(
+        memchr(buffer + i, DIALECT::startMarker, length - i));
+      if (start == nullptr)
+      {
+        MESSAGE_STATS_ADD(stats.bytesDiscarded, length - i);
+        return length;
+      }
+      MESSAGE_STATS_ADD(stats.bytesDiscarded, (start - buffer) - i);
+      i = (start - buffer) + 1;
+      beginFrame();
+      continue;
+    }
+
+    char c = buffer[i];
+    i++;
+    if (c == DIALECT::endMarker)
+    {
+      if (DIALECT::checksum)
+      {
+        if (!checksumMatches())
+        {
+          MESSAGE_STATS_ADD(stats.checksumErrors, 1);
+          MESSAGE_STATS_ADD(stats.bytesDiscarded, 1);
+          dropFrame();
+          continue;
+        }
+        ndx = checksumStart; // GetData() stops before the checksum
+      }
+      data[ndx] = '\0'; // terminate the string
+      commitArg();
+#ifdef MESSAGE_ENABLE_STATS
+      if (frameTruncated)
+      {
+        stats.truncatedFrames++;
+      }
+#endif
+      inFrame = false;
+      frameComplete = true;
+      return i;
+    }
+    // a startMarker inside a checksummed frame means its endMarker was lost,
+    // so start over rather than wait for a checksum that can't match
+    if (DIALECT::checksum && c == DIALECT::startMarker)
+    {
+      MESSAGE_STATS_ADD(stats.resyncs, 1);
+      dropFrame();
+      beginFrame();
+      continue;
+    }
+    // if the frame is bigger than the data array, keep the first
+    // SERIAL_BUFFER_SIZE - 1 characters and drop the rest until the endMarker.
+    // A checksummed frame can't be checked any more, so it is dropped.
+    if (ndx >= SERIAL_BUFFER_SIZE - 1)
+    {
+      if (DIALECT::checksum)
+      {
+        MESSAGE_STATS_ADD(stats.truncatedFrames, 1);
+        MESSAGE_STATS_ADD(stats.bytesDiscarded, 1);
+        dropFrame();
+        continue;
+      }
+#ifdef MESSAGE_ENABLE_STATS
+      frameTruncated = true;
+      stats.bytesDiscarded++;
+#endif
+      continue;
+    }
+    if (DIALECT::checksum)
+    {
+      // the checksum isn't an arg, it is only kept to be checked at the end
+      if (checksumStart != SERIAL_BUFFER_SIZE)
+      {
+        data[ndx] = c;
+        ndx++;
+        continue;
+      }
+      if (c == MESSAGE_ASCII::CHECKSUM_MARKER)
+      {
+        commitArg();
+        checksumStart = ndx;
+        data[ndx] = c;
+        ndx++;
+        continue;
+      }
+    }
+    if (c == DIALECT::delimiter)
+    {
+      commitArg();
+      data[ndx] = c;
+      ndx++;
+      tokenStart = ndx;
+    }
+    else
+    {
+      data[ndx] = c;
+      ndx++;
+      parseChar(c);
+    }
+  }
+  return i;
+}
+
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, typename DIALECT>
+void FrameParser<SERIAL_BUFFER_SIZE, MAX_ARGS, DIALECT>::beginFrame()
+{
+  inFrame = true;
+  argOverflow = false;
+  tokenState = TOKEN_EMPTY;
+  tokenNegative = false;
+  tokenOverflow = false;
+  tokenValue = 0;
+  tokenStart = 0;
+  ndx = 0;
+  populatedArgs = 0;
+  checksumStart = SERIAL_BUFFER_SIZE;
+#ifdef MESSAGE_ENABLE_STATS
+  frameTruncated = false;
+  tokenInvalid = false;
+  frameParseErrors = stats.parseErrors;
+  frameValueOverflows = stats.valueOverflows;
+#endif
+}
+
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, typename DIALECT>
+void FrameParser<SERIAL_BUFFER_SIZE, MAX_ARGS, DIALECT>::dropFrame()
+{
+  inFrame = false;
+#ifdef MESSAGE_ENABLE_STATS
+  stats.bytesDiscarded += ndx + 1; // the startMarker and the text
+  stats.parseErrors = frameParseErrors;
+  stats.valueOverflows = frameValueOverflows;
+#endif
+}
+
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, typename DIALECT>
+bool FrameParser<SERIAL_BUFFER_SIZE, MAX_ARGS, DIALECT>::checksumMatches()
+  const
+{
+  // exactly two hex digits have to follow the CHECKSUM_MARKER
+  if (checksumStart + 3 != ndx)
+  {
+    return false;
+  }
+  int32_t high = MESSAGE_ASCII::HexDigit(data[checksumStart + 1]);
+  int32_t low = MESSAGE_ASCII::HexDigit(data[checksumStart + 2]);
+  return high >= 0 && low >= 0 &&
+         MESSAGE_ASCII::Crc8(data, checksumStart) == ((high << 4) | low);
+}
+
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, typename DIALECT>
+void FrameParser<SERIAL_BUFFER_SIZE, MAX_ARGS, DIALECT>::parseChar(char c)
+{
+  // follows atoi(): leading whitespace, an optional sign, then digits up to
+  // the first character that isn't one
+  if (c >= '0' && c <= '9')
+  {
+    if (tokenState <= TOKEN_DIGITS)
+    {
+      // one more digit can't wrap a uint32_t below this, commitArg() clamps
+      // anything that is still too big for an int32_t
+      if (tokenValue < 214748365u)
+      {
+        tokenValue = tokenValue * 10 + static_cast<uint32_t>(c - '0');
+      }
+      else
+      {
+        tokenOverflow = true;
+      }
+      tokenState = TOKEN_DIGITS;
+    }
+#ifdef MESSAGE_ENABLE_STATS
+    else if (tokenState == TOKEN_DONE)
+    {
+      tokenInvalid = true; // digits after the number has ended are dropped
+    }
+#endif
+    return;
+  }
+
+  // the fraction and exponent of a decimal don't change the integer part
+  if (
+    (c == '.' && tokenState != TOKEN_DONE && tokenState != TOKEN_DECIMAL) ||
+    ((c == 'e' || c == 'E') && tokenState >= TOKEN_DIGITS &&
+     tokenState != TOKEN_DONE) ||
+    ((c == '-' || c == '+') && tokenState == TOKEN_DECIMAL))
+  {
+    tokenState = TOKEN_DECIMAL;
+    return;
+  }
+
+  if (tokenState == TOKEN_EMPTY || tokenState == TOKEN_WHITESPACE)
+  {
+    if (isSkipped(c))
+    {
+      tokenState = TOKEN_WHITESPACE;
+      return;
+    }
+    if (c == '-' || c == '+')
+    {
+      tokenNegative = c == '-';
+      tokenState = TOKEN_SIGN;
+      return;
+    }
+  }
+#ifdef MESSAGE_ENABLE_STATS
+  // trailing whitespace ends a number, anything else makes it non-numeric
+  if (!isSkipped(c) || tokenState == TOKEN_SIGN)
+  {
+    tokenInvalid = true;
+  }
+#endif
+  tokenState = TOKEN_DONE;
+}
+
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, typename DIALECT>
+void FrameParser<SERIAL_BUFFER_SIZE, MAX_ARGS, DIALECT>::commitArg()
+{
+  // empty tokens (",,") don't produce an arg, just like strtok()
+  if (tokenState == TOKEN_EMPTY)
+  {
+    return;
+  }
+
+#ifdef MESSAGE_ENABLE_STATS
+  // a token with no digits at all still counts as 0, like atoi()
+  if (
+    tokenInvalid || tokenState == TOKEN_WHITESPACE ||
+    tokenState == TOKEN_SIGN)
+  {
+    stats.parseErrors++;
+  }
+  tokenInvalid = false;
+#endif
+
+  // numbers that don't fit are clamped like strtol() does, the full value is
+  // still in the text
+  uint32_t limit = tokenNegative ? 0x80000000u : 0x7FFFFFFFu;
+  if (tokenOverflow || tokenValue > limit)
+  {
+    tokenValue = limit;
+    MESSAGE_STATS_ADD(stats.valueOverflows, 1);
+  }
+
+  if (populatedArgs < MAX_ARGS)
+  {
+    uint32_t value = tokenNegative ? 0u - tokenValue : tokenValue;
+    args[populatedArgs] = static_cast<int32_t>(value);
+    spans[populatedArgs] = MESSAGE_INTF::ArgSpan{
+      static_cast<uint16_t>(tokenStart),
+      static_cast<uint16_t>(ndx - tokenStart)};
+    populatedArgs++;
+  }
+  else
+  {
+    argOverflow = true;
+  }
+
+  tokenState = TOKEN_EMPTY;
+  tokenNegative = false;
+  tokenOverflow = false;
+  tokenValue = 0;
+}
+
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, typename DIALECT>
+bool FrameParser<SERIAL_BUFFER_SIZE, MAX_ARGS, DIALECT>::IsFrameComplete() const
+{
+  return frameComplete;
+}
+
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, typename DIALECT>
+void FrameParser<SERIAL_BUFFER_SIZE, MAX_ARGS, DIALECT>::Reset()
+{
+  inFrame = false;
+  frameComplete = false;
+}
+
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, typename DIALECT>
+const int32_t *
+FrameParser<SERIAL_BUFFER_SIZE, MAX_ARGS, DIALECT>::GetArgs() const
+{
+  return args.data();
+}
+
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, typename DIALECT>
+uint32_t
+FrameParser<SERIAL_BUFFER_SIZE, MAX_ARGS, DIALECT>::GetPopulatedArgs() const
+{
+  return populatedArgs;
+}
+
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, typename DIALECT>
+bool FrameParser<SERIAL_BUFFER_SIZE, MAX_ARGS, DIALECT>::HasArgOverflow() const
+{
+  return argOverflow;
+}
+
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, typename DIALECT>
+const char *FrameParser<SERIAL_BUFFER_SIZE, MAX_ARGS, DIALECT>::GetData() const
+{
+  return data;
+}
+
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, typename DIALECT>
+const MESSAGE_INTF::ArgSpan *
+FrameParser<SERIAL_BUFFER_SIZE, MAX_ARGS, DIALECT>::GetArgSpans() const
+{
+  return spans.data();
+}
+
+#ifdef MESSAGE_ENABLE_STATS
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, typename DIALECT>
+const MESSAGE_INTF::Stats &
+FrameParser<SERIAL_BUFFER_SIZE, MAX_ARGS, DIALECT>::GetStats() const
+{
+  return stats;
+}
+
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, typename DIALECT>
+void FrameParser<SERIAL_BUFFER_SIZE, MAX_ARGS, DIALECT>::ResetStats()
+{
+  stats = MESSAGE_INTF::Stats{};
+  frameParseErrors = 0;
+  frameValueOverflows = 0;
+}
+#endif
@@ -1,33 +1,84 @@
 #pragma once
+#include <array>
 #include <cstdint>
 
+#include "Delegate.h"
+
+// Define MESSAGE_ENABLE_STATS (the same way in every file, e.g. with
+// -DMESSAGE_ENABLE_STATS) to have every Message object count what happens to
+// the bytes it receives. Without it the counters don't exist at all.
+#ifdef MESSAGE_ENABLE_STATS
+#define MESSAGE_STATS_ADD(counter, amount) ((counter) += (amount))
+#else
+#define MESSAGE_STATS_ADD(counter, amount)
+#endif
+
 namespace MESSAGE_INTF
 {
-<<<<<<< Updated upstream
-    /**
-     * @brief Callback function type that can be registered to handle new data.
-     * Return true if you're done processing the command.
-     * If you don't return true you have to manually tell the Message class that you're done.
-     */
-    using CallbackFunction = bool (*)(const uint32_t *data, uint32_t length);
-
-    /**
-     * @brief A structure to hold a callback function and the message it is registered for
-     */
-    struct Callback
-    {
-        uint32_t messageID;        // the message that this callback is registered for
-        CallbackFunction function; // the function to call when this message is received
-    };
-}
-=======
 /**
  * @brief Callback function type that can be registered to handle new data.
  * Return true if you're done processing the command.
  * If you don't return true you have to manually tell the Message class that
- * you're done.
+ * you're done. Schema::Bind() makes one of these for a typed handler.
+ */
+using CallbackFunction = bool (*)(const int32_t *data, uint32_t length);
+
+/**
+ * @brief What a Callback calls. Besides a CallbackFunction it can hold a
+ * member function bound with Bind() or a lambda capturing up to two
+ * pointers, so a handler can reach its object without a global.
+ */
+using CallbackDelegate = Delegate<bool(const int32_t *data, uint32_t length)>;
+
+/**
+ * @brief Returns the time in microseconds, e.g. micros(). It may wrap.
  */
-using CallbackFunction = bool (*)(const uint32_t *data, uint32_t length);
+using ClockFunction = uint32_t (*)();
+
+/**
+ * @brief Where the text of one arg is in the text of its frame
+ */
+struct ArgSpan
+{
+  uint16_t start;  // the index of the arg's first character
+  uint16_t length; // the number of characters up to its delimiter
+};
+
+/**
+ * @brief Everything known about the frame being handled. The text is only
+ * there for the ASCII format, it lets handlers read args that don't fit in
+ * an int32_t. Without it the args are only the sender's own bits when rawArgs
+ * is set, an ASCII arg that didn't fit has been clamped.
+ */
+struct FrameView
+{
+  const int32_t *args;  // the args of the frame, args[0] is the message ID
+  uint32_t length;      // the number of args
+  const char *text;     // the text of the frame, nullptr if there is none
+  const ArgSpan *spans; // where each arg is in text, nullptr if no text
+  bool rawArgs;         // the args hold the 32 bits the sender put in them
+};
+
+/**
+ * @brief Callback function type that gets the whole frame instead of just its
+ * args. Return true if you're done processing the command.
+ */
+using FrameFunction = bool (*)(const FrameView &frame);
+
+/**
+ * @brief Something a Message object offers every complete frame to before
+ * its callbacks, e.g. a MessageExecutor resuming the coroutine waiting for
+ * it. Set one with SetFrameSink().
+ */
+class FrameSink
+{
+public:
+  /**
+   * @brief Called with every frame that has a message ID
+   * @return true if the sink took the frame, the callbacks aren't called then
+   */
+  virtual bool Deliver(const FrameView &frame) = 0;
+};
 
 /**
  * @brief A structure to hold a callback function and the message it is
@@ -36,8 +87,98 @@ using CallbackFunction = bool (*)(const uint32_t *data, uint32_t length);
 struct Callback
 {
   uint32_t messageID; // the message that this callback is registered for
-  CallbackFunction
-    function; // the function to call when this message is received
+  CallbackDelegate
+    function; // what to call when this message is received
+  FrameFunction frameFunction; // called instead if function is empty
+};
+
+/**
+ * @brief A parsed frame waiting in a Message object's queue
+ */
+template <uint32_t MAX_ARGS>
+struct Frame
+{
+  std::array<int32_t, MAX_ARGS>
+    args;                 // the args of the frame, args[0] is the message ID
+  uint32_t populatedArgs; // the number of args that have been populated
+  bool argOverflow;       // true if the frame had more than MAX_ARGS args
+  uint32_t sequence;      // counts queued frames, identifies a FrameHandle
+  bool deferred;          // a callback called Defer() for it and holds its
+                          // FrameHandle
+};
+
+/**
+ * @brief Names a queued frame so it can be completed out of order, see
+ * Message::Defer()
+ */
+struct FrameHandle
+{
+  uint32_t sequence; // the sequence of the queued frame
+};
+
+/**
+ * @brief What a Message object does with a frame no callback finished when
+ * there is no room for it in the queue
+ */
+enum OverflowPolicy : uint8_t
+{
+  OVERFLOW_DROP_OLDEST,  // drop the oldest queued frame, the default
+  OVERFLOW_DROP_NEWEST,  // drop the frame that just arrived
+  OVERFLOW_CONFLATE,     // drop the queued frame with the same message ID
+  OVERFLOW_STOP_READING, // leave the bytes in the transport until there is
+                         // room, so its flow control holds the sender off
+};
+
+/**
+ * @brief Counts what a Message object has done with the bytes it received.
+ * Only available when MESSAGE_ENABLE_STATS is defined.
+ */
+struct Stats
+{
+  uint32_t framesCompleted; // frames the parser finished
+  uint32_t bytesDiscarded;  // bytes outside of frames or in dropped frames
+  uint32_t truncatedFrames; // frames that didn't fit in SERIAL_BUFFER_SIZE
+  uint32_t argOverflows;    // frames with more than MAX_ARGS args
+  uint32_t parseErrors;     // non-numeric tokens or corrupt binary frames
+  uint32_t valueOverflows;  // args too big for an int32_t, they're clamped
+  uint32_t unmatchedIDs;    // frames no callback was registered for
+  uint32_t unhandledFrames; // frames whose callbacks all returned false
+  uint32_t framesQueued;    // frames put in the queue for later
+  uint32_t droppedOldest;   // queued frames dropped to make room
+  uint32_t droppedNewest;   // frames dropped because the queue was full
+  uint32_t conflatedFrames; // queued frames replaced by a newer one
+  uint32_t readStalls;      // times reading stopped because the queue was full
+  uint32_t queueHighWater;  // the most frames that were ever queued at once
+  uint32_t framesSent;      // frames Send() encoded
+  uint32_t packetsSent;     // writes handed to the transport
+  uint32_t bytesSent;       // bytes handed to the transport
+  uint32_t txFullFlushes;   // coalesced writes because the buffer was full
+  uint32_t txTimeFlushes;   // coalesced writes because of the deadline
+  uint32_t txForcedFlushes; // coalesced writes because Flush() was called
+  uint32_t checksumErrors;  // ASCII frames dropped for a bad or no checksum
+  uint32_t resyncs;         // ASCII frames dropped for a new startMarker
+};
+
+/**
+ * @brief A signed Qm.n fixed point number, raw is the value times
+ * 2^FRAC_BITS. Use it as a Schema field to have decimal text like `12.5`
+ * converted without going through float.
+ */
+template <uint32_t FRAC_BITS>
+struct Fixed
+{
+  static_assert(FRAC_BITS < 32, "a Fixed has at most 31 fraction bits");
+
+  static constexpr uint32_t fracBits = FRAC_BITS;
+
+  int32_t raw; // the value times 2^FRAC_BITS
+
+  /**
+   * @brief Returns the value as a float
+   */
+  float ToFloat() const
+  {
+    return static_cast<float>(raw) / static_cast<float>(1ull << FRAC_BITS);
+  }
 };
 } // namespace MESSAGE_INTF
->>>>>>> Stashed changes
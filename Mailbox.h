@@ -0,0 +1,155 @@
+/**
+ * @file Mailbox.h
+ * @brief This file contains the Mailbox class which keeps only the newest
+ * frame of one message ID
+ * @details High rate telemetry usually only matters as its latest sample.
+ * A mailbox is only storage for it. Bind() makes an ordinary callback whose
+ * handler overwrites the mailbox, so every frame is still parsed, looked up
+ * in the dispatch table and handed to a delegate like any other. What it
+ * saves is the frame queue and a handler of your own: the consumer reads
+ * the newest sample whenever it gets around to it and sees how many it
+ * missed. The mailbox is a seqlock, so it can be written by a reactor thread
+ * and read by another thread without a mutex.
+ * @version 1.0.0
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include "MESSAGE-INTF.h"
+
+template <uint32_t MAX_ARGS>
+class Mailbox
+{
+public:
+  /**
+   * @brief Returns a callback that stores every frame of messageID in this
+   * mailbox, e.g. `message.RegisterCallback(imu.Bind(42));`. It is
+   * dispatched like any other callback. Don't register another one for
+   * messageID, it would be called too.
+   */
+  MESSAGE_INTF::Callback Bind(uint32_t messageID);
+
+  /**
+   * @brief Replaces the sample with a frame's args. Only one thread may
+   * store into a mailbox.
+   */
+  void Store(const int32_t *args, uint32_t length);
+
+  /**
+   * @brief Copies the newest sample out. It never sees half of a Store()
+   * from another thread, but don't read from an interrupt that can cut into
+   * Store().
+   * @param frame where to copy the sample. Its sequence is the number of
+   * samples stored so far, so it only changes when a new one arrived.
+   * @return false if nothing has been stored yet
+   */
+  bool Read(MESSAGE_INTF::Frame<MAX_ARGS> &frame);
+
+  /**
+   * @brief Returns the number of samples stored so far, e.g. to see if there
+   * is a new one without copying it
+   */
+  uint32_t GetSequence() const;
+
+  /**
+   * @brief Returns the number of samples that were replaced before they were
+   * read. A sample whose Read() was still finishing on another thread when
+   * the next one was stored can be counted too.
+   */
+  uint32_t GetOverwritten() const;
+
+private:
+  // sequence counts up by 2 with every Store() and is odd while one is under
+  // way. A reader that sees it change while copying starts over.
+  std::atomic<uint32_t> sequence{0};
+  std::atomic<uint32_t> readSequence{0}; // the sequence Read() last copied
+  std::atomic<uint32_t> overwritten{0};
+  std::atomic<uint32_t> populatedArgs{0};
+  std::atomic<bool> argOverflow{false};
+  std::array<std::atomic<int32_t>, MAX_ARGS> args{};
+};
+
+template <uint32_t MAX_ARGS>
+MESSAGE_INTF::Callback Mailbox<MAX_ARGS>::Bind(uint32_t messageID)
+{
+  return MESSAGE_INTF::Callback{
+    messageID,
+    [this](const int32_t *frameArgs, uint32_t length)
+    {
+      Store(frameArgs, length);
+      return true;
+    },
+    nullptr};
+}
+
+template <uint32_t MAX_ARGS>
+void Mailbox<MAX_ARGS>::Store(const int32_t *frameArgs, uint32_t length)
+{
+  uint32_t current = sequence.load(std::memory_order_relaxed);
+  if (current != 0 && readSequence.load(std::memory_order_relaxed) != current)
+  {
+    overwritten.store(
+      overwritten.load(std::memory_order_relaxed) + 1,
+      std::memory_order_relaxed);
+  }
+  sequence.store(current + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  uint32_t stored = length < MAX_ARGS ? length : MAX_ARGS;
+  for (uint32_t i = 0; i < stored; i++)
+  {
+    args[i].store(frameArgs[i], std::memory_order_relaxed);
+  }
+  populatedArgs.store(stored, std::memory_order_relaxed);
+  argOverflow.store(length > MAX_ARGS, std::memory_order_relaxed);
+
+  sequence.store(current + 2, std::memory_order_release);
+}
+
+template <uint32_t MAX_ARGS>
+bool Mailbox<MAX_ARGS>::Read(MESSAGE_INTF::Frame<MAX_ARGS> &frame)
+{
+  uint32_t before;
+  uint32_t after;
+  do
+  {
+    before = sequence.load(std::memory_order_acquire);
+    if (before == 0)
+    {
+      return false;
+    }
+    frame.populatedArgs = populatedArgs.load(std::memory_order_relaxed);
+    if (frame.populatedArgs > MAX_ARGS)
+    {
+      frame.populatedArgs = MAX_ARGS;
+    }
+    for (uint32_t i = 0; i < frame.populatedArgs; i++)
+    {
+      frame.args[i] = args[i].load(std::memory_order_relaxed);
+    }
+    frame.argOverflow = argOverflow.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    after = sequence.load(std::memory_order_relaxed);
+  } while ((before & 1) != 0 || before != after);
+
+  readSequence.store(before, std::memory_order_relaxed);
+  frame.sequence = before / 2;
+  frame.deferred = false;
+  return true;
+}
+
+template <uint32_t MAX_ARGS>
+uint32_t Mailbox<MAX_ARGS>::GetSequence() const
+{
+  return sequence.load(std::memory_order_acquire) / 2;
+}
+
+template <uint32_t MAX_ARGS>
+uint32_t Mailbox<MAX_ARGS>::GetOverwritten() const
+{
+  return overwritten.load(std::memory_order_relaxed);
+}
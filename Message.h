@@ -8,458 +8,1545 @@
 
 #pragma once
 
+#include <array>
 #include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "Capture.h"
+#include "FrameParser.h"
 #include "MESSAGE-INTF.h"
+#include "Messageable.h"
 
-<<<<<<< Updated upstream
-template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, uint32_t MAX_CALLBACKS>
-class Message
-=======
+/**
+ * @brief The parser, callback dispatch and frame queue shared by every
+ * transport. TRANSPORT is the transport class deriving from it, e.g.
+ * `class SerialMessage : public Message<SerialMessage<...>, ...>`.
+ */
 template <
+  typename TRANSPORT,
   uint32_t SERIAL_BUFFER_SIZE,
   uint32_t MAX_ARGS,
-  uint32_t MAX_CALLBACKS>
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES = 1,
+  typename PROTOCOL = MESSAGE_INTF::AsciiProtocol>
 class Message : public Messageable
->>>>>>> Stashed changes
 {
+  static_assert(MAX_FRAMES > 0, "Message needs room for at least one frame");
+
 public:
-    /**
-     * @brief Initialize the Message object
-     */
-    virtual void Init(uint32_t baudRate);
-
-    /**
-     * @brief Prints the args array to the serial monitor
-     */
-    virtual void PrintArgs() = 0;
-
-    /**
-     * @brief Update the Message object and parse any data that's available
-     */
-    void Update();
-
-    /**
-     * @brief Returns true if there is new data available
-     * @return true if there is new data available
-     */
-    bool IsNewData();
-
-    /**
-     * @brief Clears the new data flag
-     */
-    void ClearNewData();
-
-    /**
-     * @brief Return a pointer to the args array
-     * @return a pointer to the args array
-     */
-    int32_t *GetArgs();
-
-    /**
-     * @brief Returns the number of args that have been populated for the current message
-     * @return the number of args that have been populated for the current message
-     */
-    uint32_t GetMaxArgs();
-
-    /**
-     * @brief Returns the number of args that have been populated for the current message
-     * @return the number of args that have been populated for the current message
-     */
-    uint32_t GetPopulatedArgs();
-
-    /**
-     * @brief Register a callback function to be called when new data is received
-     */
-    void RegisterCallback(const MESSAGE_INTF::Callback &callback);
+  /**
+   * @brief Initialize the Message object
+   */
+  virtual void Init(uint32_t baudRate) = 0;
+
+  /**
+   * @brief Prints the args array to the serial monitor
+   */
+  virtual void PrintArgs() = 0;
+
+  /**
+   * @brief Update the Message object and parse any data that's available
+   */
+  void Update();
+
+  /**
+   * @brief Returns true if there is a queued frame that hasn't been handled
+   * @return true if there is new data available
+   */
+  bool IsNewData();
+
+  /**
+   * @brief Removes the oldest queued frame
+   */
+  void ClearNewData();
+
+  /**
+   * @brief Return a pointer to the args of the oldest queued frame
+   * @return a pointer to the args array
+   */
+  int32_t *GetArgs();
+
+  /**
+   * @brief Returns the number of args that have been populated for the current
+   * message
+   * @return the number of args that have been populated for the current message
+   */
+  uint32_t GetMaxArgs();
+
+  /**
+   * @brief Returns the number of args that have been populated for the current
+   * message
+   * @return the number of args that have been populated for the current message
+   */
+  uint32_t GetPopulatedArgs();
+
+  /**
+   * @brief Returns true if the current message had more args than MAX_ARGS.
+   * Only the first MAX_ARGS args are kept.
+   * @return true if the current message had more args than MAX_ARGS
+   */
+  bool HasArgOverflow();
+
+  /**
+   * @brief Returns the number of parsed frames that are waiting to be handled
+   * @return the number of parsed frames that are waiting to be handled
+   */
+  uint32_t GetQueuedFrames();
+
+  /**
+   * @brief Copies the oldest queued frame into frame and removes it from the
+   * queue
+   * @return false if there were no queued frames
+   */
+  bool PopFrame(MESSAGE_INTF::Frame<MAX_ARGS> &frame);
+
+  /**
+   * @brief Sets what happens to a frame no callback finished when there is no
+   * room for it in the queue, OVERFLOW_DROP_OLDEST by default. A deferred
+   * frame is never conflated, and is only dropped as the oldest frame.
+   */
+  void SetOverflowPolicy(MESSAGE_INTF::OverflowPolicy policy);
+
+  /**
+   * @brief Returns true if the policy is OVERFLOW_STOP_READING and the queue
+   * is full, no more bytes are parsed until a frame is taken out
+   */
+  bool IsReadingStopped() const
+  {
+    return overflowPolicy == MESSAGE_INTF::OVERFLOW_STOP_READING &&
+           frameCount == MAX_FRAMES;
+  }
+
+  /**
+   * @brief Sets what is called when ClearNewData(), PopFrame(), Complete()
+   * or SetOverflowPolicy() lets reading go on after it stopped, e.g. so a
+   * reactor that stopped watching the link picks it up again. nullptr stops.
+   */
+  void SetResumeHandler(MESSAGE_INTF::Delegate<void()> handler);
+
+  /**
+   * @brief Call from a callback that can't finish its frame yet, then return
+   * false. The frame is queued and stays there until Complete() is called
+   * with the handle, in whatever order frames are completed.
+   * @return the handle the frame will have in the queue, the same one for
+   * every call while the frame is handled
+   */
+  MESSAGE_INTF::FrameHandle Defer();
+
+  /**
+   * @brief Returns the queued frame with handle
+   * @return the frame, nullptr if it was completed or dropped
+   */
+  const MESSAGE_INTF::Frame<MAX_ARGS> *GetFrame(
+    MESSAGE_INTF::FrameHandle handle);
+
+  /**
+   * @brief Removes the frame with handle from the queue
+   * @return false if it isn't queued anymore, e.g. the overflow policy
+   * dropped it
+   */
+  bool Complete(MESSAGE_INTF::FrameHandle handle);
+
+  /**
+   * @brief Register a callback function to be called when new data is received
+   * @return false if MAX_CALLBACKS callbacks have already been registered
+   */
+  bool RegisterCallback(const MESSAGE_INTF::Callback &callback);
+
+  /**
+   * @brief Encodes args as a frame and writes it to the transport in one write
+   * @param args the args to send, args[0] is the message ID
+   * @param count the number of args
+   * @return false if the frame doesn't fit in SERIAL_BUFFER_SIZE bytes
+   */
+  bool Send(const int32_t *args, uint32_t count);
+
+  /**
+   * @brief Sends a frame made up of messageID followed by args, e.g.
+   * Send(12, x, y) sends `!12,x,y;`
+   * @return false if the frame doesn't fit in SERIAL_BUFFER_SIZE bytes
+   */
+  template <typename... ARGS>
+  bool Send(uint32_t messageID, ARGS... args)
+  {
+    const int32_t frame[] = {
+      static_cast<int32_t>(messageID), static_cast<int32_t>(args)...};
+    return Send(frame, sizeof...(ARGS) + 1);
+  }
+
+  /**
+   * @brief Gathers the frames Send() encodes in buffer and hands them to the
+   * transport in one write, so a link like Telnet or Bluetooth sends one
+   * packet for many small frames instead of one each. buffer is written out
+   * when the next frame doesn't fit, when Update() finds its oldest frame has
+   * waited deadlineUs, or when Flush() is called.
+   * @param buffer where frames wait, nullptr writes every frame straight away
+   * again. It has to outlive this object or be replaced first.
+   * @param size the size of buffer
+   * @param clock where the time comes from, e.g. micros
+   * @param deadlineUs the longest a frame waits. 0 writes everything sent
+   * during one Update() at its end.
+   * @return false if buffer was given without a clock. Every frame is then
+   * written straight away, as with a nullptr buffer.
+   */
+  bool SetTxCoalescing(
+    char *buffer,
+    uint32_t size,
+    MESSAGE_INTF::ClockFunction clock,
+    uint32_t deadlineUs);
+
+  /**
+   * @brief Writes the frames gathered for SetTxCoalescing() to the transport
+   * now, e.g. right after an urgent frame
+   */
+  void Flush();
+
+  /**
+   * @brief Hands every chunk of bytes the transport returns to sink before it
+   * is parsed, e.g. a CaptureWriter to record the link. nullptr stops.
+   * @param sink where the chunks go, it has to outlive this object or be
+   * replaced first
+   */
+  void SetCapture(MESSAGE_INTF::CaptureSink *sink);
+
+  /**
+   * @brief Offers every frame that has a message ID to sink before the
+   * callbacks. Frames the sink takes count as handled. nullptr stops.
+   * @param sink where the frames go, it has to outlive this object or be
+   * replaced first
+   */
+  void SetFrameSink(MESSAGE_INTF::FrameSink *sink);
+
+#ifdef MESSAGE_ENABLE_STATS
+  /**
+   * @brief Returns a snapshot of the counters for everything received since
+   * the object was created or ResetStats() was called
+   * @return the counters
+   */
+  MESSAGE_INTF::Stats GetStats();
+
+  /**
+   * @brief Sets every counter back to zero
+   */
+  void ResetStats();
+#endif
 
 protected:
-<<<<<<< Updated upstream
-    enum SerialState : uint8_t
-    {
-        IDLE,
-        NEW_DATA,
-        DATA_RECIEVED,
-        RECIEVE_IN_PROGRESS
-    };
-    Message() = default;
-    /**
-     * @brief reads the serial data and stores it in the data array
-     * @return the next character in the serial buffer
-     */
-    virtual char getChar() = 0;
-=======
-  enum SerialState : uint8_t
-  {
-    IDLE,
-    NEW_DATA,
-    DATA_RECIEVED,
-    RECIEVE_IN_PROGRESS
-  };
+  // the number of bytes pulled from the transport per readBytes() call
+  static constexpr uint32_t RX_CHUNK_SIZE = 64;
+
+  // 1 + the index of a callback, 0 marks the end of a chain or an empty slot
+  using CallbackIndex = typename std::
+    conditional<(MAX_CALLBACKS < 0xFF), uint8_t, uint16_t>::type;
+
+  /**
+   * @brief Returns the smallest power of two that is at least minimum
+   */
+  static constexpr uint32_t powerOfTwo(uint32_t minimum, uint32_t size = 1)
+  {
+    return size >= minimum ? size : powerOfTwo(minimum, size * 2);
+  }
+
+  // the dispatch table is kept at most half full so probes stay short
+  static constexpr uint32_t DISPATCH_SIZE = powerOfTwo(MAX_CALLBACKS * 2);
+
   Message() = default;
+
+  // The transport is TRANSPORT, the class deriving from Message. It is called
+  // through transport() instead of through virtual functions so the compiler
+  // can inline the receive loop into Update(). TRANSPORT has to make Message
+  // a friend and provide
+  //   char getChar(), the next received byte
+  //   uint32_t dataAvailable(), the number of received bytes buffered
+  //   void writeBytes(const char *buffer, uint32_t length), in one write
+  // and can replace the defaults below by declaring functions with the same
+  // names.
+
   /**
-   * @brief reads the serial data and stores it in the data array
-   * @return the next character in the serial buffer
-   */
-  virtual char getChar() = 0;
->>>>>>> Stashed changes
-
-    /**
-     * @brief returns the number of bytes available in the serial buffer
-     * @return the number of bytes available in the serial buffer
-     */
-    virtual uint32_t dataAvailable() = 0;
-
-    /**
-     * @brief Takes in any available serial data and reads it into the buffer if our start character is hit.
-     * Also marks what state the Message object is in
-     */
-    void readSerial();
-
-    /**
-     * @brief Parses the received data and populates the args array
-     */
-    void parseData();
-
-    /**
-     * @brief Call a registered callback function with the received data
-     */
-    void callCallback();
-
-<<<<<<< Updated upstream
-    SerialState state{IDLE};
-    char data[SERIAL_BUFFER_SIZE];      // an array to store the received data
-    char temp_data[SERIAL_BUFFER_SIZE]; // an array that will be used with strtok()
-    uint32_t ndx{0};
-    uint32_t populatedArgs{0}; // the number of args that have been populated for the current message
-    std::array<int32_t, MAX_ARGS> args;
-    const char startMarker = '!';
-    const char endMarker = ';';
-
-    std::array<MESSAGE_INTF::Callback, MAX_CALLBACKS> callbacks; // array of callbacks to be called when new data is received
-    uint32_t numRegisteredCallbacks{0};                          // the number of registered callbacks
-};
+   * @brief Returns this object as its transport
+   */
+  TRANSPORT &transport()
+  {
+    return static_cast<TRANSPORT &>(*this);
+  }
 
-template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, uint32_t MAX_CALLBACKS>
-void Init(uint32_t baudRate)
-{
-    Serial.println("You called Message::Init! This should NEVER happen!");
-}
+  /**
+   * @brief reads up to length bytes from the transport without blocking.
+   * The default implementation falls back to getChar(), transports should
+   * replace it with their driver's bulk read.
+   * @param buffer the buffer to read into
+   * @param length the maximum number of bytes to read
+   * @return the number of bytes written into buffer
+   */
+  uint32_t readBytes(char *buffer, uint32_t length);
 
-template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, uint32_t MAX_CALLBACKS>
-void Message<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::readSerial()
-{
-    char c;
+  /**
+   * @brief returns the oldest received bytes in place, for transports that
+   * already hold them in memory, so they can be parsed without being copied.
+   * The default implementation has none, readBytes() is used instead.
+   * @param length set to the number of bytes returned, 0 if there are none
+   * @return where the bytes start, nullptr if the transport can't do this
+   */
+  const char *peekBytes(uint32_t &length);
 
-    // read the incoming serial data:
-    while (this->dataAvailable() > 0 && this->state != SerialState::DATA_RECIEVED)
-    {
-        // get the neext character in the serial buffer
-        c = this->getChar();
-        // only execute this if the startMarker has been received
-        // if the incoming character is the endMarker clean up and set the flags
-        if (this->state == SerialState::RECIEVE_IN_PROGRESS)
-        {
-            if (c == endMarker)
-            {
-                data[ndx] = '\0'; // terminate the string
-                ndx = 0;
-                this->state = SerialState::DATA_RECIEVED;
-            }
-            // if the incoming character is not the endMarker
-            else
-            {
-                // add it to the data array
-                data[ndx] = c;
-                ndx++; // increment the data array index
-                // if the index is greater than the maximum data array size,
-                // keep overwriting the last element until the endMarker is received.
-                if (ndx >= SERIAL_BUFFER_SIZE)
-                {
-                    ndx = SERIAL_BUFFER_SIZE - 1;
-                }
-            }
-        }
-        // if the incoming character is the startMarker, set the recvInProgress flag
-        else if (c == startMarker)
-        {
-            this->state = SerialState::RECIEVE_IN_PROGRESS;
-=======
-  SerialState state{IDLE};
-  char data[SERIAL_BUFFER_SIZE]; // an array to store the received data
-  char
-    temp_data[SERIAL_BUFFER_SIZE]; // an array that will be used with strtok()
-  uint32_t ndx{0};
-  uint32_t populatedArgs{
-    0}; // the number of args that have been populated for the current message
-  std::array<int32_t, MAX_ARGS> args;
-  const char startMarker = '!';
-  const char endMarker = ';';
+  /**
+   * @brief frees length bytes returned by peekBytes() once they are parsed
+   */
+  void consumeBytes(uint32_t length);
+
+  /**
+   * @brief Writes the args of the oldest queued frame to the transport as
+   * text. The text is built in the TX buffer so it goes out in as few writes
+   * as possible.
+   */
+  void printArgs();
+
+  /**
+   * @brief Takes in all of the available serial data and feeds it to the
+   * parser, handling every frame that gets completed along the way
+   */
+  void readSerial();
+
+  /**
+   * @brief Copies the frame the parser just completed into the frame queue.
+   * If the queue is full the overflow policy decides which frame goes.
+   */
+  void queueFrame();
+
+  /**
+   * @brief Calls the resume handler if reading was stopped before a frame
+   * was taken out or the policy changed, and isn't anymore
+   */
+  void resumeReading(bool wasStopped);
+
+  /**
+   * @brief Finds the queued frame with sequence
+   * @return its position from the oldest frame, frameCount if there is none
+   */
+  uint32_t findFrame(uint32_t sequence);
+
+  /**
+   * @brief Takes the frame at position out of the queue, the newer ones move
+   * up to close the gap
+   */
+  void removeFrame(uint32_t position);
+
+  /**
+   * @brief Finds the oldest queued frame that isn't deferred, with the
+   * message ID of the frame the parser just completed if sameID
+   * @return its position from the oldest frame, frameCount if there is none
+   */
+  uint32_t findDroppable(bool sameID);
+
+  /**
+   * @brief Call the registered callback functions with the frame the parser
+   * just completed
+   * @return true if a callback finished processing the frame
+   */
+  bool callCallback();
+
+  /**
+   * @brief Offers the frame the parser just completed to the frame sink
+   * @return true if the sink took it
+   */
+  bool deliverToSink();
+
+  /**
+   * @brief Writes length bytes to the transport, or adds them to the
+   * coalescing buffer if SetTxCoalescing() set one
+   */
+  void transmit(const char *data, uint32_t length);
+
+  /**
+   * @brief Writes the coalescing buffer to the transport
+   */
+  void flushTx();
+
+  /**
+   * @brief Forgets everything received so far: the partial frame in the
+   * parser, the queued frames and the bytes kept in rxBuffer. For transports
+   * whose peer can change, so a new peer never sees the old one's frames.
+   */
+  void resetReceive();
+
+  /**
+   * @brief Finds the dispatch table slot for messageID. The slot is either the
+   * one holding messageID's callbacks or the empty slot it would go in.
+   * @return the index of the slot in dispatchTable
+   */
+  uint32_t findDispatchSlot(uint32_t messageID);
+
+  typename PROTOCOL::template Parser<SERIAL_BUFFER_SIZE, MAX_ARGS>
+    parser; // builds the args of the incoming frame as its bytes arrive
+
+  std::array<char, SERIAL_BUFFER_SIZE>
+    txBuffer; // outgoing frames are built here before being written
+  char *txQueue{nullptr};    // where sent frames are coalesced, if anywhere
+  uint32_t txQueueSize{0};   // the size of txQueue
+  uint32_t txQueued{0};      // the number of bytes waiting in txQueue
+  uint32_t txFirstMicros{0}; // when the oldest byte in txQueue was added
+  uint32_t txDeadlineUs{0};  // the longest a byte waits in txQueue
+  MESSAGE_INTF::ClockFunction txClock{nullptr}; // the time for txDeadlineUs
+
+  std::array<MESSAGE_INTF::Frame<MAX_ARGS>, MAX_FRAMES>
+    frames;               // parsed frames that no callback has finished with
+  uint32_t frameHead{0};        // the index of the oldest queued frame
+  uint32_t frameCount{0};       // the number of queued frames
+  uint32_t nextSequence{0};     // the sequence the next queued frame gets
+  uint32_t deferredSequence{0}; // the sequence Defer() reserved
+  bool deferPending{false}; // Defer() was called for the frame being handled
+  MESSAGE_INTF::OverflowPolicy overflowPolicy{
+    MESSAGE_INTF::OVERFLOW_DROP_OLDEST}; // what to do when the queue is full
+  MESSAGE_INTF::Delegate<void()>
+    resumeHandler; // told when reading goes on after it stopped
+
+  std::array<char, RX_CHUNK_SIZE>
+    rxBuffer;          // bytes read but not parsed when reading stopped
+  uint32_t rxStart{0};    // the first byte in rxBuffer that hasn't been parsed
+  uint32_t rxEnd{0};      // the end of the bytes kept in rxBuffer
+  uint32_t rxCaptured{0}; // unparsed bytes the capture already has
 
   std::array<MESSAGE_INTF::Callback, MAX_CALLBACKS>
     callbacks; // array of callbacks to be called when new data is received
   uint32_t numRegisteredCallbacks{0}; // the number of registered callbacks
+  std::array<CallbackIndex, DISPATCH_SIZE>
+    dispatchTable{}; // the first callback for each registered message ID
+  std::array<CallbackIndex, MAX_CALLBACKS>
+    nextCallback{}; // the next callback registered for the same message ID
+
+  MESSAGE_INTF::CaptureSink *capture{nullptr}; // gets every received chunk
+  MESSAGE_INTF::FrameSink *frameSink{nullptr}; // sees frames before callbacks
+
+#ifdef MESSAGE_ENABLE_STATS
+  MESSAGE_INTF::Stats stats{}; // the counters the parser doesn't keep itself
+#endif
 };
 
 template <
+  typename TRANSPORT,
   uint32_t SERIAL_BUFFER_SIZE,
   uint32_t MAX_ARGS,
-  uint32_t MAX_CALLBACKS>
-void Message<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::readSerial()
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+uint32_t Message<
+  TRANSPORT,
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::readBytes(char *buffer, uint32_t length)
 {
-  char c;
+  uint32_t count = 0;
+  while (count < length && transport().dataAvailable() > 0)
+  {
+    buffer[count] = transport().getChar();
+    count++;
+  }
+  return count;
+}
 
-  // read the incoming serial data:
-  while (this->dataAvailable() > 0 && this->state != SerialState::DATA_RECIEVED)
+template <
+  typename TRANSPORT,
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+const char *Message<
+  TRANSPORT,
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::peekBytes(uint32_t &length)
+{
+  length = 0;
+  return nullptr;
+}
+
+template <
+  typename TRANSPORT,
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void Message<
+  TRANSPORT,
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::consumeBytes(uint32_t length)
+{
+}
+
+template <
+  typename TRANSPORT,
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void Message<
+  TRANSPORT,
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::readSerial()
+{
+  // parse the bytes in place if the transport holds them in memory, otherwise
+  // read them a chunk at a time. Either way until the transport is dry or
+  // the queue is full and the policy says to stop reading.
+  if (IsReadingStopped())
   {
-    // get the neext character in the serial buffer
-    c = this->getChar();
-    // only execute this if the startMarker has been received
-    // if the incoming character is the endMarker clean up and set the flags
-    if (this->state == SerialState::RECIEVE_IN_PROGRESS)
+    MESSAGE_STATS_ADD(stats.readStalls, 1);
+    return;
+  }
+  char chunk[RX_CHUNK_SIZE];
+  uint32_t rxLength;
+  const char *rxData = transport().peekBytes(rxLength);
+  bool inPlace = rxData != nullptr;
+  if (!inPlace)
+  {
+    // bytes left over from the last time reading stopped go first
+    if (rxStart == rxEnd)
+    {
+      rxLength = transport().readBytes(chunk, RX_CHUNK_SIZE);
+      rxData = chunk;
+    }
+    else
     {
-      if (c == endMarker)
+      rxData = rxBuffer.data() + rxStart;
+      rxLength = rxEnd - rxStart;
+    }
+  }
+  while (rxLength > 0)
+  {
+    // the capture gets the chunk before the parser does. Bytes that were
+    // left over when reading stopped went out with the chunk they came in.
+    if (capture != nullptr && rxLength > rxCaptured)
+    {
+      capture->Record(rxData + rxCaptured, rxLength - rxCaptured);
+    }
+    rxCaptured = 0;
+    uint32_t rxIndex = 0;
+    bool stopped = false;
+    while (rxIndex < rxLength)
+    {
+      rxIndex += parser.Parse(rxData + rxIndex, rxLength - rxIndex);
+      if (!parser.IsFrameComplete())
       {
-        data[ndx] = '\0'; // terminate the string
-        ndx = 0;
-        this->state = SerialState::DATA_RECIEVED;
+        continue;
       }
-      // if the incoming character is not the endMarker
-      else
+#ifdef MESSAGE_ENABLE_STATS
+      stats.framesCompleted++;
+      if (parser.HasArgOverflow())
+      {
+        stats.argOverflows++;
+      }
+#endif
+      deferPending = false;
+      if (!callCallback())
       {
-        // add it to the data array
-        data[ndx] = c;
-        ndx++; // increment the data array index
-        // if the index is greater than the maximum data array size,
-        // keep overwriting the last element until the endMarker is received.
-        if (ndx >= SERIAL_BUFFER_SIZE)
+        queueFrame();
+        stopped = IsReadingStopped();
+        if (stopped)
         {
-          ndx = SERIAL_BUFFER_SIZE - 1;
->>>>>>> Stashed changes
+          break;
         }
+      }
     }
-<<<<<<< Updated upstream
-}
-
-template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, uint32_t MAX_CALLBACKS>
-void Message<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::parseData()
-{                            // split the data into its parts
-    this->populatedArgs = 0; // reset the populated args counter
-    char *indx;              // this is used by strtok() as an index
-    int i = 0;
-    indx = strtok(temp_data, ","); // get the first part - the string
-    while (indx != NULL)
+    if (stopped && capture != nullptr)
     {
-        this->args[i] = atoi(indx);
-        populatedArgs++;
-        i++;
-        indx = strtok(NULL, ","); // this continues where the previous call left off
-=======
-    // if the incoming character is the startMarker, set the recvInProgress flag
-    else if (c == startMarker)
+      rxCaptured = rxLength - rxIndex;
+    }
+    if (inPlace)
+    {
+      transport().consumeBytes(rxIndex);
+      if (stopped)
+      {
+        break;
+      }
+      rxData = transport().peekBytes(rxLength);
+    }
+    else if (stopped)
     {
-      this->state = SerialState::RECIEVE_IN_PROGRESS;
->>>>>>> Stashed changes
+      // keep the rest of the chunk for when the queue has room again. It is
+      // read into the stack so the bytes don't alias the members while they
+      // are parsed.
+      if (rxData == chunk)
+      {
+        rxStart = 0;
+        rxEnd = rxLength - rxIndex;
+        memcpy(rxBuffer.data(), chunk + rxIndex, rxEnd);
+      }
+      else
+      {
+        rxStart += rxIndex;
+      }
+      break;
     }
+    else
+    {
+      rxStart = 0;
+      rxEnd = 0;
+      rxLength = transport().readBytes(chunk, RX_CHUNK_SIZE);
+      rxData = chunk;
+    }
+  }
 }
 
-<<<<<<< Updated upstream
-template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, uint32_t MAX_CALLBACKS>
-void Message<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::Update()
+template <
+  typename TRANSPORT,
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void Message<
+  TRANSPORT,
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::queueFrame()
 {
-    readSerial();
-    if (this->state == SerialState::DATA_RECIEVED)
+  bool deferred = deferPending;
+  deferPending = false;
+  if (frameCount == MAX_FRAMES)
+  {
+    // the position of the queued frame that makes room
+    uint32_t position = 0;
+    if (overflowPolicy == MESSAGE_INTF::OVERFLOW_CONFLATE)
     {
-        strcpy(temp_data, data);
-        // this temporary copy is necessary to protect the original data
-        //   because strtok() used in parseData() replaces the commas with \0
-        parseData();
-        this->state = SerialState::NEW_DATA;
-        callCallback();
+      position = findDroppable(true);
+      if (position < frameCount)
+      {
+        MESSAGE_STATS_ADD(stats.conflatedFrames, 1);
+      }
+      else
+      {
+        position = 0;
+        MESSAGE_STATS_ADD(stats.droppedOldest, 1);
+      }
     }
+    else if (overflowPolicy == MESSAGE_INTF::OVERFLOW_DROP_NEWEST)
+    {
+      // the callback already holds the handle of a deferred frame, so a
+      // queued frame nobody holds goes instead when there is one
+      position = deferred ? findDroppable(false) : frameCount;
+      if (position == frameCount)
+      {
+        MESSAGE_STATS_ADD(stats.droppedNewest, 1);
+        return;
+      }
+      MESSAGE_STATS_ADD(stats.droppedOldest, 1);
+    }
+    else
+    {
+      MESSAGE_STATS_ADD(stats.droppedOldest, 1);
+    }
+    removeFrame(position);
+  }
+
+  MESSAGE_INTF::Frame<MAX_ARGS> &frame =
+    frames[(frameHead + frameCount) % MAX_FRAMES];
+  frame.populatedArgs = parser.GetPopulatedArgs();
+  frame.argOverflow = parser.HasArgOverflow();
+  frame.deferred = deferred;
+  if (deferred)
+  {
+    frame.sequence = deferredSequence;
+  }
+  else
+  {
+    frame.sequence = nextSequence;
+    nextSequence++;
+  }
+  memcpy(
+    frame.args.data(),
+    parser.GetArgs(),
+    frame.populatedArgs * sizeof(int32_t));
+  frameCount++;
+#ifdef MESSAGE_ENABLE_STATS
+  stats.framesQueued++;
+  if (frameCount > stats.queueHighWater)
+  {
+    stats.queueHighWater = frameCount;
+  }
+#endif
 }
 
-template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, uint32_t MAX_CALLBACKS>
-bool Message<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::IsNewData()
+template <
+  typename TRANSPORT,
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void Message<
+  TRANSPORT,
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::Update()
 {
-    return this->state == SerialState::NEW_DATA;
+  readSerial();
+  // after reading, so replies the callbacks sent go out with the rest
+  if (txQueued > 0 && txClock() - txFirstMicros >= txDeadlineUs)
+  {
+    MESSAGE_STATS_ADD(stats.txTimeFlushes, 1);
+    flushTx();
+  }
 }
 
-template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, uint32_t MAX_CALLBACKS>
-void Message<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::ClearNewData()
+template <
+  typename TRANSPORT,
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+bool Message<
+  TRANSPORT,
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::IsNewData()
 {
-    this->state = SerialState::IDLE;
+  return frameCount > 0;
 }
 
-template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, uint32_t MAX_CALLBACKS>
-int32_t *Message<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::GetArgs()
+template <
+  typename TRANSPORT,
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void Message<
+  TRANSPORT,
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::ClearNewData()
 {
-    return args;
+  if (frameCount > 0)
+  {
+    bool wasStopped = IsReadingStopped();
+    frameHead = (frameHead + 1) % MAX_FRAMES;
+    frameCount--;
+    resumeReading(wasStopped);
+  }
 }
 
-template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, uint32_t MAX_CALLBACKS>
-uint32_t Message<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::GetMaxArgs()
+template <
+  typename TRANSPORT,
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+int32_t *Message<
+  TRANSPORT,
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::GetArgs()
 {
-    return MAX_ARGS;
+  return frames[frameHead].args.begin();
 }
 
-template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, uint32_t MAX_CALLBACKS>
-uint32_t Message<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::GetPopulatedArgs()
+template <
+  typename TRANSPORT,
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+uint32_t Message<
+  TRANSPORT,
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::GetMaxArgs()
 {
-    return populatedArgs;
+  return MAX_ARGS;
 }
 
-template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, uint32_t MAX_CALLBACKS>
-void Message<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::RegisterCallback(const MESSAGE_INTF::Callback &callback)
+template <
+  typename TRANSPORT,
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+uint32_t Message<
+  TRANSPORT,
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::GetPopulatedArgs()
 {
-    if (numRegisteredCallbacks < MAX_CALLBACKS)
+  return frameCount > 0 ? frames[frameHead].populatedArgs : 0;
+}
+
+template <
+  typename TRANSPORT,
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+bool Message<
+  TRANSPORT,
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::HasArgOverflow()
+{
+  return frameCount > 0 && frames[frameHead].argOverflow;
+}
+
+template <
+  typename TRANSPORT,
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+uint32_t Message<
+  TRANSPORT,
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::GetQueuedFrames()
+{
+  return frameCount;
+}
+
+template <
+  typename TRANSPORT,
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+bool Message<
+  TRANSPORT,
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::PopFrame(MESSAGE_INTF::Frame<MAX_ARGS> &frame)
+{
+  if (frameCount == 0)
+  {
+    return false;
+  }
+  frame = frames[frameHead];
+  this->ClearNewData();
+  return true;
+}
+
+template <
+  typename TRANSPORT,
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void Message<
+  TRANSPORT,
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::SetOverflowPolicy(MESSAGE_INTF::OverflowPolicy policy)
+{
+  bool wasStopped = IsReadingStopped();
+  overflowPolicy = policy;
+  resumeReading(wasStopped);
+}
+
+template <
+  typename TRANSPORT,
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void Message<
+  TRANSPORT,
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::SetResumeHandler(MESSAGE_INTF::Delegate<void()> handler)
+{
+  resumeHandler = handler;
+}
+
+template <
+  typename TRANSPORT,
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void Message<
+  TRANSPORT,
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::resumeReading(bool wasStopped)
+{
+  if (wasStopped && !IsReadingStopped() && resumeHandler)
+  {
+    resumeHandler();
+  }
+}
+
+template <
+  typename TRANSPORT,
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+MESSAGE_INTF::FrameHandle Message<
+  TRANSPORT,
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::Defer()
+{
+  // the sequence is taken now, so the handle can't name a later frame if
+  // this one is dropped
+  if (!deferPending)
+  {
+    deferPending = true;
+    deferredSequence = nextSequence;
+    nextSequence++;
+  }
+  return MESSAGE_INTF::FrameHandle{deferredSequence};
+}
+
+template <
+  typename TRANSPORT,
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+const MESSAGE_INTF::Frame<MAX_ARGS> *Message<
+  TRANSPORT,
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::GetFrame(MESSAGE_INTF::FrameHandle handle)
+{
+  uint32_t position = findFrame(handle.sequence);
+  return position < frameCount ? &frames[(frameHead + position) % MAX_FRAMES]
+                               : nullptr;
+}
+
+template <
+  typename TRANSPORT,
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+bool Message<
+  TRANSPORT,
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::Complete(MESSAGE_INTF::FrameHandle handle)
+{
+  uint32_t position = findFrame(handle.sequence);
+  if (position == frameCount)
+  {
+    return false;
+  }
+  bool wasStopped = IsReadingStopped();
+  removeFrame(position);
+  resumeReading(wasStopped);
+  return true;
+}
+
+template <
+  typename TRANSPORT,
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+uint32_t Message<
+  TRANSPORT,
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::findFrame(uint32_t sequence)
+{
+  for (uint32_t i = 0; i < frameCount; i++)
+  {
+    if (frames[(frameHead + i) % MAX_FRAMES].sequence == sequence)
     {
-        callbacks[numRegisteredCallbacks] = callback;
-        numRegisteredCallbacks++;
+      return i;
     }
-    else
+  }
+  return frameCount;
+}
+
+template <
+  typename TRANSPORT,
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+uint32_t Message<
+  TRANSPORT,
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::findDroppable(bool sameID)
+{
+  // an empty frame has no message ID to match against
+  if (sameID && parser.GetPopulatedArgs() == 0)
+  {
+    return frameCount;
+  }
+  for (uint32_t i = 0; i < frameCount; i++)
+  {
+    const MESSAGE_INTF::Frame<MAX_ARGS> &queued =
+      frames[(frameHead + i) % MAX_FRAMES];
+    if (queued.deferred)
     {
-        // Handle the case where the maximum number of callbacks has been reached
-        Serial.println("Maximum number of callbacks reached. Cannot register new callback.");
+      continue;
     }
+    if (
+      !sameID ||
+      (queued.populatedArgs > 0 && queued.args[0] == parser.GetArgs()[0]))
+    {
+      return i;
+    }
+  }
+  return frameCount;
 }
 
-template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, uint32_t MAX_CALLBACKS>
-void Message<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::callCallback()
+template <
+  typename TRANSPORT,
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void Message<
+  TRANSPORT,
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::removeFrame(uint32_t position)
 {
-    for (uint32_t i = 0; i < numRegisteredCallbacks; i++)
-    {
-        if (callbacks[i].messageID == this->args[0])
-        { // the first arg is the message ID
-            bool dataProcessed = callbacks[i].function(reinterpret_cast<uint32_t *>(this->args.data()), this->GetPopulatedArgs());
-            if (dataProcessed)
-            {
-                // If the callback function returns true, we can clear the new data flag
-                this->ClearNewData();
-            }
-        }
-=======
+  if (position == 0)
+  {
+    frameHead = (frameHead + 1) % MAX_FRAMES;
+    frameCount--;
+    return;
+  }
+  for (uint32_t i = position; i + 1 < frameCount; i++)
+  {
+    frames[(frameHead + i) % MAX_FRAMES] =
+      frames[(frameHead + i + 1) % MAX_FRAMES];
+  }
+  frameCount--;
+}
+
 template <
+  typename TRANSPORT,
   uint32_t SERIAL_BUFFER_SIZE,
   uint32_t MAX_ARGS,
-  uint32_t MAX_CALLBACKS>
-void Message<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::parseData()
-{                          // split the data into its parts
-  this->populatedArgs = 0; // reset the populated args counter
-  char *indx;              // this is used by strtok() as an index
-  int i = 0;
-  indx = strtok(temp_data, ","); // get the first part - the string
-  while (indx != nullptr)
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+bool Message<
+  TRANSPORT,
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::RegisterCallback(const MESSAGE_INTF::Callback &callback)
+{
+  // the maximum number of callbacks has been reached
+  if (numRegisteredCallbacks >= MAX_CALLBACKS)
   {
-    this->args[i] = atoi(indx);
-    populatedArgs++;
-    i++;
-    indx =
-      strtok(nullptr, ","); // this continues where the previous call left off
+    return false;
   }
+
+  callbacks[numRegisteredCallbacks] = callback;
+  numRegisteredCallbacks++;
+
+  // chain the callback onto the end of its message ID's list so callbacks
+  // are still called in the order they were registered in
+  CallbackIndex index = static_cast<CallbackIndex>(numRegisteredCallbacks);
+  CallbackIndex &slot = dispatchTable[findDispatchSlot(callback.messageID)];
+  if (slot == 0)
+  {
+    slot = index;
+  }
+  else
+  {
+    CallbackIndex last = slot;
+    while (nextCallback[last - 1] != 0)
+    {
+      last = nextCallback[last - 1];
+    }
+    nextCallback[last - 1] = index;
+  }
+  return true;
 }
 
 template <
+  typename TRANSPORT,
   uint32_t SERIAL_BUFFER_SIZE,
   uint32_t MAX_ARGS,
-  uint32_t MAX_CALLBACKS>
-void Message<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::Update()
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+bool Message<
+  TRANSPORT,
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::callCallback()
 {
-  readSerial();
-  if (this->state == SerialState::DATA_RECIEVED)
+  // an empty frame has no message ID to match against
+  if (parser.GetPopulatedArgs() == 0)
   {
-    strcpy(temp_data, data);
-    // this temporary copy is necessary to protect the original data
-    //   because strtok() used in parseData() replaces the commas with \0
-    parseData();
-    this->state = SerialState::NEW_DATA;
-    callCallback();
+    MESSAGE_STATS_ADD(stats.unmatchedIDs, 1);
+    return false;
   }
+
+  const int32_t *args = parser.GetArgs();
+  if (frameSink != nullptr && deliverToSink())
+  {
+    return true;
+  }
+  bool dataProcessed = false;
+  // the first arg is the message ID
+  CallbackIndex index =
+    dispatchTable[findDispatchSlot(static_cast<uint32_t>(args[0]))];
+#ifdef MESSAGE_ENABLE_STATS
+  if (index == 0)
+  {
+    stats.unmatchedIDs++;
+    return false;
+  }
+#endif
+  while (index != 0)
+  {
+    // If the callback function returns true, we're done with the frame
+    const MESSAGE_INTF::Callback &callback = callbacks[index - 1];
+    if (callback.function)
+    {
+      dataProcessed |= callback.function(args, parser.GetPopulatedArgs());
+    }
+    else
+    {
+      dataProcessed |= callback.frameFunction(MESSAGE_INTF::FrameView{
+        args,
+        parser.GetPopulatedArgs(),
+        parser.GetData(),
+        parser.GetArgSpans(),
+        PROTOCOL::rawArgs});
+    }
+    index = nextCallback[index - 1];
+  }
+  MESSAGE_STATS_ADD(stats.unhandledFrames, dataProcessed ? 0 : 1);
+  return dataProcessed;
 }
 
 template <
+  typename TRANSPORT,
   uint32_t SERIAL_BUFFER_SIZE,
   uint32_t MAX_ARGS,
-  uint32_t MAX_CALLBACKS>
-bool Message<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::IsNewData()
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+bool Message<
+  TRANSPORT,
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::deliverToSink()
 {
-  return this->state == SerialState::NEW_DATA;
+  return frameSink->Deliver(MESSAGE_INTF::FrameView{
+    parser.GetArgs(),
+    parser.GetPopulatedArgs(),
+    parser.GetData(),
+    parser.GetArgSpans(),
+    PROTOCOL::rawArgs});
 }
 
 template <
+  typename TRANSPORT,
   uint32_t SERIAL_BUFFER_SIZE,
   uint32_t MAX_ARGS,
-  uint32_t MAX_CALLBACKS>
-void Message<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::ClearNewData()
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+uint32_t Message<
+  TRANSPORT,
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::findDispatchSlot(uint32_t messageID)
 {
-  this->state = SerialState::IDLE;
+  // small message IDs index the table directly, anything bigger is spread
+  // out with a Fibonacci hash. Collisions probe linearly.
+  uint32_t slot = messageID;
+  if (messageID >= DISPATCH_SIZE)
+  {
+    slot = (messageID * 2654435769u) >> 16;
+  }
+  slot &= DISPATCH_SIZE - 1;
+
+  while (dispatchTable[slot] != 0 &&
+         callbacks[dispatchTable[slot] - 1].messageID != messageID)
+  {
+    slot = (slot + 1) & (DISPATCH_SIZE - 1);
+  }
+  return slot;
 }
 
 template <
+  typename TRANSPORT,
   uint32_t SERIAL_BUFFER_SIZE,
   uint32_t MAX_ARGS,
-  uint32_t MAX_CALLBACKS>
-int32_t *Message<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::GetArgs()
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+bool Message<
+  TRANSPORT,
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::Send(const int32_t *args, uint32_t count)
 {
-  return args.begin();
+  uint32_t length =
+    PROTOCOL::Encode(args, count, txBuffer.data(), SERIAL_BUFFER_SIZE);
+  if (length == 0)
+  {
+    return false;
+  }
+  MESSAGE_STATS_ADD(stats.framesSent, 1);
+  transmit(txBuffer.data(), length);
+  return true;
 }
 
 template <
+  typename TRANSPORT,
   uint32_t SERIAL_BUFFER_SIZE,
   uint32_t MAX_ARGS,
-  uint32_t MAX_CALLBACKS>
-uint32_t Message<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::GetMaxArgs()
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+bool Message<
+  TRANSPORT,
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::SetTxCoalescing(
+  char *buffer,
+  uint32_t size,
+  MESSAGE_INTF::ClockFunction clock,
+  uint32_t deadlineUs)
 {
-  return MAX_ARGS;
+  flushTx();
+  // nothing is gathered without a clock, so txClock is only called while
+  // txQueueSize isn't 0
+  bool coalescing = buffer != nullptr && clock != nullptr;
+  txQueue = coalescing ? buffer : nullptr;
+  txQueueSize = coalescing ? size : 0;
+  txClock = clock;
+  txDeadlineUs = deadlineUs;
+  return coalescing || buffer == nullptr;
 }
 
 template <
+  typename TRANSPORT,
   uint32_t SERIAL_BUFFER_SIZE,
   uint32_t MAX_ARGS,
-  uint32_t MAX_CALLBACKS>
-uint32_t
-Message<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::GetPopulatedArgs()
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void Message<
+  TRANSPORT,
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::Flush()
 {
-  return populatedArgs;
+  if (txQueued > 0)
+  {
+    MESSAGE_STATS_ADD(stats.txForcedFlushes, 1);
+    flushTx();
+  }
 }
 
 template <
+  typename TRANSPORT,
   uint32_t SERIAL_BUFFER_SIZE,
   uint32_t MAX_ARGS,
-  uint32_t MAX_CALLBACKS>
-void Message<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::RegisterCallback(
-  const MESSAGE_INTF::Callback &callback)
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void Message<
+  TRANSPORT,
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::transmit(const char *data, uint32_t length)
 {
-  if (numRegisteredCallbacks < MAX_CALLBACKS)
+  if (txQueued + length > txQueueSize || txQueueSize == 0)
   {
-    callbacks[numRegisteredCallbacks] = callback;
-    numRegisteredCallbacks++;
+    if (txQueued > 0)
+    {
+      MESSAGE_STATS_ADD(stats.txFullFlushes, 1);
+      flushTx();
+    }
+    // without a coalescing buffer, or too big for it
+    if (length > txQueueSize || txQueueSize == 0)
+    {
+      MESSAGE_STATS_ADD(stats.packetsSent, 1);
+      MESSAGE_STATS_ADD(stats.bytesSent, length);
+      transport().writeBytes(data, length);
+      return;
+    }
   }
-  else
+  if (txQueued == 0)
   {
-    // Handle the case where the maximum number of callbacks has been reached
-    Serial.println("Maximum number of callbacks reached. Cannot register new "
-                   "callback.");
+    txFirstMicros = txClock();
   }
+  memcpy(txQueue + txQueued, data, length);
+  txQueued += length;
+}
+
+template <
+  typename TRANSPORT,
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void Message<
+  TRANSPORT,
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::flushTx()
+{
+  if (txQueued == 0)
+  {
+    return;
+  }
+  MESSAGE_STATS_ADD(stats.packetsSent, 1);
+  MESSAGE_STATS_ADD(stats.bytesSent, txQueued);
+  transport().writeBytes(txQueue, txQueued);
+  txQueued = 0;
+}
+
+template <
+  typename TRANSPORT,
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void Message<
+  TRANSPORT,
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::resetReceive()
+{
+  parser.Reset();
+  frameHead = 0;
+  frameCount = 0;
+  deferPending = false;
+  rxStart = 0;
+  rxEnd = 0;
+  rxCaptured = 0;
+}
+
+template <
+  typename TRANSPORT,
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void Message<
+  TRANSPORT,
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::SetCapture(MESSAGE_INTF::CaptureSink *sink)
+{
+  capture = sink;
 }
 
 template <
+  typename TRANSPORT,
   uint32_t SERIAL_BUFFER_SIZE,
   uint32_t MAX_ARGS,
-  uint32_t MAX_CALLBACKS>
-void Message<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::callCallback()
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void Message<
+  TRANSPORT,
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::SetFrameSink(MESSAGE_INTF::FrameSink *sink)
 {
-  for (uint32_t i = 0; i < numRegisteredCallbacks; i++)
+  frameSink = sink;
+}
+
+template <
+  typename TRANSPORT,
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void Message<
+  TRANSPORT,
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::printArgs()
+{
+  uint32_t length = 0;
+  // copies text into the TX buffer, writing the buffer out whenever it fills
+  auto append = [this, &length](const char *text, uint32_t count)
   {
-    if (callbacks[i].messageID == this->args[0])
-    { // the first arg is the message ID
-      bool dataProcessed = callbacks[i].function(
-        reinterpret_cast<uint32_t *>(this->args.data()),
-        this->GetPopulatedArgs());
-      if (dataProcessed)
+    while (count > 0)
+    {
+      if (length == SERIAL_BUFFER_SIZE)
       {
-        // If the callback function returns true, we can clear the new data flag
-        this->ClearNewData();
+        transmit(txBuffer.data(), length);
+        length = 0;
       }
->>>>>>> Stashed changes
+      uint32_t piece = SERIAL_BUFFER_SIZE - length;
+      if (piece > count)
+      {
+        piece = count;
+      }
+      memcpy(txBuffer.data() + length, text, piece);
+      length += piece;
+      text += piece;
+      count -= piece;
     }
-}
\ No newline at end of file
+  };
+
+  char number[MESSAGE_ASCII::MAX_INT_SIZE];
+  uint32_t populatedArgs = this->GetPopulatedArgs();
+  append("Current number of args: ", 24);
+  append(
+    number,
+    MESSAGE_ASCII::FormatInt(static_cast<int32_t>(populatedArgs), number));
+  append("\r\n", 2);
+
+  const int32_t *args = this->GetArgs();
+  for (uint32_t i = 0; i < populatedArgs; i++)
+  {
+    append(number, MESSAGE_ASCII::FormatInt(args[i], number));
+    append(" ", 1);
+  }
+  append("\r\n", 2);
+  transmit(txBuffer.data(), length);
+}
+
+#ifdef MESSAGE_ENABLE_STATS
+template <
+  typename TRANSPORT,
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+MESSAGE_INTF::Stats Message<
+  TRANSPORT,
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::GetStats()
+{
+  // the parser counts what happens to the bytes, this object counts what
+  // happens to the frames
+  const MESSAGE_INTF::Stats &parserStats = parser.GetStats();
+  MESSAGE_INTF::Stats snapshot = stats;
+  snapshot.bytesDiscarded = parserStats.bytesDiscarded;
+  snapshot.truncatedFrames = parserStats.truncatedFrames;
+  snapshot.parseErrors = parserStats.parseErrors;
+  snapshot.valueOverflows = parserStats.valueOverflows;
+  snapshot.checksumErrors = parserStats.checksumErrors;
+  snapshot.resyncs = parserStats.resyncs;
+  return snapshot;
+}
+
+template <
+  typename TRANSPORT,
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void Message<
+  TRANSPORT,
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::ResetStats()
+{
+  stats = MESSAGE_INTF::Stats{};
+  parser.ResetStats();
+}
+#endif
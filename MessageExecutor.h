@@ -0,0 +1,435 @@
+/**
+ * @file MessageExecutor.h
+ * @brief This file contains the MessageExecutor class which lets C++20
+ * coroutines on a Linux host wait for messages with `co_await`
+ * @details A coroutine returns MESSAGE_INTF::Task and waits for the next frame
+ * with a message ID with `co_await executor.Next(&message, messageID)`.
+ * The executor polls the file descriptors of its links and updates the ones
+ * that are readable. Every frame a coroutine is waiting for resumes it
+ * straight from Update(), before any callback sees the frame. A request and
+ * its response can then be written one after the other instead of as a state
+ * machine. Everything runs on the thread that calls Run(). The only
+ * allocation is the coroutine frame, the wait itself lives in it.
+ * @version 1.0.0
+ */
+
+#pragma once
+
+#if !defined(__cpp_impl_coroutine) || !__has_include(<coroutine>)
+#error "MessageExecutor.h needs C++20 coroutines, e.g. -std=c++20"
+#endif
+
+#include <array>
+#include <cerrno>
+#include <coroutine>
+#include <cstdint>
+#include <ctime>
+#include <exception>
+#include <poll.h>
+
+#include "Messageable.h"
+
+namespace MESSAGE_INTF
+{
+/**
+ * @brief The return type of a coroutine that waits for messages. It starts
+ * running as soon as it is called and frees its frame when it returns, so
+ * nothing has to hold on to it.
+ */
+struct Task
+{
+  struct promise_type
+  {
+    Task get_return_object()
+    {
+      return Task{};
+    }
+    std::suspend_never initial_suspend() noexcept
+    {
+      return {};
+    }
+    std::suspend_never final_suspend() noexcept
+    {
+      return {};
+    }
+    void return_void() {}
+    void unhandled_exception()
+    {
+      std::terminate();
+    }
+  };
+};
+} // namespace MESSAGE_INTF
+
+template <uint32_t MAX_LINKS, uint32_t MAX_ARGS>
+class MessageExecutor
+{
+  struct Link;
+
+public:
+  /**
+   * @brief What `co_await Next()` waits on. It is kept in the frame of the
+   * coroutine that waits, so waiting allocates nothing.
+   */
+  class NextFrame
+  {
+  public:
+    bool await_ready() const noexcept
+    {
+      return false;
+    }
+
+    /**
+     * @brief Adds the wait behind every other one the executor has
+     */
+    void await_suspend(std::coroutine_handle<> handle);
+
+    /**
+     * @brief Returns the frame that arrived. A wait that timed out returns
+     * a frame with no populatedArgs.
+     */
+    MESSAGE_INTF::Frame<MAX_ARGS> await_resume() const
+    {
+      return frame;
+    }
+
+  private:
+    friend class MessageExecutor;
+
+    NextFrame(
+      MessageExecutor *executor,
+      Messageable *message,
+      uint32_t messageID,
+      int32_t timeoutMs);
+
+    MessageExecutor *executor;
+    Messageable *message;
+    uint32_t messageID;
+    int32_t timeoutMs;
+    uint64_t deadlineNs{0}; // 0 waits for ever
+    std::coroutine_handle<> handle;
+    NextFrame *next{nullptr}; // the next wait, in the order they started
+    MESSAGE_INTF::Frame<MAX_ARGS> frame{};
+  };
+
+  MessageExecutor() = default;
+
+  /**
+   * @brief Unhooks the links and frees the frames of the coroutines that are
+   * still waiting
+   */
+  ~MessageExecutor();
+
+  MessageExecutor(const MessageExecutor &) = delete;
+  MessageExecutor &operator=(const MessageExecutor &) = delete;
+
+  /**
+   * @brief Adds a link to the executor. It takes the link's frame sink.
+   * @param link the Message object to update
+   * @param fd the file descriptor link reads from, e.g. FdMessage::GetFd()
+   * @return false if MAX_LINKS links are registered
+   */
+  template <typename MESSAGE>
+  bool Register(MESSAGE *link, int fd);
+
+  /**
+   * @brief Returns something to `co_await` for the next frame with
+   * messageID on link. Coroutines waiting for the same message get its
+   * frames in the order they started waiting, one frame each.
+   * @param link a registered link
+   * @param messageID the message to wait for
+   * @param timeoutMs how long to wait before giving up, -1 waits for ever
+   */
+  NextFrame Next(Messageable *link, uint32_t messageID, int32_t timeoutMs = -1);
+
+  /**
+   * @brief Waits until a link is readable or a wait times out, up to
+   * timeoutMs, then updates the readable links and resumes the timed out
+   * coroutines
+   * @param timeoutMs the longest to wait, -1 waits until something happens
+   * @return false if nothing can happen anymore, i.e. every link has hung
+   * up and no wait has a timeout, or poll() failed
+   */
+  bool RunOnce(int32_t timeoutMs);
+
+  /**
+   * @brief Keeps running until no coroutine is waiting anymore
+   */
+  void Run();
+
+  /**
+   * @brief Returns the number of coroutines waiting for a frame
+   */
+  uint32_t GetWaitingCount() const;
+
+private:
+  /**
+   * @brief Gets the frames of one link and resumes the coroutines waiting
+   * for them
+   */
+  struct Link : public MESSAGE_INTF::FrameSink
+  {
+    bool Deliver(const MESSAGE_INTF::FrameView &frame) override;
+
+    MessageExecutor *executor{nullptr};
+    Messageable *message{nullptr};
+    // the link's SetFrameSink(), which Messageable doesn't have
+    MESSAGE_INTF::Delegate<void(MESSAGE_INTF::FrameSink *)> setFrameSink;
+    int fd{-1};
+    bool hungUp{false}; // the other end closed, fd isn't polled anymore
+  };
+
+  /**
+   * @brief Takes the oldest wait that matches out of the list
+   * @return the wait, nullptr if none matched
+   */
+  NextFrame *take(const Messageable *message, uint32_t messageID);
+
+  /**
+   * @brief Resumes the coroutines whose wait has timed out
+   */
+  void expire(uint64_t now);
+
+  static uint64_t nowNs();
+
+  std::array<Link, MAX_LINKS> links;
+  uint32_t linkCount{0};
+  NextFrame *waiting{nullptr}; // the oldest wait
+};
+
+template <uint32_t MAX_LINKS, uint32_t MAX_ARGS>
+MessageExecutor<MAX_LINKS, MAX_ARGS>::NextFrame::NextFrame(
+  MessageExecutor *executor,
+  Messageable *message,
+  uint32_t messageID,
+  int32_t timeoutMs)
+    : executor(executor),
+      message(message),
+      messageID(messageID),
+      timeoutMs(timeoutMs)
+{
+}
+
+template <uint32_t MAX_LINKS, uint32_t MAX_ARGS>
+void MessageExecutor<MAX_LINKS, MAX_ARGS>::NextFrame::await_suspend(
+  std::coroutine_handle<> handle)
+{
+  this->handle = handle;
+  if (timeoutMs >= 0)
+  {
+    // the deadline is never 0, that means no deadline
+    deadlineNs = nowNs() + static_cast<uint64_t>(timeoutMs) * 1000000 + 1;
+  }
+  NextFrame **last = &executor->waiting;
+  while (*last != nullptr)
+  {
+    last = &(*last)->next;
+  }
+  *last = this;
+}
+
+template <uint32_t MAX_LINKS, uint32_t MAX_ARGS>
+MessageExecutor<MAX_LINKS, MAX_ARGS>::~MessageExecutor()
+{
+  for (uint32_t i = 0; i < linkCount; i++)
+  {
+    links[i].setFrameSink(nullptr);
+  }
+  while (waiting != nullptr)
+  {
+    // the wait is part of the frame that is freed
+    NextFrame *wait = waiting;
+    waiting = wait->next;
+    wait->handle.destroy();
+  }
+}
+
+template <uint32_t MAX_LINKS, uint32_t MAX_ARGS>
+template <typename MESSAGE>
+bool MessageExecutor<MAX_LINKS, MAX_ARGS>::Register(MESSAGE *link, int fd)
+{
+  if (linkCount == MAX_LINKS)
+  {
+    return false;
+  }
+  Link &added = links[linkCount];
+  added.executor = this;
+  added.message = link;
+  added.setFrameSink = [link](MESSAGE_INTF::FrameSink *sink)
+  { link->SetFrameSink(sink); };
+  added.fd = fd;
+  link->SetFrameSink(&added);
+  linkCount++;
+  return true;
+}
+
+template <uint32_t MAX_LINKS, uint32_t MAX_ARGS>
+typename MessageExecutor<MAX_LINKS, MAX_ARGS>::NextFrame
+MessageExecutor<MAX_LINKS, MAX_ARGS>::Next(
+  Messageable *link,
+  uint32_t messageID,
+  int32_t timeoutMs)
+{
+  return NextFrame(this, link, messageID, timeoutMs);
+}
+
+template <uint32_t MAX_LINKS, uint32_t MAX_ARGS>
+bool MessageExecutor<MAX_LINKS, MAX_ARGS>::RunOnce(int32_t timeoutMs)
+{
+  std::array<struct pollfd, MAX_LINKS> fds;
+  std::array<Link *, MAX_LINKS> polled{};
+  nfds_t fdCount = 0;
+  for (uint32_t i = 0; i < linkCount; i++)
+  {
+    if (!links[i].hungUp)
+    {
+      fds[fdCount] = {links[i].fd, POLLIN, 0};
+      polled[fdCount] = &links[i];
+      fdCount++;
+    }
+  }
+
+  uint64_t deadline = 0;
+  for (NextFrame *wait = waiting; wait != nullptr; wait = wait->next)
+  {
+    if (wait->deadlineNs != 0 && (deadline == 0 || wait->deadlineNs < deadline))
+    {
+      deadline = wait->deadlineNs;
+    }
+  }
+  if (fdCount == 0 && deadline == 0)
+  {
+    return false;
+  }
+  if (deadline != 0)
+  {
+    uint64_t now = nowNs();
+    // round up so a wake up is never early
+    int32_t untilDeadline = 0;
+    if (deadline > now)
+    {
+      untilDeadline = static_cast<int32_t>((deadline - now + 999999) / 1000000);
+    }
+    if (timeoutMs < 0 || untilDeadline < timeoutMs)
+    {
+      timeoutMs = untilDeadline;
+    }
+  }
+
+  int ready = poll(fds.data(), fdCount, timeoutMs);
+  if (ready < 0 && errno != EINTR)
+  {
+    return false;
+  }
+  for (nfds_t i = 0; i < fdCount && ready > 0; i++)
+  {
+    if (fds[i].revents == 0)
+    {
+      continue;
+    }
+    ready--;
+    // read whatever arrived before a hang up too
+    polled[i]->message->Update();
+    if ((fds[i].revents & (POLLHUP | POLLERR | POLLNVAL)) != 0)
+    {
+      polled[i]->hungUp = true;
+    }
+  }
+  if (deadline != 0)
+  {
+    expire(nowNs());
+  }
+  return true;
+}
+
+template <uint32_t MAX_LINKS, uint32_t MAX_ARGS>
+void MessageExecutor<MAX_LINKS, MAX_ARGS>::Run()
+{
+  while (waiting != nullptr && RunOnce(-1))
+  {
+  }
+}
+
+template <uint32_t MAX_LINKS, uint32_t MAX_ARGS>
+uint32_t MessageExecutor<MAX_LINKS, MAX_ARGS>::GetWaitingCount() const
+{
+  uint32_t count = 0;
+  for (const NextFrame *wait = waiting; wait != nullptr; wait = wait->next)
+  {
+    count++;
+  }
+  return count;
+}
+
+template <uint32_t MAX_LINKS, uint32_t MAX_ARGS>
+bool MessageExecutor<MAX_LINKS, MAX_ARGS>::Link::Deliver(
+  const MESSAGE_INTF::FrameView &frame)
+{
+  NextFrame *wait =
+    executor->take(message, static_cast<uint32_t>(frame.args[0]));
+  if (wait == nullptr)
+  {
+    return false;
+  }
+  uint32_t length = frame.length < MAX_ARGS ? frame.length : MAX_ARGS;
+  for (uint32_t i = 0; i < length; i++)
+  {
+    wait->frame.args[i] = frame.args[i];
+  }
+  wait->frame.populatedArgs = length;
+  wait->frame.argOverflow = frame.length > MAX_ARGS;
+  // the coroutine runs until its next co_await before the next frame is
+  // parsed, so a wait it starts then sees that frame
+  wait->handle.resume();
+  return true;
+}
+
+template <uint32_t MAX_LINKS, uint32_t MAX_ARGS>
+typename MessageExecutor<MAX_LINKS, MAX_ARGS>::NextFrame *
+MessageExecutor<MAX_LINKS, MAX_ARGS>::take(
+  const Messageable *message,
+  uint32_t messageID)
+{
+  for (NextFrame **wait = &waiting; *wait != nullptr; wait = &(*wait)->next)
+  {
+    if ((*wait)->message == message && (*wait)->messageID == messageID)
+    {
+      NextFrame *taken = *wait;
+      *wait = taken->next;
+      return taken;
+    }
+  }
+  return nullptr;
+}
+
+template <uint32_t MAX_LINKS, uint32_t MAX_ARGS>
+void MessageExecutor<MAX_LINKS, MAX_ARGS>::expire(uint64_t now)
+{
+  // a resumed coroutine can change the list, so start over after each one
+  bool resumed = true;
+  while (resumed)
+  {
+    resumed = false;
+    for (NextFrame **wait = &waiting; *wait != nullptr; wait = &(*wait)->next)
+    {
+      NextFrame *expired = *wait;
+      if (expired->deadlineNs != 0 && expired->deadlineNs <= now)
+      {
+        *wait = expired->next;
+        expired->frame.populatedArgs = 0;
+        expired->handle.resume();
+        resumed = true;
+        break;
+      }
+    }
+  }
+}
+
+template <uint32_t MAX_LINKS, uint32_t MAX_ARGS>
+uint64_t MessageExecutor<MAX_LINKS, MAX_ARGS>::nowNs()
+{
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return static_cast<uint64_t>(time.tv_sec) * 1000000000 +
+         static_cast<uint64_t>(time.tv_nsec);
+}
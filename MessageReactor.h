@@ -0,0 +1,426 @@
+/**
+ * @file MessageReactor.h
+ * @brief This file contains the MessageReactor class which services many
+ * Message objects on a Linux host. Instead of calling Update() on every link
+ * in a loop, reactor threads sleep in epoll and only update the links whose
+ * file descriptors became readable.
+ * @version 1.0.0
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <ctime>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <thread>
+#include <unistd.h>
+
+#include "Messageable.h"
+
+namespace MESSAGE_INTF
+{
+/**
+ * @brief How long a reactor spent servicing one link
+ */
+struct LinkStats
+{
+  uint64_t updates;       // the number of times Update() was called
+  uint64_t totalUpdateNs; // the wall time spent in Update()
+  uint64_t maxUpdateNs;   // the longest single Update()
+  uint64_t maxWaitNs;     // the longest from epoll_wait() returning to
+                          // Update(), without the time before the wakeup
+  bool hungUp;            // the other end closed, the link isn't watched
+};
+} // namespace MESSAGE_INTF
+
+template <uint32_t MAX_LINKS, uint32_t MAX_THREADS>
+class MessageReactor
+{
+public:
+  MessageReactor();
+  ~MessageReactor();
+
+  /**
+   * @brief Adds a link to the reactor. Links can be added while it is running.
+   * While the link's queue is full and its policy is OVERFLOW_STOP_READING,
+   * fd isn't watched. The link goes back to the reactor when a frame is taken
+   * out with ClearNewData(), PopFrame() or Complete(). Outside of its
+   * callbacks, only do that while IsReadingStopped() is true.
+   * @param link the Message object to update, its resume handler is taken
+   * @param fd the file descriptor link reads from, e.g. FdMessage::GetFd()
+   * @return false if MAX_LINKS links are registered or epoll refused fd
+   */
+  template <typename MESSAGE>
+  bool Register(MESSAGE *link, int fd);
+
+  /**
+   * @brief Starts threadCount reactor threads. Every thread waits on the same
+   * epoll set, so whichever thread is idle picks up the next readable link
+   * and a slow link never holds up the others.
+   * @return false if the reactor couldn't be set up or is already running
+   */
+  bool Start(uint32_t threadCount);
+
+  /**
+   * @brief Wakes every reactor thread up and waits for them to exit
+   */
+  void Stop();
+
+  /**
+   * @brief Returns the number of registered links
+   * @return the number of registered links
+   */
+  uint32_t GetLinkCount() const;
+
+  /**
+   * @brief Returns a snapshot of how long the reactor spent on a link
+   * @param index the order the link was registered in
+   */
+  MESSAGE_INTF::LinkStats GetLinkStats(uint32_t index) const;
+
+  /**
+   * @brief Returns the CPU time a reactor thread has used so far, measured
+   * with CLOCK_THREAD_CPUTIME_ID by the thread itself
+   * @param thread the index of the thread, less than the count passed to
+   * Start()
+   */
+  uint64_t GetThreadCpuNs(uint32_t thread) const;
+
+private:
+  struct Link
+  {
+    Messageable *message{nullptr};
+    MESSAGE_INTF::Delegate<bool()> isStopped; // the link's IsReadingStopped()
+    int fd{-1};
+    std::atomic<bool> parked{false};  // not watched while reading is stopped
+    std::atomic<bool> resumed{false}; // waiting for a thread to update it
+    std::atomic<uint64_t> updates{0};
+    std::atomic<uint64_t> totalUpdateNs{0};
+    std::atomic<uint64_t> maxUpdateNs{0};
+    std::atomic<uint64_t> maxWaitNs{0};
+    std::atomic<bool> hungUp{false};
+  };
+
+  /**
+   * @brief The loop each reactor thread runs until Stop() is called
+   */
+  void run(uint32_t thread);
+
+  /**
+   * @brief Updates one readable link and hands it back to epoll, unless its
+   * reading stopped
+   */
+  void service(Link &link, uint32_t events, uint64_t readyNs);
+
+  /**
+   * @brief Called through a parked link's resume handler. Queues the link for
+   * an Update() even if fd has nothing new, since the link may still hold
+   * bytes it read before it stopped.
+   */
+  void resume(Link &link);
+
+  /**
+   * @brief Updates every link resume() queued
+   */
+  void serviceResumed(uint64_t readyNs);
+
+  static uint64_t nowNs(clockid_t clock);
+
+  // the events every link is watched for. EPOLLONESHOT hands a readable
+  // link to exactly one thread until that thread re-arms it, so Update() is
+  // never called on one link from two threads at once.
+  static constexpr uint32_t LINK_EVENTS =
+    EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+  // the most events one thread takes from epoll per wait. Kept small so a
+  // burst of readable links is spread over every idle thread.
+  static constexpr int MAX_EVENTS = 4;
+  // what the eventfds put in epoll_event::data, the links use their index
+  static constexpr uint64_t STOP_EVENT = MAX_LINKS;
+  static constexpr uint64_t RESUME_EVENT = MAX_LINKS + 1;
+
+  int epollFd{-1};
+  int stopFd{-1};   // an eventfd that wakes every thread up on Stop()
+  int resumeFd{-1}; // an eventfd that wakes a thread up for resumed links
+
+  std::array<Link, MAX_LINKS> links;
+  std::atomic<uint32_t> linkCount{0};
+
+  std::array<std::thread, MAX_THREADS> threads;
+  std::array<std::atomic<uint64_t>, MAX_THREADS> threadCpuNs{};
+  uint32_t threadCount{0};
+};
+
+template <uint32_t MAX_LINKS, uint32_t MAX_THREADS>
+MessageReactor<MAX_LINKS, MAX_THREADS>::MessageReactor()
+{
+  epollFd = epoll_create1(EPOLL_CLOEXEC);
+  stopFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  resumeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (epollFd >= 0 && stopFd >= 0 && resumeFd >= 0)
+  {
+    // level triggered and never re-armed so it wakes every thread
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = STOP_EVENT;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, stopFd, &event);
+    // one thread at a time looks for resumed links
+    event.events = EPOLLIN | EPOLLONESHOT;
+    event.data.u64 = RESUME_EVENT;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, resumeFd, &event);
+  }
+}
+
+template <uint32_t MAX_LINKS, uint32_t MAX_THREADS>
+MessageReactor<MAX_LINKS, MAX_THREADS>::~MessageReactor()
+{
+  Stop();
+  if (epollFd >= 0)
+  {
+    close(epollFd);
+  }
+  if (stopFd >= 0)
+  {
+    close(stopFd);
+  }
+  if (resumeFd >= 0)
+  {
+    close(resumeFd);
+  }
+}
+
+template <uint32_t MAX_LINKS, uint32_t MAX_THREADS>
+template <typename MESSAGE>
+bool MessageReactor<MAX_LINKS, MAX_THREADS>::Register(MESSAGE *link, int fd)
+{
+  uint32_t index = linkCount.load();
+  if (epollFd < 0 || index >= MAX_LINKS)
+  {
+    return false;
+  }
+
+  Link *entry = &links[index];
+  entry->message = link;
+  entry->isStopped = [link]() { return link->IsReadingStopped(); };
+  entry->fd = fd;
+  MessageReactor *reactor = this;
+  link->SetResumeHandler([reactor, entry]() { reactor->resume(*entry); });
+  struct epoll_event event = {};
+  event.events = LINK_EVENTS;
+  event.data.u64 = index;
+  if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) != 0)
+  {
+    return false;
+  }
+  linkCount.store(index + 1);
+  return true;
+}
+
+template <uint32_t MAX_LINKS, uint32_t MAX_THREADS>
+bool MessageReactor<MAX_LINKS, MAX_THREADS>::Start(uint32_t threadCount)
+{
+  if (
+    epollFd < 0 || stopFd < 0 || resumeFd < 0 || this->threadCount != 0 ||
+    threadCount == 0 || threadCount > MAX_THREADS)
+  {
+    return false;
+  }
+
+  this->threadCount = threadCount;
+  for (uint32_t i = 0; i < threadCount; i++)
+  {
+    threads[i] = std::thread(&MessageReactor::run, this, i);
+  }
+  return true;
+}
+
+template <uint32_t MAX_LINKS, uint32_t MAX_THREADS>
+void MessageReactor<MAX_LINKS, MAX_THREADS>::Stop()
+{
+  if (threadCount == 0)
+  {
+    return;
+  }
+
+  uint64_t one = 1;
+  ssize_t written = write(stopFd, &one, sizeof(one));
+  (void)written;
+  for (uint32_t i = 0; i < threadCount; i++)
+  {
+    threads[i].join();
+  }
+  threadCount = 0;
+
+  // drain the eventfd so the reactor can be started again
+  uint64_t count;
+  ssize_t drained = read(stopFd, &count, sizeof(count));
+  (void)drained;
+}
+
+template <uint32_t MAX_LINKS, uint32_t MAX_THREADS>
+uint32_t MessageReactor<MAX_LINKS, MAX_THREADS>::GetLinkCount() const
+{
+  return linkCount.load();
+}
+
+template <uint32_t MAX_LINKS, uint32_t MAX_THREADS>
+MESSAGE_INTF::LinkStats
+MessageReactor<MAX_LINKS, MAX_THREADS>::GetLinkStats(uint32_t index) const
+{
+  const Link &link = links[index];
+  MESSAGE_INTF::LinkStats stats;
+  stats.updates = link.updates.load(std::memory_order_relaxed);
+  stats.totalUpdateNs = link.totalUpdateNs.load(std::memory_order_relaxed);
+  stats.maxUpdateNs = link.maxUpdateNs.load(std::memory_order_relaxed);
+  stats.maxWaitNs = link.maxWaitNs.load(std::memory_order_relaxed);
+  stats.hungUp = link.hungUp.load(std::memory_order_relaxed);
+  return stats;
+}
+
+template <uint32_t MAX_LINKS, uint32_t MAX_THREADS>
+uint64_t
+MessageReactor<MAX_LINKS, MAX_THREADS>::GetThreadCpuNs(uint32_t thread) const
+{
+  return threadCpuNs[thread].load(std::memory_order_relaxed);
+}
+
+template <uint32_t MAX_LINKS, uint32_t MAX_THREADS>
+void MessageReactor<MAX_LINKS, MAX_THREADS>::run(uint32_t thread)
+{
+  struct epoll_event events[MAX_EVENTS];
+  while (true)
+  {
+    int count = epoll_wait(epollFd, events, MAX_EVENTS, -1);
+    uint64_t readyNs = nowNs(CLOCK_MONOTONIC);
+    if (count < 0 && errno != EINTR)
+    {
+      break;
+    }
+
+    bool stopping = false;
+    for (int i = 0; i < count; i++)
+    {
+      uint64_t index = events[i].data.u64;
+      if (index == STOP_EVENT)
+      {
+        stopping = true;
+        continue;
+      }
+      if (index == RESUME_EVENT)
+      {
+        serviceResumed(readyNs);
+        continue;
+      }
+      service(links[index], events[i].events, readyNs);
+    }
+    threadCpuNs[thread].store(
+      nowNs(CLOCK_THREAD_CPUTIME_ID), std::memory_order_relaxed);
+    if (stopping)
+    {
+      break;
+    }
+  }
+}
+
+template <uint32_t MAX_LINKS, uint32_t MAX_THREADS>
+void MessageReactor<MAX_LINKS, MAX_THREADS>::service(
+  Link &link,
+  uint32_t events,
+  uint64_t readyNs)
+{
+  uint64_t startNs = nowNs(CLOCK_MONOTONIC);
+  link.message->Update();
+  uint64_t endNs = nowNs(CLOCK_MONOTONIC);
+
+  // only the thread holding the oneshot touches these, the atomics are just
+  // there so GetLinkStats() can read them from another thread
+  uint64_t updateNs = endNs - startNs;
+  uint64_t waitNs = startNs - readyNs;
+  link.updates.store(
+    link.updates.load(std::memory_order_relaxed) + 1,
+    std::memory_order_relaxed);
+  link.totalUpdateNs.store(
+    link.totalUpdateNs.load(std::memory_order_relaxed) + updateNs,
+    std::memory_order_relaxed);
+  if (updateNs > link.maxUpdateNs.load(std::memory_order_relaxed))
+  {
+    link.maxUpdateNs.store(updateNs, std::memory_order_relaxed);
+  }
+  if (waitNs > link.maxWaitNs.load(std::memory_order_relaxed))
+  {
+    link.maxWaitNs.store(waitNs, std::memory_order_relaxed);
+  }
+
+  if (events & (EPOLLHUP | EPOLLRDHUP | EPOLLERR))
+  {
+    // the other end is gone, stop watching the link rather than spin on it
+    link.hungUp.store(true, std::memory_order_relaxed);
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, link.fd, nullptr);
+    return;
+  }
+
+  if (link.isStopped())
+  {
+    // re-arming would hand the link straight back while fd is readable, so
+    // it stays out of epoll until resume(). A frame taken out before parked
+    // was set found nothing to resume.
+    link.parked.store(true);
+    if (!link.isStopped())
+    {
+      resume(link);
+    }
+    return;
+  }
+
+  struct epoll_event event = {};
+  event.events = LINK_EVENTS;
+  event.data.u64 = static_cast<uint64_t>(&link - links.data());
+  epoll_ctl(epollFd, EPOLL_CTL_MOD, link.fd, &event);
+}
+
+template <uint32_t MAX_LINKS, uint32_t MAX_THREADS>
+void MessageReactor<MAX_LINKS, MAX_THREADS>::resume(Link &link)
+{
+  if (!link.parked.exchange(false))
+  {
+    return;
+  }
+  link.resumed.store(true);
+  uint64_t one = 1;
+  ssize_t written = write(resumeFd, &one, sizeof(one));
+  (void)written;
+}
+
+template <uint32_t MAX_LINKS, uint32_t MAX_THREADS>
+void MessageReactor<MAX_LINKS, MAX_THREADS>::serviceResumed(uint64_t readyNs)
+{
+  uint64_t count;
+  ssize_t drained = read(resumeFd, &count, sizeof(count));
+  (void)drained;
+  uint32_t linksNow = linkCount.load();
+  for (uint32_t i = 0; i < linksNow; i++)
+  {
+    if (links[i].resumed.exchange(false))
+    {
+      service(links[i], 0, readyNs);
+    }
+  }
+
+  // a link resumed during the scan has written resumeFd again
+  struct epoll_event event = {};
+  event.events = EPOLLIN | EPOLLONESHOT;
+  event.data.u64 = RESUME_EVENT;
+  epoll_ctl(epollFd, EPOLL_CTL_MOD, resumeFd, &event);
+}
+
+template <uint32_t MAX_LINKS, uint32_t MAX_THREADS>
+uint64_t MessageReactor<MAX_LINKS, MAX_THREADS>::nowNs(clockid_t clock)
+{
+  struct timespec now;
+  clock_gettime(clock, &now);
+  return static_cast<uint64_t>(now.tv_sec) * 1000000000u +
+         static_cast<uint64_t>(now.tv_nsec);
+}
@@ -22,18 +22,18 @@ public:
   virtual void Update() = 0;
 
   /**
-   * @brief Returns true if there is new data available
+   * @brief Returns true if there is a queued frame that hasn't been handled
    * @return true if there is new data available
    */
   virtual bool IsNewData() = 0;
 
   /**
-   * @brief Clears the new data flag
+   * @brief Removes the oldest queued frame
    */
   virtual void ClearNewData() = 0;
 
   /**
-   * @brief Return a pointer to the args array
+   * @brief Return a pointer to the args of the oldest queued frame
    * @return a pointer to the args array
    */
   virtual int32_t *GetArgs() = 0;
@@ -52,10 +52,25 @@ public:
    */
   virtual uint32_t GetPopulatedArgs() = 0;
 
+  /**
+   * @brief Returns true if the current message had more args than the max
+   * number of args. Only the first max number of args are kept.
+   * @return true if the current message had more args than the max number of
+   * args
+   */
+  virtual bool HasArgOverflow() = 0;
+
+  /**
+   * @brief Returns the number of parsed frames that are waiting to be handled
+   * @return the number of parsed frames that are waiting to be handled
+   */
+  virtual uint32_t GetQueuedFrames() = 0;
+
   /**
    * @brief Register a callback function to be called when new data is received
+   * @return false if the maximum number of callbacks have been registered
    */
-  virtual void RegisterCallback(const MESSAGE_INTF::Callback &callback) = 0;
+  virtual bool RegisterCallback(const MESSAGE_INTF::Callback &callback) = 0;
 
 private:
 };
\ No newline at end of file
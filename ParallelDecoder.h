@@ -0,0 +1,458 @@
+/**
+ * @file ParallelDecoder.h
+ * @brief This file contains the ParallelDecoder class which decodes a large
+ * log of raw frames on every core
+ * @details The log is memory mapped and cut into chunks. A chunk starts right
+ * after the first endMarker at or past its nominal offset, because the parser
+ * is always outside a frame after an endMarker, whatever came before it. So
+ * every chunk can be decoded on its own by a BatchDecoder and the frames come
+ * out exactly as if the whole log went through one Message object. Worker
+ * threads decode a few chunks ahead while the calling thread hands the frames
+ * of each chunk to the handler in order. It needs POSIX and threads, so it is
+ * for offline analysis on a host.
+ * @version 1.0.0
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <mutex>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "BatchDecoder.h"
+
+#ifndef MESSAGE_PARALLEL_MAX_PIECE
+// the most bytes handed to one BatchDecoder::Decode() call, which counts in
+// 32 bits. The tests lower it to reach the splitting with a small log.
+#define MESSAGE_PARALLEL_MAX_PIECE 0x80000000u
+#endif
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  typename DIALECT = MESSAGE_INTF::AsciiProtocol>
+class ParallelDecoder
+{
+public:
+  /**
+   * @brief Construct a new Parallel Decoder object
+   * @param threadCount the number of threads that decode, 0 for one per core.
+   * With 1 everything is decoded on the calling thread.
+   * @param chunkSize how many bytes of the log a thread decodes at a time
+   */
+  explicit ParallelDecoder(
+    uint32_t threadCount = 0,
+    uint32_t chunkSize = 1u << 20);
+  ParallelDecoder(const ParallelDecoder &) = delete;
+  ParallelDecoder &operator=(const ParallelDecoder &) = delete;
+  ~ParallelDecoder();
+
+  /**
+   * @brief Maps the log at path. Any log that was open is closed first.
+   * @return false if the file can't be mapped, e.g. because it is empty
+   */
+  bool Open(const char *path);
+
+  /**
+   * @brief Unmaps the log
+   */
+  void Close();
+
+  /**
+   * @brief Decodes every complete frame of the open log, see the other
+   * Decode()
+   */
+  template <typename FRAME_HANDLER>
+  uint64_t Decode(FRAME_HANDLER &&onFrame);
+
+  /**
+   * @brief Decodes every complete frame in buffer. The frames are exactly the
+   * ones a Message object would get from the same bytes, in the same order.
+   * @param buffer the bytes to decode
+   * @param length the number of bytes in buffer
+   * @param onFrame called on the calling thread for every frame as
+   * onFrame(const int32_t *args, uint32_t populatedArgs, bool argOverflow)
+   * @return the number of bytes consumed, less than length if the buffer ends
+   * in the middle of a frame
+   */
+  template <typename FRAME_HANDLER>
+  uint64_t Decode(const char *buffer, uint64_t length, FRAME_HANDLER &&onFrame);
+
+  /**
+   * @brief Returns the number of threads that decode
+   */
+  uint32_t GetThreadCount() const;
+
+private:
+  using Decoder = BatchDecoder<SERIAL_BUFFER_SIZE, MAX_ARGS, DIALECT>;
+
+  // the top bit of a frame's header word in Slot::frames
+  static constexpr uint32_t ARG_OVERFLOW_BIT = 0x80000000u;
+
+  /**
+   * @brief The decoded frames of one chunk, waiting to be handed over
+   */
+  struct Slot
+  {
+    std::vector<int32_t> frames; // per frame a header word and then its args
+    uint64_t done{0};            // the chunk in frames plus 1, 0 for none
+    uint64_t consumed{0};        // the end of what the chunk consumed
+  };
+
+  /**
+   * @brief Returns where chunk starts in buffer, right after the first
+   * endMarker at or past its nominal offset and before limit
+   * @return the start, length if there is no endMarker before limit
+   */
+  uint64_t chunkStart(
+    const char *buffer,
+    uint64_t length,
+    uint64_t chunk,
+    uint64_t limit) const;
+
+  /**
+   * @brief Decodes a chunk, passing each frame to onFrame
+   * @return the end of what was consumed as an offset into buffer, 0 if the
+   * chunk is empty
+   */
+  template <typename FRAME_HANDLER>
+  uint64_t decodeChunk(
+    Decoder &decoder,
+    const char *buffer,
+    uint64_t length,
+    uint64_t chunk,
+    FRAME_HANDLER &&onFrame) const;
+
+  /**
+   * @brief Decodes the bytes from start to end of buffer, in pieces of at
+   * most MESSAGE_PARALLEL_MAX_PIECE bytes
+   * @return the end of what was consumed as an offset into buffer
+   */
+  template <typename FRAME_HANDLER>
+  static uint64_t decodeRange(
+    Decoder &decoder,
+    const char *buffer,
+    uint64_t start,
+    uint64_t end,
+    FRAME_HANDLER &&onFrame);
+
+  /**
+   * @brief Takes the next chunk, decodes it into its slot and repeats until
+   * every chunk is taken
+   */
+  void work(const char *buffer, uint64_t length, uint64_t chunkCount);
+
+  uint32_t threadCount;
+  uint32_t chunkSize;
+
+  const char *mapping{nullptr}; // the log, mapped read only
+  size_t mappingSize{0};
+
+  // decoding state shared with the workers, guarded by mutex
+  std::mutex mutex;
+  std::condition_variable slotReady; // a worker filled a slot
+  std::condition_variable slotFree;  // the caller emptied a slot
+  std::vector<Slot> slots;           // chunk n goes in slot n % size
+  uint64_t nextChunk{0};             // the next chunk a worker takes
+  uint64_t emittedChunks{0};         // the chunks handed to the handler
+};
+
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, typename DIALECT>
+ParallelDecoder<SERIAL_BUFFER_SIZE, MAX_ARGS, DIALECT>::ParallelDecoder(
+  uint32_t threadCount,
+  uint32_t chunkSize)
+    : threadCount(threadCount),
+      chunkSize(chunkSize > 0 ? chunkSize : 1)
+{
+  if (this->threadCount == 0)
+  {
+    this->threadCount = std::thread::hardware_concurrency();
+  }
+  if (this->threadCount == 0)
+  {
+    this->threadCount = 1;
+  }
+}
+
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, typename DIALECT>
+ParallelDecoder<SERIAL_BUFFER_SIZE, MAX_ARGS, DIALECT>::~ParallelDecoder()
+{
+  Close();
+}
+
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, typename DIALECT>
+bool ParallelDecoder<SERIAL_BUFFER_SIZE, MAX_ARGS, DIALECT>::Open(
+  const char *path)
+{
+  Close();
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+  {
+    return false;
+  }
+  struct stat info;
+  void *mapped = MAP_FAILED;
+  if (fstat(fd, &info) == 0 && info.st_size > 0)
+  {
+    mapped = mmap(
+      nullptr,
+      static_cast<size_t>(info.st_size),
+      PROT_READ,
+      MAP_PRIVATE,
+      fd,
+      0);
+  }
+  close(fd); // the mapping keeps the file open
+  if (mapped == MAP_FAILED)
+  {
+    return false;
+  }
+
+  mapping = static_cast<const char *>(mapped);
+  mappingSize = static_cast<size_t>(info.st_size);
+  // the chunks are read roughly front to back, a few at a time
+  madvise(mapped, mappingSize, MADV_SEQUENTIAL);
+  return true;
+}
+
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, typename DIALECT>
+void ParallelDecoder<SERIAL_BUFFER_SIZE, MAX_ARGS, DIALECT>::Close()
+{
+  if (mapping != nullptr)
+  {
+    munmap(const_cast<char *>(mapping), mappingSize);
+  }
+  mapping = nullptr;
+  mappingSize = 0;
+}
+
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, typename DIALECT>
+template <typename FRAME_HANDLER>
+uint64_t ParallelDecoder<SERIAL_BUFFER_SIZE, MAX_ARGS, DIALECT>::Decode(
+  FRAME_HANDLER &&onFrame)
+{
+  return Decode(mapping, mappingSize, onFrame);
+}
+
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, typename DIALECT>
+template <typename FRAME_HANDLER>
+uint64_t ParallelDecoder<SERIAL_BUFFER_SIZE, MAX_ARGS, DIALECT>::Decode(
+  const char *buffer,
+  uint64_t length,
+  FRAME_HANDLER &&onFrame)
+{
+  uint64_t chunkCount = (length + chunkSize - 1) / chunkSize;
+  uint64_t consumed = 0;
+  if (threadCount == 1 || chunkCount <= 1)
+  {
+    Decoder decoder;
+    for (uint64_t chunk = 0; chunk < chunkCount; chunk++)
+    {
+      uint64_t end = decodeChunk(decoder, buffer, length, chunk, onFrame);
+      consumed = end > consumed ? end : consumed;
+    }
+    return consumed;
+  }
+
+  // twice as many slots as threads, so the workers can run ahead while the
+  // caller is busy with the handler
+  slots.assign(2 * threadCount, Slot());
+  nextChunk = 0;
+  emittedChunks = 0;
+  std::vector<std::thread> workers;
+  for (uint32_t i = 0; i < threadCount; i++)
+  {
+    workers.emplace_back(
+      &ParallelDecoder::work, this, buffer, length, chunkCount);
+  }
+
+  for (uint64_t chunk = 0; chunk < chunkCount; chunk++)
+  {
+    Slot &slot = slots[chunk % slots.size()];
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      slotReady.wait(lock, [&] { return slot.done == chunk + 1; });
+    }
+    const int32_t *frame = slot.frames.data();
+    const int32_t *end = frame + slot.frames.size();
+    while (frame < end)
+    {
+      uint32_t header = static_cast<uint32_t>(*frame);
+      uint32_t populatedArgs = header & ~ARG_OVERFLOW_BIT;
+      onFrame(frame + 1, populatedArgs, (header & ARG_OVERFLOW_BIT) != 0);
+      frame += 1 + populatedArgs;
+    }
+    consumed = slot.consumed > consumed ? slot.consumed : consumed;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      emittedChunks = chunk + 1;
+    }
+    slotFree.notify_all();
+  }
+
+  for (std::thread &worker : workers)
+  {
+    worker.join();
+  }
+  return consumed;
+}
+
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, typename DIALECT>
+uint32_t
+ParallelDecoder<SERIAL_BUFFER_SIZE, MAX_ARGS, DIALECT>::GetThreadCount() const
+{
+  return threadCount;
+}
+
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, typename DIALECT>
+uint64_t ParallelDecoder<SERIAL_BUFFER_SIZE, MAX_ARGS, DIALECT>::chunkStart(
+  const char *buffer,
+  uint64_t length,
+  uint64_t chunk,
+  uint64_t limit) const
+{
+  uint64_t offset = chunk * chunkSize;
+  if (chunk == 0 || offset >= length)
+  {
+    return chunk == 0 ? 0 : length;
+  }
+  limit = limit < length ? limit : length;
+  // scanning for the next startMarker instead would be wrong, a startMarker
+  // inside a frame doesn't start one
+  const char *end = static_cast<const char *>(
+    memchr(buffer + offset, DIALECT::endMarker, limit - offset));
+  return end != nullptr ? static_cast<uint64_t>(end - buffer) + 1 : length;
+}
+
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, typename DIALECT>
+template <typename FRAME_HANDLER>
+uint64_t ParallelDecoder<SERIAL_BUFFER_SIZE, MAX_ARGS, DIALECT>::decodeChunk(
+  Decoder &decoder,
+  const char *buffer,
+  uint64_t length,
+  uint64_t chunk,
+  FRAME_HANDLER &&onFrame) const
+{
+  // only the chunk's own bytes are searched for its start, so a long run
+  // without an endMarker is scanned once and not by every chunk it covers
+  uint64_t start =
+    chunkStart(buffer, length, chunk, (chunk + 1) * chunkSize);
+  if (start == length)
+  {
+    // a frame from an earlier chunk runs through this one and is decoded
+    // there, or the log ended
+    return 0;
+  }
+  uint64_t end = chunkStart(buffer, length, chunk + 1, length);
+  return decodeRange(decoder, buffer, start, end, onFrame);
+}
+
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, typename DIALECT>
+template <typename FRAME_HANDLER>
+uint64_t ParallelDecoder<SERIAL_BUFFER_SIZE, MAX_ARGS, DIALECT>::decodeRange(
+  Decoder &decoder,
+  const char *buffer,
+  uint64_t start,
+  uint64_t end,
+  FRAME_HANDLER &&onFrame)
+{
+  const uint64_t maxPiece = MESSAGE_PARALLEL_MAX_PIECE;
+  // only a run without an endMarker makes a chunk this long
+  while (end - start > maxPiece)
+  {
+    uint32_t consumed = decoder.Decode(
+      buffer + start, static_cast<uint32_t>(maxPiece), onFrame);
+    if (consumed > 0)
+    {
+      start += consumed;
+      continue;
+    }
+
+    // the piece is one unfinished frame, the parser takes it a piece at a
+    // time up to its endMarker
+    const char *endMarker = static_cast<const char *>(
+      memchr(buffer + start, DIALECT::endMarker, end - start));
+    if (endMarker == nullptr)
+    {
+      return start;
+    }
+    uint64_t frameEnd = static_cast<uint64_t>(endMarker - buffer) + 1;
+    FrameParser<SERIAL_BUFFER_SIZE, MAX_ARGS, DIALECT> parser;
+    while (start < frameEnd)
+    {
+      uint64_t piece =
+        frameEnd - start < maxPiece ? frameEnd - start : maxPiece;
+      start += parser.Parse(buffer + start, static_cast<uint32_t>(piece));
+      if (parser.IsFrameComplete())
+      {
+        onFrame(
+          parser.GetArgs(), parser.GetPopulatedArgs(), parser.HasArgOverflow());
+      }
+    }
+  }
+  return start + decoder.Decode(
+                   buffer + start, static_cast<uint32_t>(end - start), onFrame);
+}
+
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, typename DIALECT>
+void ParallelDecoder<SERIAL_BUFFER_SIZE, MAX_ARGS, DIALECT>::work(
+  const char *buffer,
+  uint64_t length,
+  uint64_t chunkCount)
+{
+  Decoder decoder;
+  while (true)
+  {
+    uint64_t chunk;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      // a chunk's slot is free once the chunk that used it before is emitted
+      slotFree.wait(
+        lock,
+        [&]
+        {
+          return nextChunk >= chunkCount ||
+                 nextChunk < emittedChunks + slots.size();
+        });
+      if (nextChunk >= chunkCount)
+      {
+        return;
+      }
+      chunk = nextChunk;
+      nextChunk++;
+    }
+
+    Slot &slot = slots[chunk % slots.size()];
+    slot.frames.clear();
+    uint64_t consumed = decodeChunk(
+      decoder,
+      buffer,
+      length,
+      chunk,
+      [&slot](const int32_t *args, uint32_t populatedArgs, bool argOverflow)
+      {
+        // one resize per frame, the capacity stays from the slot's last use
+        size_t size = slot.frames.size();
+        slot.frames.resize(size + 1 + populatedArgs);
+        int32_t *out = slot.frames.data() + size;
+        out[0] = static_cast<int32_t>(
+          populatedArgs | (argOverflow ? ARG_OVERFLOW_BIT : 0));
+        std::copy(args, args + populatedArgs, out + 1);
+      });
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      slot.consumed = consumed;
+      slot.done = chunk + 1;
+    }
+    slotReady.notify_all();
+  }
+}
@@ -0,0 +1,487 @@
+/**
+ * @file ReplayMessage.h
+ * @brief This file contains the ReplayMessage class
+ * @details This file contains the ReplayMessage class which plays a capture
+ * recorded by a CaptureWriter back into the parser. The capture is memory
+ * mapped and its chunks are parsed in place, either as fast as the parser
+ * goes or with the timing they were recorded with. It needs POSIX, so it is
+ * for replaying field traffic on a host.
+ * @version 1.0.0
+ */
+
+#pragma once
+
+#include <chrono>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Message.h"
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES = 1,
+  typename PROTOCOL = MESSAGE_INTF::AsciiProtocol>
+class ReplayMessage
+    : public Message<
+        ReplayMessage<
+          SERIAL_BUFFER_SIZE,
+          MAX_ARGS,
+          MAX_CALLBACKS,
+          MAX_FRAMES,
+          PROTOCOL>,
+        SERIAL_BUFFER_SIZE,
+        MAX_ARGS,
+        MAX_CALLBACKS,
+        MAX_FRAMES,
+        PROTOCOL>
+{
+  friend class Message<
+    ReplayMessage,
+    SERIAL_BUFFER_SIZE,
+    MAX_ARGS,
+    MAX_CALLBACKS,
+    MAX_FRAMES,
+    PROTOCOL>;
+
+public:
+  ReplayMessage() = default;
+  ReplayMessage(const ReplayMessage &) = delete;
+  ReplayMessage &operator=(const ReplayMessage &) = delete;
+  ~ReplayMessage();
+
+  /**
+   * @brief Initialize the ReplayMessage object, there is nothing to set up
+   */
+  void Init(uint32_t baudRate) override;
+
+  /**
+   * @brief Outgoing frames have nowhere to go, they are dropped
+   */
+  void PrintArgs() override;
+
+  /**
+   * @brief Maps the capture at path and starts at its first chunk. Any
+   * capture that was open is closed first.
+   * @return false if the file can't be mapped or isn't a capture
+   */
+  bool Open(const char *path);
+
+  /**
+   * @brief Unmaps the capture
+   */
+  void Close();
+
+  /**
+   * @brief Starts again from the first chunk
+   */
+  void Rewind();
+
+  /**
+   * @brief With realTime set, Update() only parses the chunks whose recorded
+   * time has come, counted from the first Update() after Open() or Rewind().
+   * Without it, which is the default, every chunk is parsed straight away.
+   */
+  void SetRealTime(bool realTime);
+
+  /**
+   * @brief Returns true once every chunk has been parsed. A capture that was
+   * cut short, e.g. by a power loss, finishes at its last whole chunk.
+   */
+  bool IsFinished() const;
+
+  /**
+   * @brief Returns the number of bytes in the chunks that have been parsed
+   */
+  uint64_t GetReplayedBytes() const;
+
+protected:
+  /**
+   * @brief reads the next byte of the capture
+   * @return the next byte, or '\0' if there is nothing due
+   */
+  char getChar();
+
+  /**
+   * @brief returns the number of bytes left in the current chunk
+   */
+  uint32_t dataAvailable();
+
+  /**
+   * @brief returns the rest of the current chunk, or of the next one once it
+   * is due, so it is parsed straight out of the mapping
+   */
+  const char *peekBytes(uint32_t &length);
+
+  /**
+   * @brief moves past bytes that have been parsed
+   */
+  void consumeBytes(uint32_t length);
+
+  /**
+   * @brief drops the bytes, a capture only has what was received
+   */
+  void writeBytes(const char *buffer, uint32_t length);
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  /**
+   * @brief Moves on to the next chunk if the current one is used up
+   * @return false if there is no chunk or the next one isn't due yet
+   */
+  bool nextChunk();
+
+  const uint8_t *mapping{nullptr}; // the capture, mapped read only
+  size_t mappingSize{0};
+  const uint8_t *position{nullptr}; // the next record
+
+  const char *chunk{nullptr}; // what is left of the current chunk
+  uint32_t chunkLength{0};
+
+  bool realTime{false};
+  bool started{false};     // start has been set for this playback
+  Clock::time_point start; // when the first chunk was played
+  uint64_t dueMicros{0};   // when the next chunk was recorded, from start
+  uint64_t replayedBytes{0};
+};
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+ReplayMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::~ReplayMessage()
+{
+  Close();
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void ReplayMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::Init(uint32_t baudRate)
+{
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void ReplayMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::PrintArgs()
+{
+  this->printArgs();
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+bool ReplayMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::Open(const char *path)
+{
+  Close();
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+  {
+    return false;
+  }
+  struct stat info;
+  void *mapped = MAP_FAILED;
+  if (fstat(fd, &info) == 0 && info.st_size > 0)
+  {
+    mapped = mmap(
+      nullptr,
+      static_cast<size_t>(info.st_size),
+      PROT_READ,
+      MAP_PRIVATE,
+      fd,
+      0);
+  }
+  close(fd); // the mapping keeps the file open
+  if (mapped == MAP_FAILED)
+  {
+    return false;
+  }
+
+  mapping = static_cast<const uint8_t *>(mapped);
+  mappingSize = static_cast<size_t>(info.st_size);
+  if (
+    mappingSize < MESSAGE_CAPTURE::HEADER_SIZE ||
+    !MESSAGE_CAPTURE::CheckHeader(mapping, MESSAGE_CAPTURE::HEADER_SIZE))
+  {
+    Close();
+    return false;
+  }
+  // the chunks are read front to back exactly once
+  madvise(mapped, mappingSize, MADV_SEQUENTIAL);
+  Rewind();
+  return true;
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void ReplayMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::Close()
+{
+  if (mapping != nullptr)
+  {
+    munmap(const_cast<uint8_t *>(mapping), mappingSize);
+  }
+  mapping = nullptr;
+  mappingSize = 0;
+  position = nullptr;
+  chunk = nullptr;
+  chunkLength = 0;
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void ReplayMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::Rewind()
+{
+  position =
+    mapping != nullptr ? mapping + MESSAGE_CAPTURE::HEADER_SIZE : nullptr;
+  chunk = reinterpret_cast<const char *>(position);
+  chunkLength = 0;
+  started = false;
+  dueMicros = 0;
+  replayedBytes = 0;
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void ReplayMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::SetRealTime(bool realTime)
+{
+  this->realTime = realTime;
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+bool ReplayMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::IsFinished() const
+{
+  return chunkLength == 0 && position == mapping + mappingSize;
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+uint64_t ReplayMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::GetReplayedBytes() const
+{
+  return replayedBytes;
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+bool ReplayMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::nextChunk()
+{
+  if (chunkLength > 0)
+  {
+    return true;
+  }
+  if (position == nullptr)
+  {
+    return false;
+  }
+
+  const uint8_t *end = mapping + mappingSize;
+  const uint8_t *next = position;
+  MESSAGE_CAPTURE::Record record;
+  if (!MESSAGE_CAPTURE::ReadRecord(next, end, record))
+  {
+    position = end; // the end, or a record cut short at the end of the file
+    return false;
+  }
+
+  if (realTime)
+  {
+    Clock::time_point now = Clock::now();
+    if (!started)
+    {
+      start = now;
+      started = true;
+    }
+    uint64_t due = dueMicros + record.delta;
+    uint64_t elapsed = static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::microseconds>(now - start)
+        .count());
+    if (due > elapsed)
+    {
+      return false;
+    }
+    dueMicros = due;
+  }
+
+  position = next;
+  chunk = record.data;
+  chunkLength = record.length;
+  return chunkLength > 0 || nextChunk();
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+char ReplayMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::getChar()
+{
+  if (!nextChunk())
+  {
+    return '\0';
+  }
+  char c = *chunk;
+  consumeBytes(1);
+  return c;
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+uint32_t ReplayMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::dataAvailable()
+{
+  return nextChunk() ? chunkLength : 0;
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+const char *ReplayMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::peekBytes(uint32_t &length)
+{
+  length = nextChunk() ? chunkLength : 0;
+  return chunk;
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void ReplayMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::consumeBytes(uint32_t length)
+{
+  chunk += length;
+  chunkLength -= length;
+  replayedBytes += length;
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void ReplayMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::writeBytes(const char *buffer, uint32_t length)
+{
+}
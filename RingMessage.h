@@ -0,0 +1,255 @@
+/**
+ * @file RingMessage.h
+ * @brief This file contains the RingMessage class
+ * @details This file contains the RingMessage class which parses messages out
+ * of an RxRing. A UART interrupt or DMA-complete handler pushes the received
+ * bytes into the ring and Update() parses them straight out of it, a
+ * contiguous span at a time, without copying them first. Outgoing frames are
+ * handed to a write function since the ring only carries received bytes.
+ * @version 1.0.0
+ */
+
+#pragma once
+
+#include "Message.h"
+#include "RxRing.h"
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES = 1,
+  typename PROTOCOL = MESSAGE_INTF::AsciiProtocol>
+class RingMessage
+    : public Message<
+        RingMessage<
+          SERIAL_BUFFER_SIZE,
+          MAX_ARGS,
+          MAX_CALLBACKS,
+          MAX_FRAMES,
+          PROTOCOL>,
+        SERIAL_BUFFER_SIZE,
+        MAX_ARGS,
+        MAX_CALLBACKS,
+        MAX_FRAMES,
+        PROTOCOL>
+{
+  friend class Message<
+    RingMessage,
+    SERIAL_BUFFER_SIZE,
+    MAX_ARGS,
+    MAX_CALLBACKS,
+    MAX_FRAMES,
+    PROTOCOL>;
+
+public:
+  /**
+   * @brief Writes outgoing bytes to the hardware, e.g. with uart_write_bytes()
+   */
+  using WriteFunction = void (*)(const char *buffer, uint32_t length);
+
+  /**
+   * @brief Construct a new Ring Message object
+   * @param ring the ring the receive interrupt pushes into, it has to outlive
+   * this object
+   * @param write where outgoing frames go, nullptr drops them
+   */
+  RingMessage(RxRing *ring, WriteFunction write = nullptr);
+
+  /**
+   * @brief Initialize the RingMessage object, the UART and its interrupt are
+   * set up by the caller
+   */
+  void Init(uint32_t baudRate) override;
+
+  /**
+   * @brief Prints the args array with the write function
+   */
+  void PrintArgs() override;
+
+protected:
+  /**
+   * @brief pops one byte from the ring
+   * @return the next byte, or '\0' if the ring is empty
+   */
+  char getChar();
+
+  /**
+   * @brief returns the number of bytes waiting in the ring
+   */
+  uint32_t dataAvailable();
+
+  /**
+   * @brief pops up to length bytes from the ring
+   */
+  uint32_t readBytes(char *buffer, uint32_t length);
+
+  /**
+   * @brief returns the oldest contiguous bytes in the ring so they are parsed
+   * in place
+   */
+  const char *peekBytes(uint32_t &length);
+
+  /**
+   * @brief gives the parsed bytes back to the producer
+   */
+  void consumeBytes(uint32_t length);
+
+  /**
+   * @brief hands the bytes to the write function
+   */
+  void writeBytes(const char *buffer, uint32_t length);
+
+private:
+  RxRing *ring;        // where the received bytes are read from
+  WriteFunction write; // where outgoing bytes go, nullptr drops them
+};
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+RingMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::RingMessage(RxRing *ring, WriteFunction write)
+    : ring(ring),
+      write(write)
+{
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void RingMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::Init(uint32_t baudRate)
+{
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void RingMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::PrintArgs()
+{
+  this->printArgs();
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+char RingMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::getChar()
+{
+  char c = '\0';
+  ring->Pop(&c, 1);
+  return c;
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+uint32_t RingMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::dataAvailable()
+{
+  return ring->Available();
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+uint32_t RingMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::readBytes(char *buffer, uint32_t length)
+{
+  return ring->Pop(buffer, length);
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+const char * RingMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::peekBytes(uint32_t &length)
+{
+  return ring->ReadSpan(length);
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void RingMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::consumeBytes(uint32_t length)
+{
+  ring->Consume(length);
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void RingMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::writeBytes(const char *buffer, uint32_t length)
+{
+  if (write != nullptr)
+  {
+    write(buffer, length);
+  }
+}
@@ -0,0 +1,257 @@
+/**
+ * @file RxRing.h
+ * @brief This file contains the RxRing class, a lock-free single producer,
+ * single consumer byte ring
+ * @details A UART interrupt or a DMA-complete handler pushes the bytes it
+ * received into the ring and a RingMessage object parses them from the main
+ * loop. Neither side ever waits for the other, so a slow handler in the loop
+ * only fills the ring up instead of overflowing the hardware FIFO.
+ * @version 1.0.0
+ */
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+class RxRing
+{
+public:
+  /**
+   * @brief Construct a new Rx Ring over storage
+   * @param storage where the bytes are kept, it has to outlive the ring
+   * @param size the size of storage, it has to be a power of two
+   */
+  RxRing(char *storage, uint32_t size);
+
+  // the producer side, call these from one interrupt or thread only
+
+  /**
+   * @brief Copies as much of data as fits into the ring. Bytes that don't fit
+   * are dropped and counted.
+   * @return the number of bytes that were pushed
+   */
+  uint32_t Push(const char *data, uint32_t length);
+
+  /**
+   * @brief Returns the free space the next write can go straight into, so a
+   * DMA transfer can target the ring without a copy. Call CommitWrite() once
+   * the bytes are there.
+   * @param length set to the number of contiguous free bytes
+   * @return where to write them
+   */
+  char *WriteSpan(uint32_t &length);
+
+  /**
+   * @brief Hands length bytes written into WriteSpan() to the consumer
+   */
+  void CommitWrite(uint32_t length);
+
+  /**
+   * @brief Counts bytes a producer couldn't fit, e.g. a DMA transfer that
+   * completed into its own buffer because the ring was full
+   */
+  void CountDropped(uint32_t length);
+
+  // the consumer side, call these from one thread only
+
+  /**
+   * @brief Returns the oldest received bytes that are contiguous in storage
+   * @param length set to the number of bytes, 0 if the ring is empty
+   * @return where the bytes start
+   */
+  const char *ReadSpan(uint32_t &length);
+
+  /**
+   * @brief Frees length bytes returned by ReadSpan() for the producer
+   */
+  void Consume(uint32_t length);
+
+  /**
+   * @brief Copies up to length of the oldest bytes into buffer and frees them
+   * @return the number of bytes copied
+   */
+  uint32_t Pop(char *buffer, uint32_t length);
+
+  // safe from either side
+
+  /**
+   * @brief Returns the number of bytes waiting to be read
+   */
+  uint32_t Available() const;
+
+  /**
+   * @brief Returns the number of bytes dropped because the ring was full
+   */
+  uint32_t GetDropped() const;
+
+  /**
+   * @brief Returns the most bytes that were ever waiting at once, to help
+   * size the ring
+   */
+  uint32_t GetHighWater() const;
+
+private:
+  char *storage;
+  uint32_t mask; // size - 1, indices are free running and masked on use
+
+  // head is only written by the producer and tail only by the consumer. Each
+  // side publishes its index with release and reads the other's with acquire
+  // so the bytes are visible before the index that covers them.
+  std::atomic<uint32_t> head{0};
+  std::atomic<uint32_t> tail{0};
+  std::atomic<uint32_t> dropped{0};
+  std::atomic<uint32_t> highWater{0};
+};
+
+/**
+ * @brief The bytes of a StaticRxRing. Bases are constructed in the order
+ * they are listed, so listing this one before RxRing has the array in place
+ * before RxRing is given a pointer into it.
+ */
+template <uint32_t SIZE>
+struct RxRingStorage
+{
+  std::array<char, SIZE> bytes;
+};
+
+/**
+ * @brief An RxRing that owns SIZE bytes of storage
+ */
+template <uint32_t SIZE>
+class StaticRxRing
+    : private RxRingStorage<SIZE>,
+      public RxRing
+{
+  static_assert(
+    SIZE >= 2 && (SIZE & (SIZE - 1)) == 0,
+    "the ring size has to be a power of two");
+
+public:
+  StaticRxRing()
+      : RxRing(this->bytes.data(), SIZE)
+  {
+  }
+};
+
+inline RxRing::RxRing(char *storage, uint32_t size)
+    : storage(storage),
+      mask(size - 1)
+{
+  // any other size would make the mask skip part of storage, or overrun it
+  assert(size >= 2 && (size & (size - 1)) == 0);
+}
+
+inline uint32_t RxRing::Push(const char *data, uint32_t length)
+{
+  uint32_t pushed = 0;
+  while (pushed < length)
+  {
+    uint32_t room;
+    char *span = WriteSpan(room);
+    if (room == 0)
+    {
+      break;
+    }
+    if (room > length - pushed)
+    {
+      room = length - pushed;
+    }
+    memcpy(span, data + pushed, room);
+    CommitWrite(room);
+    pushed += room;
+  }
+  if (pushed < length)
+  {
+    CountDropped(length - pushed);
+  }
+  return pushed;
+}
+
+inline char *RxRing::WriteSpan(uint32_t &length)
+{
+  uint32_t writeIndex = head.load(std::memory_order_relaxed);
+  uint32_t used = writeIndex - tail.load(std::memory_order_acquire);
+  uint32_t offset = writeIndex & mask;
+  // stop at the end of storage, the rest of the room is at the start
+  uint32_t toEnd = mask + 1 - offset;
+  uint32_t room = mask + 1 - used;
+  length = room < toEnd ? room : toEnd;
+  return storage + offset;
+}
+
+inline void RxRing::CommitWrite(uint32_t length)
+{
+  uint32_t writeIndex = head.load(std::memory_order_relaxed) + length;
+  head.store(writeIndex, std::memory_order_release);
+
+  uint32_t used = writeIndex - tail.load(std::memory_order_relaxed);
+  if (used > highWater.load(std::memory_order_relaxed))
+  {
+    highWater.store(used, std::memory_order_relaxed);
+  }
+}
+
+inline void RxRing::CountDropped(uint32_t length)
+{
+  dropped.store(
+    dropped.load(std::memory_order_relaxed) + length,
+    std::memory_order_relaxed);
+}
+
+inline const char *RxRing::ReadSpan(uint32_t &length)
+{
+  uint32_t readIndex = tail.load(std::memory_order_relaxed);
+  uint32_t used = head.load(std::memory_order_acquire) - readIndex;
+  uint32_t offset = readIndex & mask;
+  uint32_t toEnd = mask + 1 - offset;
+  length = used < toEnd ? used : toEnd;
+  return storage + offset;
+}
+
+inline void RxRing::Consume(uint32_t length)
+{
+  tail.store(
+    tail.load(std::memory_order_relaxed) + length, std::memory_order_release);
+}
+
+inline uint32_t RxRing::Pop(char *buffer, uint32_t length)
+{
+  uint32_t popped = 0;
+  while (popped < length)
+  {
+    uint32_t available;
+    const char *span = ReadSpan(available);
+    if (available == 0)
+    {
+      break;
+    }
+    if (available > length - popped)
+    {
+      available = length - popped;
+    }
+    memcpy(buffer + popped, span, available);
+    Consume(available);
+    popped += available;
+  }
+  return popped;
+}
+
+inline uint32_t RxRing::Available() const
+{
+  return head.load(std::memory_order_acquire) -
+         tail.load(std::memory_order_acquire);
+}
+
+inline uint32_t RxRing::GetDropped() const
+{
+  return dropped.load(std::memory_order_relaxed);
+}
+
+inline uint32_t RxRing::GetHighWater() const
+{
+  return highWater.load(std::memory_order_relaxed);
+}
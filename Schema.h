@@ -0,0 +1,307 @@
+/**
+ * @file Schema.h
+ * @brief This file contains the Schema template which describes the fields of
+ * one message ID so its frames can be handed to a handler as typed values
+ * @details A schema checks the number of args and the range of every field
+ * once, before the handler is called, so the handler never has to look at the
+ * raw int32_t args. Fields can also be int64_t, full range uint32_t, float or
+ * MESSAGE_INTF::Fixed, those are converted from the text of the frame.
+ * @version 1.0.0
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <tuple>
+#include <type_traits>
+
+#include "DecimalParser.h"
+#include "MESSAGE-INTF.h"
+
+namespace MESSAGE_SCHEMA
+{
+/**
+ * @brief A list of field indices, std::index_sequence needs C++14
+ */
+template <uint32_t... INDICES>
+struct Indices
+{
+};
+
+template <uint32_t COUNT, uint32_t... INDICES>
+struct MakeIndices : MakeIndices<COUNT - 1, COUNT - 1, INDICES...>
+{
+};
+
+template <uint32_t... INDICES>
+struct MakeIndices<0, INDICES...>
+{
+  using Type = Indices<INDICES...>;
+};
+
+/**
+ * @brief Returns true if value fits in a FIELD narrower than 32 bits
+ */
+template <typename FIELD>
+constexpr bool InRange(int32_t value)
+{
+  return (static_cast<int64_t>(value) >=
+            static_cast<int64_t>(std::numeric_limits<FIELD>::min()) &&
+          static_cast<int64_t>(value) <=
+            static_cast<int64_t>(std::numeric_limits<FIELD>::max()));
+}
+
+/**
+ * @brief Returns true if every check passed
+ */
+constexpr bool All()
+{
+  return true;
+}
+
+template <typename... CHECKS>
+constexpr bool All(bool first, CHECKS... rest)
+{
+  return first && All(rest...);
+}
+
+/**
+ * @brief Reads an integer field narrower than 32 bits straight from its arg.
+ * A clamped arg is INT32_MIN or INT32_MAX, which no such field takes
+ * @return false if the arg doesn't fit in the field
+ */
+template <typename FIELD>
+bool ReadField(
+  const MESSAGE_INTF::FrameView &frame,
+  uint32_t index,
+  FIELD &value)
+{
+  static_assert(
+    std::is_integral<FIELD>::value && sizeof(FIELD) < 4,
+    "schema fields have to be integers of less than 32 bits, int32_t, "
+    "uint32_t, int64_t, float or MESSAGE_INTF::Fixed");
+  if (!InRange<FIELD>(frame.args[index]))
+  {
+    return false;
+  }
+  value = static_cast<FIELD>(frame.args[index]);
+  return true;
+}
+
+/**
+ * @brief Reads an int32_t field from the text of its arg when the frame has
+ * text, so a value the parser clamped to fit fails instead of arriving as
+ * INT32_MIN or INT32_MAX. Without text the arg is all there is: a queued
+ * ASCII frame may hold a clamped value at those limits
+ * @return false if the text isn't an integer or doesn't fit
+ */
+inline bool ReadField(
+  const MESSAGE_INTF::FrameView &frame,
+  uint32_t index,
+  int32_t &value)
+{
+  if (frame.text == nullptr)
+  {
+    value = frame.args[index];
+    return true;
+  }
+  const MESSAGE_INTF::ArgSpan &span = frame.spans[index];
+  int64_t wide;
+  if (
+    !MESSAGE_ASCII::ParseInt64(frame.text + span.start, span.length, wide) ||
+    wide < INT32_MIN || wide > INT32_MAX)
+  {
+    return false;
+  }
+  value = static_cast<int32_t>(wide);
+  return true;
+}
+
+// the fields below are converted from the text of their arg when the frame
+// has text. Without text the arg's 32 bits are only used if they are the
+// sender's, as in binary frames. A queued ASCII frame has lost its text and
+// its args may have been clamped, so these fields fail for it.
+
+inline bool ReadField(
+  const MESSAGE_INTF::FrameView &frame,
+  uint32_t index,
+  uint32_t &value)
+{
+  if (frame.text == nullptr)
+  {
+    if (!frame.rawArgs)
+    {
+      return false;
+    }
+    value = static_cast<uint32_t>(frame.args[index]);
+    return true;
+  }
+  const MESSAGE_INTF::ArgSpan &span = frame.spans[index];
+  return MESSAGE_ASCII::ParseUint32(
+    frame.text + span.start, span.length, value);
+}
+
+inline bool ReadField(
+  const MESSAGE_INTF::FrameView &frame,
+  uint32_t index,
+  int64_t &value)
+{
+  if (frame.text == nullptr)
+  {
+    if (!frame.rawArgs)
+    {
+      return false;
+    }
+    value = frame.args[index];
+    return true;
+  }
+  const MESSAGE_INTF::ArgSpan &span = frame.spans[index];
+  return MESSAGE_ASCII::ParseInt64(frame.text + span.start, span.length, value);
+}
+
+inline bool ReadField(
+  const MESSAGE_INTF::FrameView &frame,
+  uint32_t index,
+  float &value)
+{
+  if (frame.text == nullptr)
+  {
+    if (!frame.rawArgs)
+    {
+      return false;
+    }
+    memcpy(&value, &frame.args[index], sizeof(value));
+    return true;
+  }
+  const MESSAGE_INTF::ArgSpan &span = frame.spans[index];
+  return MESSAGE_ASCII::ParseFloat(frame.text + span.start, span.length, value);
+}
+
+template <uint32_t FRAC_BITS>
+bool ReadField(
+  const MESSAGE_INTF::FrameView &frame,
+  uint32_t index,
+  MESSAGE_INTF::Fixed<FRAC_BITS> &value)
+{
+  if (frame.text == nullptr)
+  {
+    if (!frame.rawArgs)
+    {
+      return false;
+    }
+    value.raw = frame.args[index];
+    return true;
+  }
+  const MESSAGE_INTF::ArgSpan &span = frame.spans[index];
+  return MESSAGE_ASCII::ParseFixed(frame.text + span.start, span.length, value);
+}
+} // namespace MESSAGE_SCHEMA
+
+namespace MESSAGE_INTF
+{
+/**
+ * @brief Describes the fields that follow MESSAGE_ID in a frame, e.g.
+ * `Schema<42, int16_t, uint8_t, int32_t>` for `!42,x,y,z;`. A field can be an
+ * integer of at most 32 bits, bool, uint32_t, int64_t, float or Fixed.
+ */
+template <uint32_t MESSAGE_ID, typename... FIELDS>
+struct Schema
+{
+  static constexpr uint32_t messageID = MESSAGE_ID;
+  static constexpr uint32_t fieldCount = sizeof...(FIELDS);
+
+  using Fields = std::tuple<FIELDS...>;
+  using Handler = bool (*)(const Fields &fields);
+
+  /**
+   * @brief Converts a frame into fields
+   * @param frame the frame to convert
+   * @param fields where to write the fields
+   * @return false if the frame isn't MESSAGE_ID, has the wrong number of args
+   * or has an arg that doesn't fit in its field
+   */
+  static bool Decode(const FrameView &frame, Fields &fields);
+
+  /**
+   * @brief Converts the args of a frame that has no text, e.g. one from
+   * PopFrame(), into fields. uint32_t, int64_t, float and Fixed fields need
+   * rawArgs, they fail for the clamped args of an ASCII frame.
+   * @param args the args of the frame, args[0] is the message ID
+   * @param length the number of args
+   * @param fields where to write the fields
+   * @param rawArgs true if the args hold the sender's 32 bits, as the args of
+   * a binary frame do
+   * @return false if the frame doesn't match the schema
+   */
+  static bool Decode(
+    const int32_t *args,
+    uint32_t length,
+    Fields &fields,
+    bool rawArgs = false);
+
+  /**
+   * @brief Returns a callback that decodes MESSAGE_ID frames and calls HANDLER
+   * with their fields, e.g.
+   * `message.RegisterCallback(Position::Bind<onPosition>());`
+   * Frames that don't match the schema aren't handled.
+   */
+  template <Handler HANDLER>
+  static Callback Bind()
+  {
+    return Callback{MESSAGE_ID, nullptr, &dispatch<HANDLER>};
+  }
+
+private:
+  template <Handler HANDLER>
+  static bool dispatch(const FrameView &frame)
+  {
+    Fields fields;
+    return Decode(frame, fields) && HANDLER(fields);
+  }
+
+  template <uint32_t... INDICES>
+  static bool decode(
+    const FrameView &frame,
+    Fields &fields,
+    MESSAGE_SCHEMA::Indices<INDICES...>);
+};
+
+template <uint32_t MESSAGE_ID, typename... FIELDS>
+bool Schema<MESSAGE_ID, FIELDS...>::Decode(
+  const FrameView &frame,
+  Fields &fields)
+{
+  if (
+    frame.length != fieldCount + 1 ||
+    static_cast<uint32_t>(frame.args[0]) != MESSAGE_ID)
+  {
+    return false;
+  }
+  return decode(
+    frame, fields, typename MESSAGE_SCHEMA::MakeIndices<fieldCount>::Type());
+}
+
+template <uint32_t MESSAGE_ID, typename... FIELDS>
+bool Schema<MESSAGE_ID, FIELDS...>::Decode(
+  const int32_t *args,
+  uint32_t length,
+  Fields &fields,
+  bool rawArgs)
+{
+  return Decode(FrameView{args, length, nullptr, nullptr, rawArgs}, fields);
+}
+
+template <uint32_t MESSAGE_ID, typename... FIELDS>
+template <uint32_t... INDICES>
+bool Schema<MESSAGE_ID, FIELDS...>::decode(
+  const FrameView &frame,
+  Fields &fields,
+  MESSAGE_SCHEMA::Indices<INDICES...>)
+{
+  // args[0] is the message ID, the fields start after it
+  return MESSAGE_SCHEMA::All(MESSAGE_SCHEMA::ReadField(
+    frame, INDICES + 1, std::get<INDICES>(fields))...);
+}
+} // namespace MESSAGE_INTF
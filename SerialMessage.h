@@ -16,100 +16,194 @@
 template <
   uint32_t SERIAL_BUFFER_SIZE,
   uint32_t MAX_ARGS,
-  uint32_t MAX_CALLBACKS>
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES = 1,
+  typename PROTOCOL = MESSAGE_INTF::AsciiProtocol>
 class SerialMessage
-    : public Message<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>
+    : public Message<
+        SerialMessage<
+          SERIAL_BUFFER_SIZE,
+          MAX_ARGS,
+          MAX_CALLBACKS,
+          MAX_FRAMES,
+          PROTOCOL>,
+        SERIAL_BUFFER_SIZE,
+        MAX_ARGS,
+        MAX_CALLBACKS,
+        MAX_FRAMES,
+        PROTOCOL>
 {
+  friend class Message<
+    SerialMessage,
+    SERIAL_BUFFER_SIZE,
+    MAX_ARGS,
+    MAX_CALLBACKS,
+    MAX_FRAMES,
+    PROTOCOL>;
+
 public:
-    /**
-     * @brief Construct a new Serial Message object
-     */
-    SerialMessage(HardwareSerial *serial);
+  /**
+   * @brief Construct a new Serial Message object
+   */
+  SerialMessage(HardwareSerial *serial);
 
-    /**
-     * @brief Initialize the SerialMessage object
-     */
-    void Init(uint32_t baudRate) override;
+  /**
+   * @brief Initialize the SerialMessage object
+   */
+  void Init(uint32_t baudRate) override;
 
-    /**
-     * @brief Prints the args array to the serial monitor
-     */
-    void PrintArgs() override;
+  /**
+   * @brief Prints the args array to the serial monitor
+   */
+  void PrintArgs() override;
 
 protected:
-    /**
-     * @brief reads the serial data and stores it in the data array
-     * @return the next character in the serial buffer
-     */
-    char getChar() override;
-
-    /**
-     * @brief returns the number of bytes available in the serial buffer
-     * @return the number of bytes available in the serial buffer
-     */
-    uint32_t dataAvailable() override;
+  /**
+   * @brief reads the serial data and stores it in the data array
+   * @return the next character in the serial buffer
+   */
+  char getChar();
+
+  /**
+   * @brief returns the number of bytes available in the serial buffer
+   * @return the number of bytes available in the serial buffer
+   */
+  uint32_t dataAvailable();
+
+  /**
+   * @brief reads all of the available serial data up to length bytes
+   * @return the number of bytes written into buffer
+   */
+  uint32_t readBytes(char *buffer, uint32_t length);
+
+  /**
+   * @brief writes the whole buffer to the serial port in one write
+   */
+  void writeBytes(const char *buffer, uint32_t length);
 
 private:
-    HardwareSerial *serial{nullptr};
+  HardwareSerial *serial{nullptr};
 };
 
 template <
   uint32_t SERIAL_BUFFER_SIZE,
   uint32_t MAX_ARGS,
-  uint32_t MAX_CALLBACKS>
-char SerialMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::getChar()
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+char SerialMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::getChar()
 {
-    return this->serial->read();
+  return this->serial->read();
 }
 
 template <
   uint32_t SERIAL_BUFFER_SIZE,
   uint32_t MAX_ARGS,
-  uint32_t MAX_CALLBACKS>
-uint32_t
-SerialMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::dataAvailable()
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+uint32_t SerialMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::dataAvailable()
 {
-    return this->serial->available();
+  return this->serial->available();
 }
 
-<<<<<<< Updated upstream
-template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, uint32_t MAX_CALLBACKS>
-SerialMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::SerialMessage(HardwareSerial *serial) : serial(serial) {}
-=======
 template <
   uint32_t SERIAL_BUFFER_SIZE,
   uint32_t MAX_ARGS,
-  uint32_t MAX_CALLBACKS>
-SerialMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::SerialMessage(
-  HardwareSerial *serial)
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+uint32_t SerialMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::readBytes(char *buffer, uint32_t length)
+{
+  // never ask for more than is buffered so the read can't block
+  uint32_t available = this->serial->available();
+  if (length > available)
+  {
+    length = available;
+  }
+  if (length == 0)
+  {
+    return 0;
+  }
+  return this->serial->read(reinterpret_cast<uint8_t *>(buffer), length);
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void SerialMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::writeBytes(const char *buffer, uint32_t length)
+{
+  this->serial->write(reinterpret_cast<const uint8_t *>(buffer), length);
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+SerialMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::SerialMessage(HardwareSerial *serial)
     : serial(serial)
 {
 }
->>>>>>> Stashed changes
 
 template <
   uint32_t SERIAL_BUFFER_SIZE,
   uint32_t MAX_ARGS,
-  uint32_t MAX_CALLBACKS>
-void SerialMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::Init(
-  uint32_t baudRate)
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void SerialMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::Init(uint32_t baudRate)
 {
-    this->serial->begin(baudRate);
+  this->serial->begin(baudRate);
 }
 
 template <
   uint32_t SERIAL_BUFFER_SIZE,
   uint32_t MAX_ARGS,
-  uint32_t MAX_CALLBACKS>
-void SerialMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::PrintArgs()
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void SerialMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::PrintArgs()
 {
-    return;
-    this->serial->print("Current number of args: ");
-    this->serial->println(this->populatedArgs);
-    for (int i = 0; i < this->populatedArgs; i++)
-    {
-        this->serial->print(this->args[i]);
-        this->serial->print(" ");
-    }
-    this->serial->println();
-}
\ No newline at end of file
+  return;
+  this->printArgs();
+}
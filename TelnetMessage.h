@@ -6,208 +6,332 @@
 #include "WiFi.h"
 #include "GlobalPrint.h"
 
+namespace MESSAGE_TELNET
+{
+/**
+ * @brief Tells one TelnetMessage that the telnet client changed. ESPTelnet
+ * takes plain functions as its callbacks, so those go through the list of
+ * these instead of through a static pointer to the last object.
+ */
+struct ClientListener
+{
+  MESSAGE_INTF::Delegate<void()> onClientChange;
+  ClientListener *next{nullptr};
+  bool linked{false};
+};
+
+/**
+ * @brief Returns the head of the list of every initialized TelnetMessage
+ */
+inline ClientListener *&Listeners()
+{
+  static ClientListener *head = nullptr;
+  return head;
+}
+
+/**
+ * @brief Adds listener to the list, if it isn't in it yet
+ */
+inline void Listen(ClientListener &listener)
+{
+  if (!listener.linked)
+  {
+    listener.next = Listeners();
+    Listeners() = &listener;
+    listener.linked = true;
+  }
+}
+
+/**
+ * @brief Takes listener out of the list
+ */
+inline void Unlisten(ClientListener &listener)
+{
+  for (ClientListener **link = &Listeners(); *link != nullptr;
+       link = &(*link)->next)
+  {
+    if (*link == &listener)
+    {
+      *link = listener.next;
+      break;
+    }
+  }
+  listener.linked = false;
+}
+
+/**
+ * @brief Prints what happened to the client at ip and, if it came or went,
+ * tells every listener. ESPTelnet serves port 23 to one client at a time, so
+ * every TelnetMessage sees the same client.
+ */
+inline void OnClientEvent(const String &ip, const char *what, bool changed)
+{
+  GlobalPrint::Print("- Telnet: ");
+  GlobalPrint::Print(ip);
+  GlobalPrint::Println(what);
+  if (!changed)
+  {
+    return;
+  }
+  for (ClientListener *listener = Listeners(); listener != nullptr;
+       listener = listener->next)
+  {
+    listener->onClientChange();
+  }
+}
+
+inline void OnConnect(String ip)
+{
+  OnClientEvent(ip, " connected", true);
+}
+
+inline void OnConnectionAttempt(String ip)
+{
+  OnClientEvent(ip, " failed to connect", false);
+}
+
+inline void OnReconnect(String ip)
+{
+  OnClientEvent(ip, " reconnected", true);
+}
+
+inline void OnDisconnect(String ip)
+{
+  OnClientEvent(ip, " disconnected", true);
+}
+} // namespace MESSAGE_TELNET
+
 template <
   uint32_t SERIAL_BUFFER_SIZE,
   uint32_t MAX_ARGS,
-  uint32_t MAX_CALLBACKS>
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES = 1,
+  typename PROTOCOL = MESSAGE_INTF::AsciiProtocol>
 class TelnetMessage
-    : public Message<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>
+    : public Message<
+        TelnetMessage<
+          SERIAL_BUFFER_SIZE,
+          MAX_ARGS,
+          MAX_CALLBACKS,
+          MAX_FRAMES,
+          PROTOCOL>,
+        SERIAL_BUFFER_SIZE,
+        MAX_ARGS,
+        MAX_CALLBACKS,
+        MAX_FRAMES,
+        PROTOCOL>
 {
+  friend class Message<
+    TelnetMessage,
+    SERIAL_BUFFER_SIZE,
+    MAX_ARGS,
+    MAX_CALLBACKS,
+    MAX_FRAMES,
+    PROTOCOL>;
+
 public:
-<<<<<<< Updated upstream
-    /**
-     * @brief Construct a new Bluetooth Serial Message object
-     */
-    TelnetMessage(ESPTelnet *telnet) : telnet(telnet) {}
-=======
   /**
-   * @brief Construct a new Bluetooth Serial Message object
+   * @brief Construct a new Telnet Message object
    */
-  TelnetMessage(ESPTelnet *telnet)
+  TelnetMessage(ESPTelnetStream *telnet)
       : telnet(telnet)
   {
   }
->>>>>>> Stashed changes
-
-    void Init(uint32_t baudRate) override { Serial.println("Never call this without a parameter, this will not function properly without a callback function"); }
-    /**
-     * @brief Initialize the TelnetMessage object
-     * @pre The WiFi object must have a state of WL_CONNECTED
-     */
-    void Init(void (*callback)(String data));
 
-    /**
-     * @brief prints the args array to the telnet monitor
-     */
-    void PrintArgs() override;
+  /**
+   * @brief Stops listening for the telnet client's connects and disconnects
+   */
+  ~TelnetMessage();
 
-    void SetString(const char *data);
+  /**
+   * @brief Initialize the TelnetMessage object. Telnet has no baud rate, it
+   * always listens on port 23.
+   * @pre The WiFi object must have a state of WL_CONNECTED
+   */
+  void Init(uint32_t baudRate) override;
 
-    void SetOnInputRecieved(void (*callback)(String data));
+  /**
+   * @brief prints the args array to the telnet monitor
+   */
+  void PrintArgs() override;
 
 private:
-    /**
-     * @brief reads the telnet data and stores it in the data array
-     */
-    char getChar() override;
-
-    /**
-     * @brief returns the amount of data available
-     */
-    uint32_t dataAvailable() override;
-
-    static void onConnectCallback(String ip);
-    static void onConnectionAttemptCallback(String ip);
-    static void onReconnectCallback(String ip);
-    static void onDisconnectCallback(String ip);
-
-    ESPTelnet *telnet;
-
-    const char *incomingData = nullptr;
-    uint32_t incomingDataLength{0};
-    uint32_t incomingDataCharIndex{0};
-};
+  /**
+   * @brief reads the next character from the telnet client
+   */
+  char getChar();
 
-template <
-  uint32_t SERIAL_BUFFER_SIZE,
-  uint32_t MAX_ARGS,
-  uint32_t MAX_CALLBACKS>
-void TelnetMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::
-  onConnectCallback(String ip)
-{
-    GlobalPrint::Print("- Telnet: ");
-    GlobalPrint::Print(ip);
-    GlobalPrint::Println(" connected");
-}
+  /**
+   * @brief returns the amount of data available
+   */
+  uint32_t dataAvailable();
 
-template <
-  uint32_t SERIAL_BUFFER_SIZE,
-  uint32_t MAX_ARGS,
-  uint32_t MAX_CALLBACKS>
-void TelnetMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::
-  onConnectionAttemptCallback(String ip)
-{
-    GlobalPrint::Print("- Telnet: ");
-    GlobalPrint::Print(ip);
-    GlobalPrint::Println(" failed to connect");
-}
+  /**
+   * @brief reads as much of the telnet client's pending data as fits into
+   * buffer straight out of the client stream
+   */
+  uint32_t readBytes(char *buffer, uint32_t length);
+
+  /**
+   * @brief writes the whole buffer to the telnet client in one write
+   */
+  void writeBytes(const char *buffer, uint32_t length);
+
+  /**
+   * @brief Drops the partial frame, the queued frames and any bytes read
+   * ahead, so a new client never continues what the last one sent
+   */
+  void resetClientState();
+
+  ESPTelnetStream *telnet;
+  MESSAGE_TELNET::ClientListener
+    clientListener; // calls resetClientState() when the client changes
+};
 
 template <
   uint32_t SERIAL_BUFFER_SIZE,
   uint32_t MAX_ARGS,
-  uint32_t MAX_CALLBACKS>
-void TelnetMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::
-  onReconnectCallback(String ip)
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+TelnetMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::~TelnetMessage()
 {
-    GlobalPrint::Print("- Telnet: ");
-    GlobalPrint::Print(ip);
-    GlobalPrint::Println(" reconnected");
+  MESSAGE_TELNET::Unlisten(clientListener);
 }
 
 template <
   uint32_t SERIAL_BUFFER_SIZE,
   uint32_t MAX_ARGS,
-  uint32_t MAX_CALLBACKS>
-void TelnetMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::
-  onDisconnectCallback(String ip)
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void TelnetMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::resetClientState()
 {
-    GlobalPrint::Print("- Telnet: ");
-    GlobalPrint::Print(ip);
-    GlobalPrint::Println(" disconnected");
+  this->resetReceive();
 }
 
 template <
   uint32_t SERIAL_BUFFER_SIZE,
   uint32_t MAX_ARGS,
-  uint32_t MAX_CALLBACKS>
-void TelnetMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::
-  SetOnInputRecieved(void (*callback)(String data))
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+char TelnetMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::getChar()
 {
-    this->telnet->onInputReceived(callback);
+  return telnet->read();
 }
 
 template <
   uint32_t SERIAL_BUFFER_SIZE,
   uint32_t MAX_ARGS,
-  uint32_t MAX_CALLBACKS>
-char TelnetMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::getChar()
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+uint32_t TelnetMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::dataAvailable()
 {
-    // Stop us from reading any more data if there's nothing more to read
-    if (this->incomingData == nullptr || this->incomingDataLength == 0)
-    {
-        return this->endMarker;
-    }
-
-<<<<<<< Updated upstream
-    char output = this->incomingData[this->incomingDataCharIndex];
-    this->incomingDataCharIndex++;
-    // GlobalPrint::Println("Char Idx:" + String(this->incomingDataCharIndex) + ", Data Length:" + String(this->incomingDataLength) + ", Char:" + output);
-    return output;
-=======
-  char output = this->incomingData[this->incomingDataCharIndex];
-  this->incomingDataCharIndex++;
-  // GlobalPrint::Println("Char Idx:" + String(this->incomingDataCharIndex) + ",
-  // Data Length:" + String(this->incomingDataLength) + ", Char:" + output);
-  return output;
->>>>>>> Stashed changes
+  return telnet->available();
 }
 
 template <
   uint32_t SERIAL_BUFFER_SIZE,
   uint32_t MAX_ARGS,
-  uint32_t MAX_CALLBACKS>
-void TelnetMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::SetString(
-  const char *data)
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+uint32_t TelnetMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::readBytes(char *buffer, uint32_t length)
 {
-    this->incomingDataLength = strlen(data);
-    this->incomingDataCharIndex = 0;
-    this->incomingData = data;
-    this->Update();
+  // never ask for more than is buffered so readBytes() won't wait on its
+  // timeout
+  uint32_t available = telnet->available();
+  if (length > available)
+  {
+    length = available;
+  }
+  if (length == 0)
+  {
+    return 0;
+  }
+  return telnet->readBytes(buffer, length);
 }
 
 template <
   uint32_t SERIAL_BUFFER_SIZE,
   uint32_t MAX_ARGS,
-  uint32_t MAX_CALLBACKS>
-uint32_t
-TelnetMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::dataAvailable()
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void TelnetMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::writeBytes(const char *buffer, uint32_t length)
 {
-    if (this->incomingData == nullptr)
-    {
-        return 0;
-    }
-    return this->incomingDataLength - this->incomingDataCharIndex;
+  telnet->write(reinterpret_cast<const uint8_t *>(buffer), length);
 }
 
 template <
   uint32_t SERIAL_BUFFER_SIZE,
   uint32_t MAX_ARGS,
-  uint32_t MAX_CALLBACKS>
-void TelnetMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::Init(
-  void (*callback)(String data))
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void TelnetMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::Init(uint32_t baudRate)
 {
-    telnet->begin(23);
-    // set all of our callbacks
-    telnet->onConnect(TelnetMessage::onConnectCallback);
-    telnet->onConnectionAttempt(TelnetMessage::onConnectionAttemptCallback);
-    telnet->onReconnect(TelnetMessage::onReconnectCallback);
-    telnet->onDisconnect(TelnetMessage::onDisconnectCallback);
-
-    this->SetOnInputRecieved(callback);
+  clientListener.onClientChange = MESSAGE_INTF::Delegate<void()>::Bind<
+    TelnetMessage,
+    &TelnetMessage::resetClientState>(this);
+  MESSAGE_TELNET::Listen(clientListener);
+  telnet->begin(23);
+  // set all of our callbacks
+  telnet->onConnect(MESSAGE_TELNET::OnConnect);
+  telnet->onConnectionAttempt(MESSAGE_TELNET::OnConnectionAttempt);
+  telnet->onReconnect(MESSAGE_TELNET::OnReconnect);
+  telnet->onDisconnect(MESSAGE_TELNET::OnDisconnect);
 }
 
 template <
   uint32_t SERIAL_BUFFER_SIZE,
   uint32_t MAX_ARGS,
-  uint32_t MAX_CALLBACKS>
-void TelnetMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::PrintArgs()
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void TelnetMessage<
+  SERIAL_BUFFER_SIZE,
+  MAX_ARGS,
+  MAX_CALLBACKS,
+  MAX_FRAMES,
+  PROTOCOL>::PrintArgs()
 {
-    telnet->print("Current number of args: ");
-    telnet->println(this->populatedArgs);
-    for (int i = 0; i < this->populatedArgs; i++)
-    {
-        telnet->print(this->args[i]);
-        telnet->print(" ");
-    }
-    telnet->println();
+  this->printArgs();
 }
@@ -5,84 +5,148 @@
 template <
   uint32_t SERIAL_BUFFER_SIZE,
   uint32_t MAX_ARGS,
-  uint32_t MAX_CALLBACKS>
-class USBMessage : public Message<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES = 1,
+  typename PROTOCOL = MESSAGE_INTF::AsciiProtocol>
+class USBMessage
+    : public Message<
+        USBMessage<
+          SERIAL_BUFFER_SIZE,
+          MAX_ARGS,
+          MAX_CALLBACKS,
+          MAX_FRAMES,
+          PROTOCOL>,
+        SERIAL_BUFFER_SIZE,
+        MAX_ARGS,
+        MAX_CALLBACKS,
+        MAX_FRAMES,
+        PROTOCOL>
 {
+  friend class Message<
+    USBMessage,
+    SERIAL_BUFFER_SIZE,
+    MAX_ARGS,
+    MAX_CALLBACKS,
+    MAX_FRAMES,
+    PROTOCOL>;
+
 public:
-    /**
-     * @brief Construct a new USB Serial Message object
-     */
-    USBMessage(USBCDC *serial);
-    void Init(uint32_t baudRate) override;
-    /**
-     * @brief prints the args array to the serial monitor
-     */
-    void PrintArgs() override;
+  /**
+   * @brief Construct a new USB Serial Message object
+   */
+  USBMessage(USBCDC *serial);
+  void Init(uint32_t baudRate) override;
+  /**
+   * @brief prints the args array to the serial monitor
+   */
+  void PrintArgs() override;
 
 protected:
-    char getChar() override;
-    uint32_t dataAvailable() override;
+  char getChar();
+  uint32_t dataAvailable();
+  uint32_t readBytes(char *buffer, uint32_t length);
+  void writeBytes(const char *buffer, uint32_t length);
 
 private:
-    USBCDC *serial;
+  USBCDC *serial;
 };
 
-<<<<<<< Updated upstream
-template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS, uint32_t MAX_CALLBACKS>
-USBMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::USBMessage(USBCDC *USBSerial) : serial(USBSerial) {}
-=======
 template <
   uint32_t SERIAL_BUFFER_SIZE,
   uint32_t MAX_ARGS,
-  uint32_t MAX_CALLBACKS>
-USBMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::USBMessage(
-  USBCDC *USBSerial)
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+USBMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS, MAX_FRAMES, PROTOCOL>::
+  USBMessage(USBCDC *USBSerial)
     : serial(USBSerial)
 {
 }
->>>>>>> Stashed changes
 
 template <
   uint32_t SERIAL_BUFFER_SIZE,
   uint32_t MAX_ARGS,
-  uint32_t MAX_CALLBACKS>
-char USBMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::getChar()
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+char
+USBMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS, MAX_FRAMES, PROTOCOL>::
+  getChar()
+{
+  return serial->read();
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+uint32_t
+USBMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS, MAX_FRAMES, PROTOCOL>::
+  dataAvailable()
 {
-    return serial->read();
+  return serial->available();
 }
 
 template <
   uint32_t SERIAL_BUFFER_SIZE,
   uint32_t MAX_ARGS,
-  uint32_t MAX_CALLBACKS>
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
 uint32_t
-USBMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::dataAvailable()
+USBMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS, MAX_FRAMES, PROTOCOL>::
+  readBytes(char *buffer, uint32_t length)
 {
-    return serial->available();
+  // never ask for more than is buffered so the read can't block
+  uint32_t available = serial->available();
+  if (length > available)
+  {
+    length = available;
+  }
+  if (length == 0)
+  {
+    return 0;
+  }
+  return serial->read(reinterpret_cast<uint8_t *>(buffer), length);
 }
 
 template <
   uint32_t SERIAL_BUFFER_SIZE,
   uint32_t MAX_ARGS,
-  uint32_t MAX_CALLBACKS>
-void USBMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::Init(
-  uint32_t baudRate)
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void
+USBMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS, MAX_FRAMES, PROTOCOL>::
+  writeBytes(const char *buffer, uint32_t length)
 {
-    serial->begin();
+  serial->write(reinterpret_cast<const uint8_t *>(buffer), length);
 }
 
 template <
   uint32_t SERIAL_BUFFER_SIZE,
   uint32_t MAX_ARGS,
-  uint32_t MAX_CALLBACKS>
-void USBMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS>::PrintArgs()
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void
+USBMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS, MAX_FRAMES, PROTOCOL>::
+  Init(uint32_t baudRate)
 {
-    serial->print("Current number of args: ");
-    serial->println(this->populatedArgs);
-    for (int i = 0; i < this->populatedArgs; i++)
-    {
-        serial->print(this->args[i]);
-        serial->print(" ");
-    }
-    serial->println();
-}
\ No newline at end of file
+  serial->begin();
+}
+
+template <
+  uint32_t SERIAL_BUFFER_SIZE,
+  uint32_t MAX_ARGS,
+  uint32_t MAX_CALLBACKS,
+  uint32_t MAX_FRAMES,
+  typename PROTOCOL>
+void
+USBMessage<SERIAL_BUFFER_SIZE, MAX_ARGS, MAX_CALLBACKS, MAX_FRAMES, PROTOCOL>::
+  PrintArgs()
+{
+  this->printArgs();
+}
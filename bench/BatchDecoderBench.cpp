@@ -0,0 +1,140 @@
+/**
+ * @file BatchDecoderBench.cpp
+ * @brief Measures how many bytes of `!a,b,c;` frames per second BatchDecoder
+ * and FrameParser get through. Prints one JSON object per line.
+ *
+ * Usage: BatchDecoderBench [frames] [repetitions]
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+#include "BatchDecoder.h"
+
+namespace
+{
+constexpr uint32_t BUFFER_SIZE = 64;
+constexpr uint32_t MAX_ARGS = 8;
+
+#if defined(__AVX2__)
+const char *const SIMD = "avx2";
+#elif defined(__SSE2__)
+const char *const SIMD = "sse2";
+#else
+const char *const SIMD = "scalar";
+#endif
+
+/**
+ * @brief frameCount frames of 1 to MAX_ARGS integers with maxDigits digits at
+ * most, a third of them negative
+ */
+std::string makeStream(uint32_t frameCount, uint32_t maxDigits)
+{
+  std::mt19937 rng(12345);
+  std::uniform_int_distribution<uint32_t> pick(0, 0x7FFFFFFF);
+  std::string stream;
+  for (uint32_t frame = 0; frame < frameCount; frame++)
+  {
+    stream += '!';
+    uint32_t argCount = 1 + pick(rng) % MAX_ARGS;
+    for (uint32_t arg = 0; arg < argCount; arg++)
+    {
+      if (arg > 0)
+      {
+        stream += ',';
+      }
+      if (pick(rng) % 3 == 0)
+      {
+        stream += '-';
+      }
+      uint32_t digits = 1 + pick(rng) % maxDigits;
+      stream += static_cast<char>('1' + pick(rng) % 9);
+      for (uint32_t i = 1; i < digits; i++)
+      {
+        stream += static_cast<char>('0' + pick(rng) % 10);
+      }
+    }
+    stream += ';';
+  }
+  return stream;
+}
+
+template <typename DECODE>
+void run(
+  const char *decoder,
+  const std::string &stream,
+  uint32_t maxDigits,
+  uint32_t repetitions,
+  DECODE &&decode)
+{
+  uint64_t frames = 0;
+  uint64_t checksum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < repetitions; i++)
+  {
+    decode(stream, frames, checksum);
+  }
+  double seconds = std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+  double bytes = static_cast<double>(stream.size()) * repetitions;
+  std::printf(
+    "{\"bench\":\"BatchDecoder\",\"decoder\":\"%s\",\"simd\":\"%s\","
+    "\"max_digits\":%u,\"bytes\":%.0f,\"frames\":%llu,\"seconds\":%.6f,"
+    "\"gb_per_s\":%.4f,\"frames_per_s\":%.0f,\"checksum\":%llu}\n",
+    decoder,
+    SIMD,
+    static_cast<unsigned>(maxDigits),
+    bytes,
+    static_cast<unsigned long long>(frames),
+    seconds,
+    bytes / seconds / 1e9,
+    frames / seconds,
+    static_cast<unsigned long long>(checksum));
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+  uint32_t frameCount = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+  uint32_t repetitions = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 20;
+
+  // 8 digits is the SWAR fast path, 10 digits falls back to FrameParser
+  for (uint32_t maxDigits : {4u, 8u, 10u})
+  {
+    std::string stream = makeStream(frameCount, maxDigits);
+
+    BatchDecoder<BUFFER_SIZE, MAX_ARGS> batch;
+    run("BatchDecoder", stream, maxDigits, repetitions,
+        [&batch](const std::string &s, uint64_t &frames, uint64_t &sum) {
+          batch.Decode(
+            s.data(),
+            s.size(),
+            [&](const int32_t *args, uint32_t populatedArgs, bool) {
+              frames++;
+              sum += static_cast<uint32_t>(args[populatedArgs - 1]);
+            });
+        });
+
+    FrameParser<BUFFER_SIZE, MAX_ARGS> parser;
+    run("FrameParser", stream, maxDigits, repetitions,
+        [&parser](const std::string &s, uint64_t &frames, uint64_t &sum) {
+          uint32_t offset = 0;
+          while (offset < s.size())
+          {
+            offset += parser.Parse(s.data() + offset, s.size() - offset);
+            if (parser.IsFrameComplete())
+            {
+              frames++;
+              sum += static_cast<uint32_t>(
+                parser.GetArgs()[parser.GetPopulatedArgs() - 1]);
+            }
+          }
+        });
+  }
+  return 0;
+}
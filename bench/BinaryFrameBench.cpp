@@ -0,0 +1,159 @@
+/**
+ * @file BinaryFrameBench.cpp
+ * @brief Compares the ASCII and the binary protocol on the same frames: the
+ * bytes each one puts on the wire per frame, and how many frames per second
+ * BufferMessage encodes with Send() and parses back with Update(). The
+ * frames are a message ID and 4 args, either small numbers like counters
+ * and flags, sensor readings in the thousands, or full 32 bit values. Prints
+ * one JSON object per line with the median of the repetitions.
+ *
+ * Usage: BinaryFrameBench [frames] [repetitions]
+ */
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "BinaryFrameParser.h"
+#include "BufferMessage.h"
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+using Args = std::array<int32_t, 5>;
+
+uint32_t frameCount = 200000;
+uint32_t repetitions = 7;
+
+uint64_t checksum = 0;
+
+bool sumArgs(const int32_t *args, uint32_t length)
+{
+  checksum += static_cast<uint32_t>(args[length - 1]);
+  return true;
+}
+
+/**
+ * @brief Returns the median of times, in frames per second
+ */
+double framesPerSecond(std::vector<double> &times)
+{
+  std::sort(times.begin(), times.end());
+  return frameCount / times[times.size() / 2];
+}
+
+/**
+ * @brief Encodes and parses frames with PROTOCOL and prints what it measured
+ */
+template <typename PROTOCOL>
+void runCase(
+  const char *protocol,
+  const char *values,
+  const std::vector<Args> &frames)
+{
+  using Bench = BufferMessage<64, 8, 1, 1, PROTOCOL>;
+  // 5 args take at most 60 bytes in ASCII and 30 in binary
+  std::vector<char> wire(frameCount * 64);
+  // Message has no virtual destructor, so they aren't deleted through it;
+  // each protocol's pair is kept for the other value ranges instead
+  static Bench sender;
+  static Bench receiver;
+  static bool registered = receiver.RegisterCallback({1, sumArgs, nullptr});
+  if (!registered)
+  {
+    return;
+  }
+
+  std::vector<double> encodeTimes;
+  std::vector<double> parseTimes;
+  uint32_t wireLength = 0;
+  for (uint32_t rep = 0; rep < repetitions; rep++)
+  {
+    sender.SetOutput(wire.data(), static_cast<uint32_t>(wire.size()));
+    Clock::time_point start = Clock::now();
+    for (const Args &args : frames)
+    {
+      sender.Send(args.data(), static_cast<uint32_t>(args.size()));
+    }
+    encodeTimes.push_back(
+      std::chrono::duration<double>(Clock::now() - start).count());
+    wireLength = sender.GetOutputLength();
+
+    checksum = 0;
+    receiver.SetInput(wire.data(), wireLength);
+    start = Clock::now();
+    while (receiver.GetRemainingInput() > 0)
+    {
+      receiver.Update();
+    }
+    parseTimes.push_back(
+      std::chrono::duration<double>(Clock::now() - start).count());
+  }
+
+  std::printf(
+    "{\"bench\":\"BinaryFrame\",\"protocol\":\"%s\",\"values\":\"%s\","
+    "\"frames\":%u,\"bytes_per_frame\":%.2f,\"encode_frames_per_s\":%.0f,"
+    "\"parse_frames_per_s\":%.0f,\"checksum\":%llu}\n",
+    protocol,
+    values,
+    static_cast<unsigned>(frameCount),
+    static_cast<double>(wireLength) / frameCount,
+    framesPerSecond(encodeTimes),
+    framesPerSecond(parseTimes),
+    static_cast<unsigned long long>(checksum));
+}
+
+/**
+ * @brief Builds frames whose 4 args come from value and runs both protocols
+ * on them
+ */
+template <typename VALUE>
+void runValues(const char *values, VALUE value)
+{
+  std::mt19937 rng(1);
+  std::vector<Args> frames(frameCount);
+  for (Args &args : frames)
+  {
+    args[0] = 1;
+    for (uint32_t i = 1; i < args.size(); i++)
+    {
+      args[i] = value(rng);
+    }
+  }
+  runCase<MESSAGE_INTF::AsciiProtocol>("ascii", values, frames);
+  runCase<MESSAGE_INTF::BinaryProtocol>("binary", values, frames);
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+  if (argc > 1)
+  {
+    frameCount = std::strtoul(argv[1], nullptr, 10);
+  }
+  if (argc > 2)
+  {
+    repetitions = std::strtoul(argv[2], nullptr, 10);
+  }
+  if (frameCount == 0 || repetitions == 0)
+  {
+    return 1;
+  }
+
+  runValues(
+    "-50 to 50",
+    [](std::mt19937 &rng) { return static_cast<int32_t>(rng() % 101) - 50; });
+  runValues(
+    "-5000 to 5000",
+    [](std::mt19937 &rng)
+    { return static_cast<int32_t>(rng() % 10001) - 5000; });
+  runValues(
+    "any 32 bit",
+    [](std::mt19937 &rng) { return static_cast<int32_t>(rng()); });
+  return 0;
+}
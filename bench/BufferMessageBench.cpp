@@ -0,0 +1,139 @@
+/**
+ * @file BufferMessageBench.cpp
+ * @brief Drives generated frames through BufferMessage, so the real Update(),
+ * parser, dispatch and queue path is timed with no driver in the way. Prints
+ * one JSON object per case with frames/s, bytes/s and the p50/p99/p99.9 time
+ * between two callbacks, which is the cost of one frame.
+ *
+ * Usage: BufferMessageBench [frames] [repetitions]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "BufferMessage.h"
+#include "FrameGenerator.h"
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+uint32_t frameCount = 200000;
+uint32_t repetitions = 5;
+
+/**
+ * @brief Runs one case on a BufferMessage with room for SIZE bytes per frame
+ * and ARGS args, and prints its JSON line
+ */
+template <uint32_t SIZE, uint32_t ARGS>
+void runCase(const char *name, const MESSAGE_BENCH::GeneratorOptions &options)
+{
+  std::string stream = MESSAGE_BENCH::GenerateFrames(options, frameCount);
+
+  BufferMessage<SIZE, ARGS, 8> message;
+  message.Init(0);
+  std::vector<Clock::time_point> stamps;
+  stamps.reserve(frameCount + 1);
+  uint64_t checksum = 0;
+  for (uint32_t id = 1; id <= options.messageIDs; id++)
+  {
+    message.RegisterCallback(
+      {id, [&stamps, &checksum](const int32_t *args, uint32_t length) {
+         stamps.push_back(Clock::now());
+         checksum += static_cast<uint32_t>(args[length - 1]);
+         return true;
+       },
+       nullptr});
+  }
+
+  std::vector<int64_t> gaps;
+  gaps.reserve(static_cast<size_t>(frameCount) * repetitions);
+  uint64_t frames = 0;
+  double seconds = 0;
+  for (uint32_t rep = 0; rep < repetitions; rep++)
+  {
+    stamps.clear();
+    message.SetInput(stream.data(), stream.size());
+    Clock::time_point start = Clock::now();
+    stamps.push_back(start);
+    while (message.GetRemainingInput() > 0)
+    {
+      message.Update();
+    }
+    seconds += std::chrono::duration<double>(Clock::now() - start).count();
+    frames += stamps.size() - 1;
+    for (size_t i = 1; i < stamps.size(); i++)
+    {
+      gaps.push_back(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+          stamps[i] - stamps[i - 1])
+          .count());
+    }
+  }
+
+  std::sort(gaps.begin(), gaps.end());
+  auto percentile = [&gaps](double p) -> long long {
+    return gaps.empty() ? 0 : gaps[static_cast<size_t>(p * (gaps.size() - 1))];
+  };
+  double bytes = static_cast<double>(stream.size()) * repetitions;
+  std::printf(
+    "{\"bench\":\"BufferMessage\",\"case\":\"%s\",\"buffer_size\":%u,"
+    "\"max_args\":%u,\"frames\":%llu,\"bytes\":%.0f,\"seconds\":%.6f,"
+    "\"frames_per_s\":%.0f,\"mb_per_s\":%.1f,\"p50_ns\":%lld,"
+    "\"p99_ns\":%lld,\"p999_ns\":%lld,\"checksum\":%llu}\n",
+    name,
+    static_cast<unsigned>(SIZE),
+    static_cast<unsigned>(ARGS),
+    static_cast<unsigned long long>(frames),
+    bytes,
+    seconds,
+    frames / seconds,
+    bytes / seconds / 1e6,
+    percentile(0.5),
+    percentile(0.99),
+    percentile(0.999),
+    static_cast<unsigned long long>(checksum));
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+  if (argc > 1)
+  {
+    frameCount = std::strtoul(argv[1], nullptr, 10);
+  }
+  if (argc > 2)
+  {
+    repetitions = std::strtoul(argv[2], nullptr, 10);
+  }
+
+  MESSAGE_BENCH::GeneratorOptions options;
+  options.maxArgs = 4;
+  options.maxDigits = 3;
+  runCase<32, 4>("4 args, 3 digits", options);
+
+  options.maxArgs = 8;
+  options.maxDigits = 5;
+  runCase<64, 8>("8 args, 5 digits", options);
+  runCase<256, 16>("8 args, 5 digits", options);
+
+  options.maxArgs = 16;
+  options.maxDigits = 9;
+  runCase<256, 16>("16 args, 9 digits", options);
+
+  options.maxArgs = 8;
+  options.maxDigits = 5;
+  options.noiseBytes = 16;
+  runCase<64, 8>("8 args + 16B noise", options);
+
+  options.noiseBytes = 0;
+  options.oversizedEvery = 10;
+  options.oversizedLength = 100;
+  runCase<64, 8>("1 in 10 oversized", options);
+  return 0;
+}
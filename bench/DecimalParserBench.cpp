@@ -0,0 +1,146 @@
+/**
+ * @file DecimalParserBench.cpp
+ * @brief Measures ns per value for the DecimalParser functions and the C
+ * library functions they replace. Prints one JSON object per line.
+ *
+ * Usage: DecimalParserBench [values] [repetitions]
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "DecimalParser.h"
+
+namespace
+{
+/**
+ * @brief Times convert over every text and prints the JSON line
+ */
+template <typename CONVERT>
+void run(
+  const char *function,
+  const char *input,
+  const std::vector<std::string> &texts,
+  uint32_t repetitions,
+  CONVERT &&convert)
+{
+  double sum = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (uint32_t rep = 0; rep < repetitions; rep++)
+  {
+    for (const std::string &text : texts)
+    {
+      sum += convert(text);
+    }
+  }
+  double seconds = std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+  double values = static_cast<double>(texts.size()) * repetitions;
+  std::printf(
+    "{\"bench\":\"DecimalParser\",\"function\":\"%s\",\"input\":\"%s\","
+    "\"values\":%.0f,\"seconds\":%.6f,\"ns_per_value\":%.2f,"
+    "\"checksum\":%g}\n",
+    function,
+    input,
+    values,
+    seconds,
+    seconds * 1e9 / values,
+    sum);
+}
+
+/**
+ * @brief count decimals with the given number of digits, the point somewhere
+ * in them and an exponent of up to maxExponent either way
+ */
+std::vector<std::string> makeDecimals(
+  uint32_t count,
+  uint32_t digits,
+  int32_t maxExponent)
+{
+  std::mt19937 rng(3);
+  std::uniform_int_distribution<uint32_t> pick(0, 0x7FFFFFFF);
+  std::vector<std::string> texts;
+  for (uint32_t i = 0; i < count; i++)
+  {
+    std::string text = pick(rng) % 2 == 0 ? "-" : "";
+    uint32_t point = pick(rng) % digits;
+    for (uint32_t d = 0; d < digits; d++)
+    {
+      text += static_cast<char>((d == 0 ? '1' : '0') + pick(rng) % 9);
+      if (d == point)
+      {
+        text += '.';
+      }
+    }
+    if (maxExponent != 0)
+    {
+      int32_t exponent = static_cast<int32_t>(pick(rng) % (2 * maxExponent)) -
+                         maxExponent;
+      text += 'e' + std::to_string(exponent);
+    }
+    texts.push_back(text);
+  }
+  return texts;
+}
+
+template <typename TEXTS>
+void runFloats(const char *input, const TEXTS &texts, uint32_t repetitions)
+{
+  run("ParseFloat", input, texts, repetitions, [](const std::string &text) {
+    float value = 0;
+    MESSAGE_ASCII::ParseFloat(text.data(), text.size(), value);
+    return value;
+  });
+  run("strtof", input, texts, repetitions, [](const std::string &text) {
+    return std::strtof(text.c_str(), nullptr);
+  });
+  run("strtod", input, texts, repetitions, [](const std::string &text) {
+    return std::strtod(text.c_str(), nullptr);
+  });
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+  uint32_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+  uint32_t repetitions = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 10;
+
+  // -1234.56 style values take the single float operation path
+  runFloats("6 digits", makeDecimals(count, 6, 0), repetitions);
+  // these need the double estimate and the exact check
+  runFloats("9 digits, e+-30", makeDecimals(count, 9, 30), repetitions);
+  runFloats("40 digits, e+-30", makeDecimals(count, 40, 30), repetitions);
+
+  std::vector<std::string> texts = makeDecimals(count, 6, 0);
+  run("ParseFixed<16>", "6 digits", texts, repetitions,
+      [](const std::string &text) {
+        MESSAGE_INTF::Fixed<16> value{0};
+        MESSAGE_ASCII::ParseFixed(text.data(), text.size(), value);
+        return value.raw;
+      });
+
+  texts.clear();
+  std::mt19937_64 rng(5);
+  for (uint32_t i = 0; i < count; i++)
+  {
+    texts.push_back(std::to_string(static_cast<int64_t>(rng())));
+  }
+  run("ParseInt64", "64 bit integers", texts, repetitions,
+      [](const std::string &text) {
+        int64_t value = 0;
+        MESSAGE_ASCII::ParseInt64(text.data(), text.size(), value);
+        return static_cast<double>(value);
+      });
+  run("strtoll", "64 bit integers", texts, repetitions,
+      [](const std::string &text) {
+        return static_cast<double>(std::strtoll(text.c_str(), nullptr, 10));
+      });
+  return 0;
+}
@@ -0,0 +1,134 @@
+/**
+ * @file DelegateBench.cpp
+ * @brief Measures ns per call through a raw function pointer, through a
+ * CallbackDelegate holding a plain function, a capturing lambda or a bound
+ * member function, and through std::function with a capture that fits its
+ * small buffer and one that doesn't. The callables sit in a table that is
+ * read through a volatile index, so the compiler can't see which one is
+ * called. Prints one JSON object per line with the median and the fastest
+ * of the repetitions, and the size of each kind of callable.
+ *
+ * Usage: DelegateBench [calls] [repetitions]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+#include "MESSAGE-INTF.h"
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+uint32_t calls = 10000000;
+uint32_t repetitions = 9;
+
+struct Counter
+{
+  uint64_t total{0};
+
+  bool Add(const int32_t *args, uint32_t length)
+  {
+    total += static_cast<uint32_t>(args[0]) + length;
+    return true;
+  }
+};
+
+Counter counter;
+
+bool addArgs(const int32_t *args, uint32_t length)
+{
+  counter.total += static_cast<uint32_t>(args[0]) + length;
+  return true;
+}
+
+volatile uint32_t slot = 0;
+
+/**
+ * @brief Calls the callable in table[slot] calls times and prints the ns
+ * per call
+ */
+template <typename CALLABLE>
+void run(const char *kind, const CALLABLE (&table)[4])
+{
+  std::vector<double> ns;
+  int32_t args[2] = {1, 2};
+  for (uint32_t rep = 0; rep < repetitions; rep++)
+  {
+    counter.total = 0;
+    Clock::time_point start = Clock::now();
+    for (uint32_t i = 0; i < calls; i++)
+    {
+      table[slot](args, 2);
+    }
+    ns.push_back(
+      std::chrono::duration<double, std::nano>(Clock::now() - start)
+        .count() /
+      calls);
+  }
+  std::sort(ns.begin(), ns.end());
+  std::printf(
+    "{\"bench\":\"Delegate\",\"kind\":\"%s\",\"bytes\":%zu,"
+    "\"median_ns\":%.3f,\"min_ns\":%.3f,\"checksum\":%llu}\n",
+    kind,
+    sizeof(CALLABLE),
+    ns[ns.size() / 2],
+    ns[0],
+    static_cast<unsigned long long>(counter.total));
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+  if (argc > 1)
+  {
+    calls = std::strtoul(argv[1], nullptr, 10);
+  }
+  if (argc > 2)
+  {
+    repetitions = std::strtoul(argv[2], nullptr, 10);
+  }
+  if (calls == 0 || repetitions == 0)
+  {
+    return 1;
+  }
+
+  using Function = bool (*)(const int32_t *, uint32_t);
+  using MESSAGE_INTF::CallbackDelegate;
+  Counter *target = &counter;
+  auto lambda = [target](const int32_t *args, uint32_t length)
+  { return target->Add(args, length); };
+  CallbackDelegate bound =
+    CallbackDelegate::Bind<Counter, &Counter::Add>(&counter);
+  // three pointers don't fit in std::function's small buffer
+  Counter *a = &counter;
+  Counter *b = &counter;
+  auto wide = [target, a, b](const int32_t *args, uint32_t length)
+  { return (a == b ? target : a)->Add(args, length); };
+
+  const Function raw[4] = {addArgs, addArgs, addArgs, addArgs};
+  const CallbackDelegate plain[4] = {addArgs, addArgs, addArgs, addArgs};
+  const CallbackDelegate capturing[4] = {lambda, lambda, lambda, lambda};
+  const CallbackDelegate member[4] = {bound, bound, bound, bound};
+  const std::function<bool(const int32_t *, uint32_t)> small[4] = {
+    lambda, lambda, lambda, lambda};
+  const std::function<bool(const int32_t *, uint32_t)> large[4] = {
+    wide, wide, wide, wide};
+
+  run("raw function pointer", raw);
+  run("delegate, plain function", plain);
+  run("delegate, capturing lambda", capturing);
+  run("delegate, bound member", member);
+  run("std::function, 8 B capture", small);
+  run("std::function, 24 B capture", large);
+  std::printf(
+    "{\"bench\":\"Delegate\",\"kind\":\"Callback table slot\","
+    "\"bytes\":%zu}\n",
+    sizeof(MESSAGE_INTF::Callback));
+  return 0;
+}
@@ -0,0 +1,171 @@
+/**
+ * @file DispatchBench.cpp
+ * @brief Measures ns per frame through BufferMessage with 8, 64 and 256
+ * registered handlers, once found through the dispatch table and once
+ * through the linear scan over every registered callback that Message used
+ * before. Both run the same parser on the same frames, the scan is done by
+ * a FrameSink that takes every frame before the table is looked at. The
+ * message IDs are either 1 to n, which index the table directly, or spread
+ * over the whole 32 bits, which are hashed. Prints one JSON object per line
+ * with the median of the repetitions.
+ *
+ * Usage: DispatchBench [frames] [repetitions]
+ */
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "BufferMessage.h"
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+uint32_t frameCount = 200000;
+uint32_t repetitions = 7;
+
+uint64_t checksum = 0;
+
+bool sumArgs(const int32_t *args, uint32_t length)
+{
+  checksum += static_cast<uint32_t>(args[length - 1]);
+  return true;
+}
+
+/**
+ * @brief Calls every callback registered for the frame's message ID by
+ * checking each registered callback in turn, as Message did before it had
+ * a dispatch table
+ */
+template <uint32_t MAX_CALLBACKS>
+struct LinearSink : public MESSAGE_INTF::FrameSink
+{
+  std::array<MESSAGE_INTF::Callback, MAX_CALLBACKS> callbacks;
+  uint32_t numRegisteredCallbacks{0};
+
+  bool Deliver(const MESSAGE_INTF::FrameView &frame) override
+  {
+    bool dataProcessed = false;
+    for (uint32_t i = 0; i < numRegisteredCallbacks; i++)
+    {
+      if (callbacks[i].messageID == static_cast<uint32_t>(frame.args[0]))
+      {
+        dataProcessed |= callbacks[i].function(frame.args, frame.length);
+      }
+    }
+    return dataProcessed;
+  }
+};
+
+/**
+ * @brief Times Update() over stream and prints ns per frame for both ways
+ */
+template <uint32_t HANDLERS>
+void runCase(const char *ids, const std::vector<uint32_t> &messageIDs)
+{
+  std::mt19937 rng(HANDLERS);
+  std::string stream;
+  for (uint32_t i = 0; i < frameCount; i++)
+  {
+    stream += "!" + std::to_string(messageIDs[rng() % HANDLERS]) + "," +
+              std::to_string(rng() % 1000) + ";";
+  }
+
+  BufferMessage<64, 4, HANDLERS> table;
+  LinearSink<HANDLERS> linear;
+  BufferMessage<64, 4, HANDLERS> scanned;
+  scanned.SetFrameSink(&linear);
+  for (uint32_t id : messageIDs)
+  {
+    table.RegisterCallback({id, sumArgs, nullptr});
+    linear.callbacks[linear.numRegisteredCallbacks] = {id, sumArgs, nullptr};
+    linear.numRegisteredCallbacks++;
+  }
+
+  // alternate the two so drift in the machine hits both the same
+  std::vector<double> tableNs;
+  std::vector<double> linearNs;
+  uint64_t sums[2] = {0, 0};
+  for (uint32_t rep = 0; rep < repetitions; rep++)
+  {
+    for (uint32_t way = 0; way < 2; way++)
+    {
+      BufferMessage<64, 4, HANDLERS> &message = way == 0 ? table : scanned;
+      checksum = 0;
+      message.SetInput(stream.data(), static_cast<uint32_t>(stream.size()));
+      Clock::time_point start = Clock::now();
+      while (message.GetRemainingInput() > 0)
+      {
+        message.Update();
+      }
+      double ns =
+        std::chrono::duration<double, std::nano>(Clock::now() - start)
+          .count() /
+        frameCount;
+      (way == 0 ? tableNs : linearNs).push_back(ns);
+      sums[way] = checksum;
+    }
+  }
+
+  std::sort(tableNs.begin(), tableNs.end());
+  std::sort(linearNs.begin(), linearNs.end());
+  const char *names[2] = {"dispatch table", "linear scan"};
+  const std::vector<double> *results[2] = {&tableNs, &linearNs};
+  for (uint32_t way = 0; way < 2; way++)
+  {
+    std::printf(
+      "{\"bench\":\"Dispatch\",\"handlers\":%u,\"ids\":\"%s\","
+      "\"way\":\"%s\",\"frames\":%u,\"median_ns\":%.2f,"
+      "\"checksum\":%llu}\n",
+      static_cast<unsigned>(HANDLERS),
+      ids,
+      names[way],
+      static_cast<unsigned>(frameCount),
+      (*results[way])[results[way]->size() / 2],
+      static_cast<unsigned long long>(sums[way]));
+  }
+}
+
+template <uint32_t HANDLERS>
+void runHandlers()
+{
+  std::vector<uint32_t> dense;
+  std::vector<uint32_t> sparse;
+  std::mt19937 rng(7);
+  for (uint32_t i = 1; i <= HANDLERS; i++)
+  {
+    dense.push_back(i);
+    sparse.push_back(rng() & 0x7FFFFFFF);
+  }
+  runCase<HANDLERS>("1 to n", dense);
+  runCase<HANDLERS>("sparse", sparse);
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+  if (argc > 1)
+  {
+    frameCount = std::strtoul(argv[1], nullptr, 10);
+  }
+  if (argc > 2)
+  {
+    repetitions = std::strtoul(argv[2], nullptr, 10);
+  }
+  if (frameCount == 0 || repetitions == 0)
+  {
+    return 1;
+  }
+
+  runHandlers<8>();
+  runHandlers<64>();
+  runHandlers<256>();
+  return 0;
+}
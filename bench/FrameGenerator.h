@@ -0,0 +1,85 @@
+/**
+ * @file FrameGenerator.h
+ * @brief Builds reproducible streams of ASCII frames for the benchmarks. The
+ * same options and seed always give the same bytes.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <string>
+
+namespace MESSAGE_BENCH
+{
+/**
+ * @brief What the generated frames look like
+ */
+struct GeneratorOptions
+{
+  uint32_t minArgs{1};          // args per frame, including the message ID
+  uint32_t maxArgs{8};          // at most this many args per frame
+  uint32_t maxDigits{5};        // every value has 1 to maxDigits digits
+  uint32_t negativePercent{30}; // the share of values with a minus sign
+  uint32_t messageIDs{4};       // args[0] is a message ID from 1 to messageIDs
+  uint32_t noiseBytes{0};       // at most this much junk between frames
+  uint32_t oversizedEvery{0};   // every n-th frame is made too long...
+  uint32_t oversizedLength{0};  // ...by growing it past this many bytes
+  char startMarker{'!'};
+  char endMarker{';'};
+  char delimiter{','};
+};
+
+/**
+ * @brief Returns frameCount frames built the way options describes
+ * @param options what the frames look like
+ * @param frameCount the number of frames
+ * @param seed picks the values, the same seed gives the same stream
+ */
+inline std::string GenerateFrames(
+  const GeneratorOptions &options,
+  uint32_t frameCount,
+  uint32_t seed = 1)
+{
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<uint32_t> pick(0, 0x7FFFFFFF);
+  std::string stream;
+  for (uint32_t frame = 0; frame < frameCount; frame++)
+  {
+    if (options.noiseBytes > 0)
+    {
+      // junk that contains neither marker, like a line that dropped bytes
+      for (uint32_t i = pick(rng) % (options.noiseBytes + 1); i > 0; i--)
+      {
+        stream += static_cast<char>('a' + pick(rng) % 26);
+      }
+    }
+
+    stream += options.startMarker;
+    stream += std::to_string(1 + pick(rng) % options.messageIDs);
+    uint32_t argCount =
+      options.minArgs + pick(rng) % (options.maxArgs - options.minArgs + 1);
+    bool oversized =
+      options.oversizedEvery != 0 && frame % options.oversizedEvery == 0;
+    size_t frameStart = stream.size();
+    for (uint32_t arg = 1;
+         arg < argCount ||
+         (oversized && stream.size() - frameStart <= options.oversizedLength);
+         arg++)
+    {
+      stream += options.delimiter;
+      if (pick(rng) % 100 < options.negativePercent)
+      {
+        stream += '-';
+      }
+      uint32_t digits = 1 + pick(rng) % options.maxDigits;
+      for (uint32_t i = 0; i < digits; i++)
+      {
+        stream += static_cast<char>('0' + pick(rng) % 10);
+      }
+    }
+    stream += options.endMarker;
+  }
+  return stream;
+}
+} // namespace MESSAGE_BENCH
@@ -0,0 +1,143 @@
+/**
+ * @file MailboxBench.cpp
+ * @brief Measures ns per frame through BufferMessage for a Mailbox and for a
+ * plain handler that copies the same args into a global, and ns per Read()
+ * of a Mailbox nobody is writing to. Prints one JSON object per line with
+ * the median and the fastest of the repetitions.
+ *
+ * Usage: MailboxBench [frames] [repetitions]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "BufferMessage.h"
+#include "Mailbox.h"
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+/**
+ * @brief What the plain handler keeps, the same as a Mailbox<4> holds
+ */
+struct Latest
+{
+  int32_t args[4];
+  uint32_t populatedArgs;
+  uint32_t sequence;
+};
+
+Latest latest;
+
+bool copyLatest(const int32_t *args, uint32_t length)
+{
+  uint32_t stored = length < 4 ? length : 4;
+  for (uint32_t i = 0; i < stored; i++)
+  {
+    latest.args[i] = args[i];
+  }
+  latest.populatedArgs = stored;
+  latest.sequence++;
+  return true;
+}
+
+void print(const char *function, std::vector<double> &ns, uint64_t checksum)
+{
+  std::sort(ns.begin(), ns.end());
+  std::printf(
+    "{\"bench\":\"Mailbox\",\"function\":\"%s\",\"repetitions\":%zu,"
+    "\"median_ns\":%.2f,\"min_ns\":%.2f,\"checksum\":%llu}\n",
+    function,
+    ns.size(),
+    ns[ns.size() / 2],
+    ns[0],
+    static_cast<unsigned long long>(checksum));
+}
+
+/**
+ * @brief Times Update() over stream with callback registered for ID 7
+ * @return ns per frame
+ */
+double timeFrames(
+  const std::string &stream,
+  uint32_t frames,
+  const MESSAGE_INTF::Callback &callback)
+{
+  BufferMessage<64, 8, 4> message;
+  message.RegisterCallback(callback);
+  message.SetInput(stream.data(), stream.size());
+  Clock::time_point start = Clock::now();
+  while (message.GetRemainingInput() > 0)
+  {
+    message.Update();
+  }
+  return std::chrono::duration<double, std::nano>(Clock::now() - start)
+           .count() /
+         frames;
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+  uint32_t frames = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 300000;
+  uint32_t repetitions = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 9;
+  if (frames == 0 || repetitions == 0)
+  {
+    return 1;
+  }
+
+  std::string stream;
+  for (uint32_t i = 0; i < frames; i++)
+  {
+    int32_t value = static_cast<int32_t>(i);
+    stream += "!7," + std::to_string(value) + "," +
+              std::to_string(value * 3) + "," + std::to_string(-value) +
+              ";\r\n";
+  }
+
+  // alternate the two so drift in the machine hits both the same
+  std::vector<double> mailboxNs;
+  std::vector<double> handlerNs;
+  uint64_t mailboxChecksum = 0;
+  for (uint32_t rep = 0; rep < repetitions; rep++)
+  {
+    Mailbox<4> box;
+    mailboxNs.push_back(timeFrames(stream, frames, box.Bind(7)));
+    MESSAGE_INTF::Frame<4> frame{};
+    box.Read(frame);
+    mailboxChecksum += frame.sequence;
+
+    handlerNs.push_back(
+      timeFrames(stream, frames, {7, copyLatest, nullptr}));
+  }
+  print("Update() into a Mailbox", mailboxNs, mailboxChecksum);
+  print("Update() into a handler", handlerNs, latest.sequence);
+
+  std::vector<double> readNs;
+  uint64_t checksum = 0;
+  Mailbox<4> box;
+  int32_t args[4] = {7, 1, 2, 3};
+  box.Store(args, 4);
+  for (uint32_t rep = 0; rep < repetitions; rep++)
+  {
+    MESSAGE_INTF::Frame<4> frame{};
+    Clock::time_point start = Clock::now();
+    for (uint32_t i = 0; i < frames; i++)
+    {
+      box.Read(frame);
+      checksum += static_cast<uint32_t>(frame.args[i % 4]);
+    }
+    readNs.push_back(
+      std::chrono::duration<double, std::nano>(Clock::now() - start)
+        .count() /
+      frames);
+  }
+  print("Mailbox::Read", readNs, checksum);
+  return 0;
+}
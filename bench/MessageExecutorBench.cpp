@@ -0,0 +1,162 @@
+/**
+ * @file MessageExecutorBench.cpp
+ * @brief Times request/reply round trips to an echo peer thread over a
+ * socketpair, once with a coroutine awaiting every reply on MessageExecutor
+ * and once with the poll() and Update() loop it replaces. The rounds are
+ * interleaved so drift in the machine hits both the same. Prints one JSON
+ * object per round and way with the p50/p99/p99.9 round trip.
+ *
+ * Usage: MessageExecutorBench [round trips] [rounds]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "FdMessage.h"
+#include "MessageExecutor.h"
+
+namespace
+{
+using Link = FdMessage<64, 8, 4>;
+using Executor = MessageExecutor<1, 8>;
+using Clock = std::chrono::steady_clock;
+
+/**
+ * @brief Answers every !1,x; with !2,x; until it gets !9;
+ */
+void echo(int fd)
+{
+  Link peer(fd);
+  peer.Init(0);
+  bool done = false;
+  peer.RegisterCallback(
+    {1,
+     [&peer](const int32_t *args, uint32_t length) {
+       return length == 2 && peer.Send(2, args[1]);
+     },
+     nullptr});
+  peer.RegisterCallback({9,
+                         [&done](const int32_t *args, uint32_t length) {
+                           done = true;
+                           return true;
+                         },
+                         nullptr});
+  struct pollfd readable = {fd, POLLIN, 0};
+  while (!done && poll(&readable, 1, -1) > 0)
+  {
+    peer.Update();
+    if ((readable.revents & (POLLHUP | POLLERR)) != 0)
+    {
+      return;
+    }
+  }
+}
+
+std::vector<int64_t> roundTrips;
+uint32_t wrongReplies = 0;
+
+MESSAGE_INTF::Task awaitReplies(Executor &executor, Link &link, int32_t count)
+{
+  for (int32_t i = 0; i < count; i++)
+  {
+    Clock::time_point sent = Clock::now();
+    link.Send(1, i);
+    MESSAGE_INTF::Frame<8> reply = co_await executor.Next(&link, 2);
+    roundTrips.push_back(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+        Clock::now() - sent)
+        .count());
+    wrongReplies += reply.populatedArgs == 2 && reply.args[1] == i ? 0 : 1;
+  }
+}
+
+void pollReplies(Link &link, int fd, int32_t count)
+{
+  struct pollfd readable = {fd, POLLIN, 0};
+  for (int32_t i = 0; i < count; i++)
+  {
+    Clock::time_point sent = Clock::now();
+    link.Send(1, i);
+    bool replied = false;
+    while (!replied)
+    {
+      poll(&readable, 1, 1000);
+      link.Update();
+      if (link.IsNewData())
+      {
+        replied = link.GetArgs()[0] == 2;
+        wrongReplies += replied && link.GetArgs()[1] != i ? 1 : 0;
+        link.ClearNewData();
+      }
+    }
+    roundTrips.push_back(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+        Clock::now() - sent)
+        .count());
+  }
+}
+
+void print(const char *way, uint32_t round)
+{
+  std::sort(roundTrips.begin(), roundTrips.end());
+  auto percentile = [](double p) -> long long {
+    return roundTrips[static_cast<size_t>(p * (roundTrips.size() - 1))];
+  };
+  std::printf(
+    "{\"bench\":\"MessageExecutor\",\"way\":\"%s\",\"round\":%u,"
+    "\"round_trips\":%zu,\"p50_ns\":%lld,\"p99_ns\":%lld,\"p999_ns\":%lld,"
+    "\"wrong_replies\":%u}\n",
+    way,
+    static_cast<unsigned>(round),
+    roundTrips.size(),
+    percentile(0.5),
+    percentile(0.99),
+    percentile(0.999),
+    static_cast<unsigned>(wrongReplies));
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+  int32_t count = argc > 1 ? std::atoi(argv[1]) : 20000;
+  uint32_t rounds = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 5;
+
+  int fds[2];
+  if (count <= 0 || socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+  {
+    return 1;
+  }
+  std::thread peer(echo, fds[1]);
+  Link link(fds[0]);
+  link.Init(0);
+  roundTrips.reserve(count);
+
+  for (uint32_t round = 0; round < rounds; round++)
+  {
+    roundTrips.clear();
+    {
+      Executor executor;
+      executor.Register(&link, fds[0]);
+      awaitReplies(executor, link, count);
+      executor.Run();
+    }
+    print("coroutine", round);
+
+    roundTrips.clear();
+    pollReplies(link, fds[0], count);
+    print("poll loop", round);
+  }
+
+  link.Send(9);
+  peer.join();
+  close(fds[0]);
+  close(fds[1]);
+  return 0;
+}
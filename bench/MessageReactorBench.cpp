@@ -0,0 +1,312 @@
+/**
+ * @file MessageReactorBench.cpp
+ * @brief Services 16 and 256 socketpair links, once with one thread calling
+ * Update() on every link in a loop, as a gateway would without a reactor,
+ * and once with MessageReactor on 1 and 4 threads. A feeder thread writes
+ * the same batches of frames to every link. Reports frames/s, the CPU the
+ * servicing threads used per frame, the CPU they burned while every link
+ * was idle, and the slowest wait from epoll to Update() any link saw.
+ * Prints one JSON object per line.
+ *
+ * Usage: MessageReactorBench [frames per link] [idle ms]
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "FdMessage.h"
+#include "MessageReactor.h"
+
+namespace
+{
+using Link = FdMessage<64, 4, 1>;
+using Clock = std::chrono::steady_clock;
+
+uint32_t framesPerLink = 2000;
+uint32_t idleMs = 200;
+
+/**
+ * @brief Counts the frames one link received
+ */
+struct Counter
+{
+  std::atomic<uint32_t> received{0};
+
+  bool OnFrame(const int32_t *args, uint32_t length)
+  {
+    received.store(
+      received.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return true;
+  }
+};
+
+/**
+ * @brief linkCount links and the sockets the feeder writes into
+ */
+struct Links
+{
+  std::vector<int> peers;
+  std::vector<Counter> counters;
+  std::vector<Link> links;
+
+  explicit Links(uint32_t linkCount) : counters(linkCount)
+  {
+    // the callbacks and the reactor keep pointers, so nothing may move
+    links.reserve(linkCount);
+    for (uint32_t i = 0; i < linkCount; i++)
+    {
+      int fds[2];
+      if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+      {
+        std::printf("socketpair() failed\n");
+        std::exit(1);
+      }
+      peers.push_back(fds[1]);
+      links.emplace_back(fds[0]);
+      links.back().Init(0);
+      links.back().RegisterCallback(
+        {1,
+         MESSAGE_INTF::CallbackDelegate::Bind<Counter, &Counter::OnFrame>(
+           &counters[i]),
+         nullptr});
+    }
+  }
+
+  ~Links()
+  {
+    for (uint32_t i = 0; i < links.size(); i++)
+    {
+      close(links[i].GetFd());
+      close(peers[i]);
+    }
+  }
+
+  uint64_t Received() const
+  {
+    uint64_t total = 0;
+    for (const Counter &counter : counters)
+    {
+      total += counter.received.load(std::memory_order_relaxed);
+    }
+    return total;
+  }
+};
+
+uint64_t threadCpuNs()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+  return static_cast<uint64_t>(now.tv_sec) * 1000000000u +
+         static_cast<uint64_t>(now.tv_nsec);
+}
+
+/**
+ * @brief Writes framesPerLink frames to every link, 50 to a link at a time
+ */
+void feed(const Links &links)
+{
+  for (uint32_t first = 0; first < framesPerLink; first += 50)
+  {
+    std::string batch;
+    for (uint32_t i = first; i < first + 50 && i < framesPerLink; i++)
+    {
+      batch += "!1," + std::to_string(i) + ",7;";
+    }
+    for (int peer : links.peers)
+    {
+      const char *data = batch.data();
+      size_t left = batch.size();
+      while (left > 0)
+      {
+        ssize_t written = write(peer, data, left);
+        if (written <= 0)
+        {
+          return;
+        }
+        data += written;
+        left -= static_cast<size_t>(written);
+      }
+    }
+  }
+}
+
+void print(
+  const char *way,
+  uint32_t linkCount,
+  uint32_t threads,
+  double seconds,
+  uint64_t busyCpuNs,
+  uint64_t idleCpuNs,
+  uint64_t maxWaitNs)
+{
+  uint64_t frames = static_cast<uint64_t>(framesPerLink) * linkCount;
+  std::printf(
+    "{\"bench\":\"MessageReactor\",\"way\":\"%s\",\"links\":%u,"
+    "\"threads\":%u,\"frames\":%llu,\"frames_per_s\":%.0f,"
+    "\"cpu_ns_per_frame\":%.1f,\"idle_cpu_ms\":%.2f,\"idle_ms\":%u,"
+    "\"max_wait_us\":%.1f}\n",
+    way,
+    static_cast<unsigned>(linkCount),
+    static_cast<unsigned>(threads),
+    static_cast<unsigned long long>(frames),
+    frames / seconds,
+    static_cast<double>(busyCpuNs) / frames,
+    idleCpuNs / 1e6,
+    static_cast<unsigned>(idleMs),
+    maxWaitNs / 1e3);
+}
+
+/**
+ * @brief One thread calls Update() on every link in turn until told to stop
+ */
+void runLoop(uint32_t linkCount)
+{
+  Links links(linkCount);
+  uint64_t frames = static_cast<uint64_t>(framesPerLink) * linkCount;
+  std::atomic<bool> idle{false};
+  std::atomic<bool> done{false};
+  std::atomic<uint64_t> busyCpuNs{0};
+  std::atomic<uint64_t> idleCpuNs{0};
+  std::thread loop(
+    [&]()
+    {
+      while (links.Received() < frames)
+      {
+        for (Link &link : links.links)
+        {
+          link.Update();
+        }
+      }
+      busyCpuNs.store(threadCpuNs());
+      while (!idle.load())
+      {
+      }
+      uint64_t idleStart = threadCpuNs();
+      while (!done.load())
+      {
+        for (Link &link : links.links)
+        {
+          link.Update();
+        }
+      }
+      idleCpuNs.store(threadCpuNs() - idleStart);
+    });
+
+  Clock::time_point start = Clock::now();
+  feed(links);
+  while (busyCpuNs.load() == 0)
+  {
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+  double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  idle.store(true);
+  std::this_thread::sleep_for(std::chrono::milliseconds(idleMs));
+  done.store(true);
+  loop.join();
+  print(
+    "update loop",
+    linkCount,
+    1,
+    seconds,
+    busyCpuNs.load(),
+    idleCpuNs.load(),
+    0);
+}
+
+/**
+ * @brief Lets THREADS reactor threads service the links
+ */
+template <uint32_t LINKS, uint32_t THREADS>
+void runReactor()
+{
+  Links links(LINKS);
+  uint64_t frames = static_cast<uint64_t>(framesPerLink) * LINKS;
+  MessageReactor<LINKS, THREADS> reactor;
+  for (Link &link : links.links)
+  {
+    reactor.Register(&link, link.GetFd());
+  }
+  reactor.Start(THREADS);
+
+  Clock::time_point start = Clock::now();
+  feed(links);
+  while (links.Received() < frames)
+  {
+    std::this_thread::sleep_for(std::chrono::microseconds(100));
+  }
+  double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  uint64_t busyCpuNs = 0;
+  for (uint32_t thread = 0; thread < THREADS; thread++)
+  {
+    busyCpuNs += reactor.GetThreadCpuNs(thread);
+  }
+
+  // the threads only note their CPU time when they wake up, so wake every
+  // one of them after the idle period with a frame per link
+  std::this_thread::sleep_for(std::chrono::milliseconds(idleMs));
+  for (int peer : links.peers)
+  {
+    ssize_t written = write(peer, "!2;", 3);
+    (void)written;
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  reactor.Stop();
+  uint64_t totalCpuNs = 0;
+  for (uint32_t thread = 0; thread < THREADS; thread++)
+  {
+    totalCpuNs += reactor.GetThreadCpuNs(thread);
+  }
+
+  uint64_t maxWaitNs = 0;
+  for (uint32_t i = 0; i < LINKS; i++)
+  {
+    MESSAGE_INTF::LinkStats stats = reactor.GetLinkStats(i);
+    maxWaitNs = stats.maxWaitNs > maxWaitNs ? stats.maxWaitNs : maxWaitNs;
+  }
+  print(
+    "reactor",
+    LINKS,
+    THREADS,
+    seconds,
+    busyCpuNs,
+    totalCpuNs - busyCpuNs,
+    maxWaitNs);
+}
+
+template <uint32_t LINKS>
+void runLinks()
+{
+  runLoop(LINKS);
+  runReactor<LINKS, 1>();
+  runReactor<LINKS, 4>();
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+  if (argc > 1)
+  {
+    framesPerLink = std::strtoul(argv[1], nullptr, 10);
+  }
+  if (argc > 2)
+  {
+    idleMs = std::strtoul(argv[2], nullptr, 10);
+  }
+  if (framesPerLink == 0)
+  {
+    return 1;
+  }
+
+  runLinks<16>();
+  runLinks<256>();
+  return 0;
+}
@@ -0,0 +1,168 @@
+/**
+ * @file ParallelDecoderBench.cpp
+ * @brief Measures MB/s for decoding one large in-memory log with
+ * ParallelDecoder at several thread counts, against BatchDecoder on one
+ * thread and BufferMessage's parseData path with a FrameSink. Every way
+ * hands each frame to a handler that sums its args. Prints one JSON object
+ * per line with the median of the repetitions and the cores the machine
+ * has, which bounds what the threads can gain.
+ *
+ * Usage: ParallelDecoderBench [MiB] [repetitions]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "BatchDecoder.h"
+#include "BufferMessage.h"
+#include "FrameGenerator.h"
+#include "ParallelDecoder.h"
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+uint32_t repetitions = 5;
+
+/**
+ * @brief Sums the args of every frame, so the frames have to be decoded
+ */
+struct Summer
+{
+  uint64_t frames{0};
+  uint64_t sum{0};
+
+  void operator()(const int32_t *args, uint32_t populatedArgs, bool)
+  {
+    frames++;
+    for (uint32_t i = 0; i < populatedArgs; i++)
+    {
+      sum += static_cast<uint32_t>(args[i]);
+    }
+  }
+};
+
+/**
+ * @brief Takes the frames of a BufferMessage the way MessageExecutor does
+ */
+struct SummingSink : public MESSAGE_INTF::FrameSink
+{
+  Summer summer;
+
+  bool Deliver(const MESSAGE_INTF::FrameView &frame) override
+  {
+    summer(frame.args, frame.length, false);
+    return true;
+  }
+};
+
+/**
+ * @brief Runs decode repetitions times and prints the median MB/s
+ */
+template <typename DECODE>
+void run(
+  const char *input,
+  const char *way,
+  uint32_t threads,
+  const std::string &log,
+  DECODE &&decode)
+{
+  std::vector<double> seconds;
+  Summer summer;
+  for (uint32_t rep = 0; rep < repetitions; rep++)
+  {
+    summer = Summer();
+    Clock::time_point start = Clock::now();
+    decode(summer);
+    seconds.push_back(
+      std::chrono::duration<double>(Clock::now() - start).count());
+  }
+  std::sort(seconds.begin(), seconds.end());
+  double median = seconds[seconds.size() / 2];
+  std::printf(
+    "{\"bench\":\"ParallelDecoder\",\"input\":\"%s\",\"way\":\"%s\","
+    "\"threads\":%u,\"cores\":%u,\"bytes\":%zu,\"frames\":%llu,"
+    "\"median_s\":%.4f,\"mb_per_s\":%.1f,\"checksum\":%llu}\n",
+    input,
+    way,
+    static_cast<unsigned>(threads),
+    std::thread::hardware_concurrency(),
+    log.size(),
+    static_cast<unsigned long long>(summer.frames),
+    median,
+    log.size() / median / 1e6,
+    static_cast<unsigned long long>(summer.sum));
+}
+
+void runInput(const char *input, const std::string &log)
+{
+  run(input, "parseData", 1, log, [&log](Summer &summer) {
+    BufferMessage<64, 8, 1> message;
+    SummingSink sink;
+    message.SetFrameSink(&sink);
+    message.SetInput(log.data(), log.size());
+    while (message.GetRemainingInput() > 0)
+    {
+      message.Update();
+    }
+    summer = sink.summer;
+  });
+
+  run(input, "BatchDecoder", 1, log, [&log](Summer &summer) {
+    BatchDecoder<64, 8> decoder;
+    decoder.Decode(log.data(), static_cast<uint32_t>(log.size()), summer);
+  });
+
+  for (uint32_t threads : {1u, 2u, 4u, 8u})
+  {
+    auto decode = [&log, threads](Summer &summer) {
+      ParallelDecoder<64, 8> decoder(threads);
+      decoder.Decode(log.data(), log.size(), summer);
+    };
+    run(input, "ParallelDecoder", threads, log, decode);
+  }
+}
+
+/**
+ * @brief Generated frames, repeated until the log has about bytes bytes
+ */
+std::string makeLog(
+  const MESSAGE_BENCH::GeneratorOptions &options, size_t bytes)
+{
+  std::string block = MESSAGE_BENCH::GenerateFrames(options, 100000);
+  std::string log;
+  log.reserve(bytes + block.size());
+  while (log.size() < bytes)
+  {
+    log += block;
+  }
+  return log;
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+  size_t mebibytes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 64;
+  if (argc > 2)
+  {
+    repetitions = std::strtoul(argv[2], nullptr, 10);
+  }
+  if (mebibytes == 0 || mebibytes >= 4096 || repetitions == 0)
+  {
+    return 1;
+  }
+
+  MESSAGE_BENCH::GeneratorOptions options;
+  options.maxArgs = 6;
+  options.maxDigits = 5;
+  runInput("6 args, 5 digits", makeLog(options, mebibytes << 20));
+  options.maxDigits = 10;
+  runInput("6 args, 10 digits", makeLog(options, mebibytes << 20));
+  return 0;
+}
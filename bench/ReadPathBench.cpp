@@ -0,0 +1,323 @@
+/**
+ * @file ReadPathBench.cpp
+ * @brief Measures MB/s for getting the same frames off a transport four
+ * ways: the original per-byte loop (a virtual dataAvailable() and getChar()
+ * per byte, then strcpy(), strtok() and atoi() per frame), Message pulling
+ * one byte at a time through getChar(), Message pulling chunks through
+ * readBytes(), and BufferMessage parsing its input in place. The bytes come
+ * from memory behind a virtual interface like a driver's, so only the read
+ * path differs. Prints one JSON object per line with the median of the
+ * repetitions.
+ *
+ * Usage: ReadPathBench [frames] [repetitions]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "BufferMessage.h"
+#include "FrameGenerator.h"
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+uint32_t repetitions = 5;
+
+/**
+ * @brief A driver's receive buffer, called through virtual functions the way
+ * the original Message called its transport
+ */
+class ByteSource
+{
+public:
+  virtual ~ByteSource() = default;
+  virtual uint32_t available() = 0;
+  virtual char read() = 0;
+  virtual uint32_t readBytes(char *buffer, uint32_t length) = 0;
+};
+
+class MemorySource : public ByteSource
+{
+public:
+  void Reset(const std::string &bytes)
+  {
+    data = bytes.data();
+    length = static_cast<uint32_t>(bytes.size());
+    index = 0;
+  }
+
+  uint32_t available() override
+  {
+    return length - index;
+  }
+
+  char read() override
+  {
+    return index < length ? data[index++] : '\0';
+  }
+
+  uint32_t readBytes(char *buffer, uint32_t count) override
+  {
+    count = count < length - index ? count : length - index;
+    memcpy(buffer, data + index, count);
+    index += count;
+    return count;
+  }
+
+private:
+  const char *data{nullptr};
+  uint32_t length{0};
+  uint32_t index{0};
+};
+
+uint64_t checksum = 0;
+
+bool sumArgs(const int32_t *args, uint32_t length)
+{
+  for (uint32_t i = 0; i < length; i++)
+  {
+    checksum += static_cast<uint32_t>(args[i]);
+  }
+  return true;
+}
+
+/**
+ * @brief The receive path Message had before chunked reads: one frame per
+ * Update(), gathered a byte at a time, then copied and split with strtok()
+ */
+template <uint32_t SERIAL_BUFFER_SIZE, uint32_t MAX_ARGS>
+class PerByteReader
+{
+public:
+  explicit PerByteReader(ByteSource &source) : source(source)
+  {
+  }
+
+  void Update()
+  {
+    while (source.available() > 0 && state != DATA_RECIEVED)
+    {
+      char c = source.read();
+      if (state == RECIEVE_IN_PROGRESS)
+      {
+        if (c == ';')
+        {
+          data[ndx] = '\0';
+          ndx = 0;
+          state = DATA_RECIEVED;
+        }
+        else
+        {
+          data[ndx] = c;
+          ndx++;
+          if (ndx >= SERIAL_BUFFER_SIZE)
+          {
+            ndx = SERIAL_BUFFER_SIZE - 1;
+          }
+        }
+      }
+      else if (c == '!')
+      {
+        state = RECIEVE_IN_PROGRESS;
+      }
+    }
+    if (state == DATA_RECIEVED)
+    {
+      strcpy(tempData, data);
+      uint32_t populatedArgs = 0;
+      for (char *token = strtok(tempData, ",");
+           token != nullptr && populatedArgs < MAX_ARGS;
+           token = strtok(nullptr, ","))
+      {
+        args[populatedArgs] = atoi(token);
+        populatedArgs++;
+      }
+      state = IDLE;
+      sumArgs(args, populatedArgs);
+    }
+  }
+
+private:
+  enum SerialState : uint8_t
+  {
+    IDLE,
+    DATA_RECIEVED,
+    RECIEVE_IN_PROGRESS
+  };
+
+  ByteSource &source;
+  SerialState state{IDLE};
+  char data[SERIAL_BUFFER_SIZE];
+  char tempData[SERIAL_BUFFER_SIZE];
+  uint32_t ndx{0};
+  int32_t args[MAX_ARGS];
+};
+
+/**
+ * @brief A Message transport on a ByteSource, reading through readBytes()
+ * if BULK and through the default getChar() loop otherwise
+ */
+template <bool BULK>
+class SourceMessage : public Message<SourceMessage<BULK>, 64, 8, 8>
+{
+  friend class Message<SourceMessage, 64, 8, 8>;
+
+public:
+  explicit SourceMessage(ByteSource &source) : source(source)
+  {
+  }
+
+  void Init(uint32_t) override
+  {
+  }
+
+  void PrintArgs() override
+  {
+    this->printArgs();
+  }
+
+protected:
+  char getChar()
+  {
+    return source.read();
+  }
+
+  uint32_t dataAvailable()
+  {
+    return source.available();
+  }
+
+  uint32_t readBytes(char *buffer, uint32_t length)
+  {
+    if (BULK)
+    {
+      return source.readBytes(buffer, length);
+    }
+    return Message<SourceMessage, 64, 8, 8>::readBytes(buffer, length);
+  }
+
+  void writeBytes(const char *, uint32_t)
+  {
+  }
+
+private:
+  ByteSource &source;
+};
+
+template <typename MESSAGE>
+void registerSums(MESSAGE &message, uint32_t messageIDs)
+{
+  for (uint32_t id = 1; id <= messageIDs; id++)
+  {
+    message.RegisterCallback({id, sumArgs, nullptr});
+  }
+}
+
+/**
+ * @brief Runs read once per repetition and prints the median MB/s
+ */
+template <typename READ>
+void run(const char *input, const char *path, size_t bytes, READ &&read)
+{
+  std::vector<double> seconds;
+  uint64_t sum = 0;
+  for (uint32_t rep = 0; rep < repetitions; rep++)
+  {
+    checksum = 0;
+    Clock::time_point start = Clock::now();
+    read();
+    seconds.push_back(
+      std::chrono::duration<double>(Clock::now() - start).count());
+    sum = checksum;
+  }
+  std::sort(seconds.begin(), seconds.end());
+  double median = seconds[seconds.size() / 2];
+  std::printf(
+    "{\"bench\":\"ReadPath\",\"input\":\"%s\",\"path\":\"%s\","
+    "\"bytes\":%zu,\"median_s\":%.4f,\"mb_per_s\":%.1f,\"checksum\":%llu}\n",
+    input,
+    path,
+    bytes,
+    median,
+    bytes / median / 1e6,
+    static_cast<unsigned long long>(sum));
+}
+
+void runInput(
+  const char *input,
+  const MESSAGE_BENCH::GeneratorOptions &options,
+  uint32_t frames)
+{
+  std::string stream = MESSAGE_BENCH::GenerateFrames(options, frames);
+  MemorySource source;
+
+  run(input, "per-byte strtok", stream.size(), [&] {
+    source.Reset(stream);
+    PerByteReader<64, 8> reader(source);
+    while (source.available() > 0)
+    {
+      reader.Update();
+    }
+  });
+
+  run(input, "Message getChar", stream.size(), [&] {
+    source.Reset(stream);
+    SourceMessage<false> message(source);
+    registerSums(message, options.messageIDs);
+    while (source.available() > 0)
+    {
+      message.Update();
+    }
+  });
+
+  run(input, "Message readBytes", stream.size(), [&] {
+    source.Reset(stream);
+    SourceMessage<true> message(source);
+    registerSums(message, options.messageIDs);
+    while (source.available() > 0)
+    {
+      message.Update();
+    }
+  });
+
+  run(input, "BufferMessage in place", stream.size(), [&] {
+    BufferMessage<64, 8, 8> message;
+    registerSums(message, options.messageIDs);
+    message.SetInput(stream.data(), static_cast<uint32_t>(stream.size()));
+    while (message.GetRemainingInput() > 0)
+    {
+      message.Update();
+    }
+  });
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+  uint32_t frames = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 500000;
+  if (argc > 2)
+  {
+    repetitions = std::strtoul(argv[2], nullptr, 10);
+  }
+  if (frames == 0 || repetitions == 0)
+  {
+    return 1;
+  }
+
+  MESSAGE_BENCH::GeneratorOptions options;
+  options.maxArgs = 4;
+  options.maxDigits = 3;
+  runInput("4 args, 3 digits", options, frames);
+  options.maxArgs = 8;
+  options.maxDigits = 5;
+  options.noiseBytes = 16;
+  runInput("8 args, 5 digits, 16B noise", options, frames);
+  return 0;
+}
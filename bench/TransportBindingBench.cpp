@@ -0,0 +1,283 @@
+/**
+ * @file TransportBindingBench.cpp
+ * @brief Measures what binding the transport to Message statically saves on
+ * the per-byte receive path. Two transports parse the same frames one byte
+ * at a time through getChar() and dataAvailable(): one reads its memory
+ * directly, so Message can inline both calls, and one forwards them to a
+ * virtual interface, which costs what the virtual getChar() and
+ * dataAvailable() of the original Message did. Neither has readBytes(), so
+ * only the binding differs. Reports cycles per byte from the time stamp
+ * counter on x86 and ns per byte everywhere, the fastest of the repetitions.
+ * Prints one JSON object per line.
+ *
+ * Usage: TransportBindingBench [frames] [repetitions]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAVE_TSC 1
+#else
+#define BENCH_HAVE_TSC 0
+#endif
+
+#include "FrameGenerator.h"
+#include "Message.h"
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+uint32_t repetitions = 11;
+
+uint64_t checksum = 0;
+
+bool sumArgs(const int32_t *args, uint32_t length)
+{
+  for (uint32_t i = 0; i < length; i++)
+  {
+    checksum += static_cast<uint32_t>(args[i]);
+  }
+  return true;
+}
+
+/**
+ * @brief Bytes in memory
+ */
+struct Memory
+{
+  const char *data{nullptr};
+  uint32_t length{0};
+  uint32_t index{0};
+
+  void Reset(const std::string &bytes)
+  {
+    data = bytes.data();
+    length = static_cast<uint32_t>(bytes.size());
+    index = 0;
+  }
+};
+
+/**
+ * @brief The same bytes behind virtual functions, as a transport whose
+ * getChar() and dataAvailable() were virtual
+ */
+class ByteSource
+{
+public:
+  virtual ~ByteSource() = default;
+  virtual uint32_t available() = 0;
+  virtual char read() = 0;
+};
+
+class MemorySource : public ByteSource
+{
+public:
+  explicit MemorySource(Memory &memory) : memory(memory)
+  {
+  }
+
+  uint32_t available() override
+  {
+    return memory.length - memory.index;
+  }
+
+  char read() override
+  {
+    return memory.index < memory.length ? memory.data[memory.index++] : '\0';
+  }
+
+private:
+  Memory &memory;
+};
+
+/**
+ * @brief A transport that reads memory directly
+ */
+class StaticMessage : public Message<StaticMessage, 64, 8, 8>
+{
+  friend class Message<StaticMessage, 64, 8, 8>;
+
+public:
+  explicit StaticMessage(Memory &memory) : memory(memory)
+  {
+  }
+
+  void Init(uint32_t) override
+  {
+  }
+
+  void PrintArgs() override
+  {
+    this->printArgs();
+  }
+
+protected:
+  char getChar()
+  {
+    return memory.index < memory.length ? memory.data[memory.index++] : '\0';
+  }
+
+  uint32_t dataAvailable()
+  {
+    return memory.length - memory.index;
+  }
+
+  void writeBytes(const char *, uint32_t)
+  {
+  }
+
+private:
+  Memory &memory;
+};
+
+/**
+ * @brief A transport that reads memory through ByteSource
+ */
+class VirtualMessage : public Message<VirtualMessage, 64, 8, 8>
+{
+  friend class Message<VirtualMessage, 64, 8, 8>;
+
+public:
+  explicit VirtualMessage(ByteSource &source) : source(source)
+  {
+  }
+
+  void Init(uint32_t) override
+  {
+  }
+
+  void PrintArgs() override
+  {
+    this->printArgs();
+  }
+
+protected:
+  char getChar()
+  {
+    return source.read();
+  }
+
+  uint32_t dataAvailable()
+  {
+    return source.available();
+  }
+
+  void writeBytes(const char *, uint32_t)
+  {
+  }
+
+private:
+  ByteSource &source;
+};
+
+uint64_t timestamp()
+{
+#if BENCH_HAVE_TSC
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+/**
+ * @brief Parses memory with message once per repetition and prints the
+ * fastest run
+ */
+template <typename MESSAGE>
+void run(
+  const char *input,
+  const char *binding,
+  const std::string &stream,
+  Memory &memory,
+  MESSAGE &message,
+  uint32_t messageIDs)
+{
+  for (uint32_t id = 1; id <= messageIDs; id++)
+  {
+    message.RegisterCallback({id, sumArgs, nullptr});
+  }
+  double bestNs = 0;
+  uint64_t bestCycles = 0;
+  for (uint32_t rep = 0; rep < repetitions; rep++)
+  {
+    memory.Reset(stream);
+    checksum = 0;
+    Clock::time_point start = Clock::now();
+    uint64_t startCycles = timestamp();
+    while (memory.index < memory.length)
+    {
+      message.Update();
+    }
+    uint64_t cycles = timestamp() - startCycles;
+    double ns = std::chrono::duration<double, std::nano>(Clock::now() - start)
+                  .count();
+    if (rep == 0 || ns < bestNs)
+    {
+      bestNs = ns;
+      bestCycles = cycles;
+    }
+  }
+  double bytes = static_cast<double>(stream.size());
+  char cycles[32] = "null";
+  if (BENCH_HAVE_TSC)
+  {
+    std::snprintf(cycles, sizeof(cycles), "%.2f", bestCycles / bytes);
+  }
+  std::printf(
+    "{\"bench\":\"TransportBinding\",\"input\":\"%s\",\"binding\":\"%s\","
+    "\"bytes\":%zu,\"cycles_per_byte\":%s,\"ns_per_byte\":%.3f,"
+    "\"checksum\":%llu}\n",
+    input,
+    binding,
+    stream.size(),
+    cycles,
+    bestNs / bytes,
+    static_cast<unsigned long long>(checksum));
+}
+
+void runInput(
+  const char *input,
+  const MESSAGE_BENCH::GeneratorOptions &options,
+  uint32_t frames)
+{
+  std::string stream = MESSAGE_BENCH::GenerateFrames(options, frames);
+  Memory memory;
+
+  StaticMessage direct(memory);
+  run(input, "static", stream, memory, direct, options.messageIDs);
+
+  MemorySource source(memory);
+  VirtualMessage indirect(source);
+  run(input, "virtual", stream, memory, indirect, options.messageIDs);
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+  uint32_t frames = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 300000;
+  if (argc > 2)
+  {
+    repetitions = std::strtoul(argv[2], nullptr, 10);
+  }
+  if (frames == 0 || repetitions == 0)
+  {
+    return 1;
+  }
+
+  MESSAGE_BENCH::GeneratorOptions options;
+  options.maxArgs = 4;
+  options.maxDigits = 3;
+  runInput("4 args, 3 digits", options, frames);
+  options.maxArgs = 8;
+  options.maxDigits = 5;
+  options.noiseBytes = 16;
+  runInput("8 args, 5 digits, 16B noise", options, frames);
+  return 0;
+}
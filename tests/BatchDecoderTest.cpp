@@ -0,0 +1,258 @@
+/**
+ * @file BatchDecoderTest.cpp
+ * @brief Checks BatchDecoder against FrameParser, which is the reference for
+ * what a Message object delivers. Random streams of well formed frames, odd
+ * tokens and noise are decoded both ways, whole and split at random points,
+ * and every frame has to match. With a checksummed dialect the streams also
+ * carry frames with wrong or missing checksums and corrupted bytes, which
+ * both have to drop.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "BatchDecoder.h"
+#include "Check.h"
+
+namespace
+{
+struct Frame
+{
+  std::vector<int32_t> args;
+  bool argOverflow;
+
+  bool operator==(const Frame &other) const
+  {
+    return args == other.args && argOverflow == other.argOverflow;
+  }
+};
+
+/**
+ * @brief The frames a Message object would get from stream
+ */
+template <uint32_t SIZE, uint32_t ARGS, typename DIALECT>
+std::vector<Frame> referenceFrames(const std::string &stream)
+{
+  FrameParser<SIZE, ARGS, DIALECT> parser;
+  std::vector<Frame> frames;
+  uint32_t offset = 0;
+  while (offset < stream.size())
+  {
+    offset += parser.Parse(stream.data() + offset, stream.size() - offset);
+    if (parser.IsFrameComplete())
+    {
+      const int32_t *args = parser.GetArgs();
+      frames.push_back(Frame{
+        std::vector<int32_t>(args, args + parser.GetPopulatedArgs()),
+        parser.HasArgOverflow()});
+    }
+  }
+  return frames;
+}
+
+/**
+ * @brief The frames BatchDecoder gets from stream when it arrives in pieces
+ * that end at the offsets in cuts. Whatever a call doesn't consume is passed
+ * in again at the front of the next piece.
+ */
+template <uint32_t SIZE, uint32_t ARGS, typename DIALECT>
+std::vector<Frame> batchFrames(
+  const std::string &stream,
+  const std::vector<uint32_t> &cuts)
+{
+  BatchDecoder<SIZE, ARGS, DIALECT> decoder;
+  std::vector<Frame> frames;
+  std::string pending;
+  uint32_t offset = 0;
+  for (uint32_t cut : cuts)
+  {
+    pending.append(stream, offset, cut - offset);
+    offset = cut;
+    uint32_t consumed = decoder.Decode(
+      pending.data(),
+      pending.size(),
+      [&frames](const int32_t *args, uint32_t populatedArgs, bool overflow) {
+        frames.push_back(Frame{
+          std::vector<int32_t>(args, args + populatedArgs), overflow});
+      });
+    CHECK(consumed <= pending.size());
+    pending.erase(0, consumed);
+  }
+  return frames;
+}
+
+/**
+ * @brief A random token, mostly plain integers with every length from 1 to 12
+ * digits and the odd bit of text the fast path has to hand over
+ */
+std::string randomToken(std::mt19937 &rng)
+{
+  static const char *const ODD[] = {
+    "",    " 12",   "+7",   "-",    "--1", "1-2", "3.25", "-4e3", "x",
+    "\r",  "\n",    "12 ",  " ",    "+",   "0",   "-0",   "1e",   "5.",
+    "!",   "*1F",   "\t9",  "2147483647", "2147483648", "-2147483648",
+    "-2147483649", "99999999999999", "00000000000000042"};
+  std::uniform_int_distribution<uint32_t> pick(0, 99);
+  uint32_t kind = pick(rng);
+  if (kind < 15)
+  {
+    return ODD[pick(rng) % (sizeof(ODD) / sizeof(ODD[0]))];
+  }
+
+  std::string token = kind < 40 ? "-" : "";
+  uint32_t digits = 1 + pick(rng) % 12;
+  for (uint32_t i = 0; i < digits; i++)
+  {
+    token += static_cast<char>('0' + pick(rng) % 10);
+  }
+  return token;
+}
+
+/**
+ * @brief Puts `*XX` after the text of the frame that starts at textStart.
+ * Now and then the checksum is left out, wrong, or one byte of the frame is
+ * corrupted after it was computed.
+ */
+void appendChecksum(std::string &stream, size_t textStart, std::mt19937 &rng)
+{
+  static const char CORRUPT[] = "0123456789,-*!;x ";
+  static const char HEX[] = "0123456789ABCDEF";
+  std::uniform_int_distribution<uint32_t> pick(0, 99);
+  uint32_t kind = pick(rng);
+  if (kind < 3)
+  {
+    return;
+  }
+  uint8_t crc = MESSAGE_ASCII::Crc8(
+    stream.data() + textStart,
+    static_cast<uint32_t>(stream.size() - textStart));
+  if (kind < 6)
+  {
+    crc ^= static_cast<uint8_t>(1 + pick(rng) % 255);
+  }
+  stream += MESSAGE_ASCII::CHECKSUM_MARKER;
+  stream += HEX[crc >> 4];
+  stream += HEX[crc & 0x0F];
+  if (kind < 12)
+  {
+    size_t at = textStart + pick(rng) % (stream.size() - textStart);
+    stream[at] = CORRUPT[pick(rng) % (sizeof(CORRUPT) - 1)];
+  }
+}
+
+/**
+ * @brief Random frames in DIALECT, some with too many args or too long for
+ * the buffer, with noise and cut off frames between them. A checksummed
+ * DIALECT gets `*XX` on most frames, see appendChecksum().
+ */
+template <typename DIALECT>
+std::string randomStream(std::mt19937 &rng, uint32_t frameCount)
+{
+  std::uniform_int_distribution<uint32_t> pick(0, 99);
+  std::string stream;
+  for (uint32_t frame = 0; frame < frameCount; frame++)
+  {
+    uint32_t kind = pick(rng);
+    if (kind < 5)
+    {
+      // noise between frames
+      for (uint32_t i = pick(rng) % 20; i > 0; i--)
+      {
+        stream += static_cast<char>(pick(rng) < 50 ? 'a' + pick(rng) % 26
+                                                   : DIALECT::delimiter);
+      }
+    }
+
+    stream += DIALECT::startMarker;
+    size_t textStart = stream.size();
+    uint32_t tokens = kind < 10 ? 20 + pick(rng) % 40 : pick(rng) % 10;
+    for (uint32_t i = 0; i < tokens; i++)
+    {
+      if (i > 0)
+      {
+        stream += DIALECT::delimiter;
+      }
+      stream += randomToken(rng);
+    }
+    if (DIALECT::checksum)
+    {
+      appendChecksum(stream, textStart, rng);
+    }
+    // now and then the endMarker is lost and the next frame runs into this
+    if (pick(rng) != 0)
+    {
+      stream += DIALECT::endMarker;
+    }
+  }
+  return stream;
+}
+
+template <uint32_t SIZE, uint32_t ARGS, typename DIALECT>
+void checkRandomStreams(uint32_t seed)
+{
+  std::mt19937 rng(seed);
+  uint64_t frameCount = 0;
+  for (uint32_t round = 0; round < 200; round++)
+  {
+    std::string stream = randomStream<DIALECT>(rng, 300);
+    std::vector<Frame> expected = referenceFrames<SIZE, ARGS, DIALECT>(stream);
+
+    // the whole stream at once
+    std::vector<uint32_t> cuts{static_cast<uint32_t>(stream.size())};
+    CHECK((batchFrames<SIZE, ARGS, DIALECT>(stream, cuts) == expected));
+
+    // a few bytes at a time, like a serial port
+    cuts.clear();
+    std::uniform_int_distribution<uint32_t> piece(1, 3 * SIZE);
+    for (uint32_t cut = piece(rng); cut < stream.size(); cut += piece(rng))
+    {
+      cuts.push_back(cut);
+    }
+    cuts.push_back(stream.size());
+    CHECK((batchFrames<SIZE, ARGS, DIALECT>(stream, cuts) == expected));
+    frameCount += expected.size();
+  }
+  std::printf(
+    "SIZE=%u ARGS=%u: %llu frames matched\n",
+    static_cast<unsigned>(SIZE),
+    static_cast<unsigned>(ARGS),
+    static_cast<unsigned long long>(frameCount));
+}
+
+void checkKnownFrames()
+{
+  std::vector<Frame> frames = batchFrames<64, 4, MESSAGE_INTF::AsciiProtocol>(
+    "junk!1,-2,,345678901;!;!12345678,-87654321,1,2,3;!-2147483648;!9",
+    {65});
+  CHECK(frames.size() == 4);
+  if (frames.size() == 4)
+  {
+    CHECK((frames[0] == Frame{{1, -2, 345678901}, false}));
+    CHECK((frames[1] == Frame{{}, false}));
+    CHECK((frames[2] == Frame{{12345678, -87654321, 1, 2}, true}));
+    CHECK((frames[3] == Frame{{INT32_MIN}, false}));
+  }
+
+  // the unfinished frame is left for the next call
+  BatchDecoder<64, 4> decoder;
+  const char partial[] = "!1;!2,3";
+  uint32_t consumed = decoder.Decode(
+    partial, sizeof(partial) - 1, [](const int32_t *, uint32_t, bool) {});
+  CHECK(consumed == 3);
+}
+} // namespace
+
+int main()
+{
+  checkKnownFrames();
+  checkRandomStreams<64, 8, MESSAGE_INTF::AsciiProtocol>(1);
+  checkRandomStreams<50, 3, MESSAGE_INTF::AsciiProtocol>(2);
+  checkRandomStreams<256, 16, MESSAGE_INTF::AsciiProtocol>(3);
+  checkRandomStreams<64, 8, MESSAGE_INTF::AsciiDialect<'$', '\n', '|'>>(4);
+  checkRandomStreams<64, 8, MESSAGE_INTF::CheckedAsciiProtocol>(5);
+  checkRandomStreams<256, 16, MESSAGE_INTF::CheckedAsciiProtocol>(6);
+  return CheckFailures();
+}
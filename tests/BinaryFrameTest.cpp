@@ -0,0 +1,251 @@
+/**
+ * @file BinaryFrameTest.cpp
+ * @brief Checks the binary wire format: zigzag, CRC16 and COBS on their own,
+ * random frames encoded and parsed back in random pieces, and that frames
+ * with a wrong CRC, broken COBS, an overlong varint or no room in the buffer
+ * are dropped without losing the frame after them. Also sends frames from
+ * one BufferMessage to another over the binary protocol.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "BinaryFrameParser.h"
+#include "BufferMessage.h"
+#include "Check.h"
+
+namespace
+{
+using Parser = BinaryFrameParser<64, 8>;
+using Bytes = std::vector<uint8_t>;
+
+struct Frame
+{
+  std::vector<int32_t> args;
+  bool argOverflow;
+
+  bool operator==(const Frame &other) const
+  {
+    return args == other.args && argOverflow == other.argOverflow;
+  }
+};
+
+/**
+ * @brief Parses stream in pieces of 1 to maxPiece bytes
+ * @return every frame the parser completed
+ */
+std::vector<Frame> parseAll(
+  Parser &parser,
+  const Bytes &stream,
+  std::mt19937 &rng,
+  uint32_t maxPiece = 16)
+{
+  std::vector<Frame> frames;
+  size_t offset = 0;
+  while (offset < stream.size())
+  {
+    uint32_t piece = 1 + rng() % maxPiece;
+    if (piece > stream.size() - offset)
+    {
+      piece = static_cast<uint32_t>(stream.size() - offset);
+    }
+    uint32_t parsed = 0;
+    while (parsed < piece)
+    {
+      parsed += parser.Parse(
+        reinterpret_cast<const char *>(stream.data()) + offset + parsed,
+        piece - parsed);
+      if (parser.IsFrameComplete())
+      {
+        frames.push_back(Frame{
+          std::vector<int32_t>(
+            parser.GetArgs(), parser.GetArgs() + parser.GetPopulatedArgs()),
+          parser.HasArgOverflow()});
+      }
+    }
+    offset += piece;
+  }
+  return frames;
+}
+
+/**
+ * @brief Appends args encoded as a frame to stream
+ */
+void appendFrame(Bytes &stream, const std::vector<int32_t> &args)
+{
+  uint8_t out[256];
+  uint32_t length = MESSAGE_BINARY::EncodeFrame(
+    args.data(), static_cast<uint32_t>(args.size()), out, sizeof(out));
+  CHECK(length > 0);
+  stream.insert(stream.end(), out, out + length);
+}
+
+/**
+ * @brief Appends payload with its CRC as a frame to stream, so a test can
+ * put any bytes it likes into the varints
+ */
+void appendPayload(Bytes &stream, Bytes payload, bool breakCrc = false)
+{
+  uint16_t crc = MESSAGE_BINARY::Crc16(
+    payload.data(), static_cast<uint32_t>(payload.size()));
+  crc ^= breakCrc ? 1 : 0;
+  payload.push_back(static_cast<uint8_t>(crc >> 8));
+  payload.push_back(static_cast<uint8_t>(crc));
+  uint8_t out[512];
+  uint32_t length = MESSAGE_BINARY::CobsEncode(
+    payload.data(), static_cast<uint32_t>(payload.size()), out);
+  stream.insert(stream.end(), out, out + length);
+}
+
+void checkPrimitives()
+{
+  const int32_t values[] = {0, 1, -1, 63, -64, 64, INT32_MAX, INT32_MIN};
+  for (int32_t value : values)
+  {
+    CHECK(MESSAGE_BINARY::ZigZagDecode(MESSAGE_BINARY::ZigZagEncode(value)) ==
+          value);
+  }
+  CHECK(MESSAGE_BINARY::ZigZagEncode(-1) == 1);
+  CHECK(MESSAGE_BINARY::ZigZagEncode(1) == 2);
+  CHECK(MESSAGE_BINARY::ZigZagEncode(INT32_MIN) == 0xFFFFFFFFu);
+
+  // the CRC-16/CCITT-FALSE check value
+  const uint8_t check[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+  CHECK(MESSAGE_BINARY::Crc16(check, sizeof(check)) == 0x29B1);
+
+  uint8_t encoded[] = {0x03, 0x11, 0x22, 0x02, 0x33};
+  CHECK(MESSAGE_BINARY::CobsDecode(encoded, sizeof(encoded)) == 4);
+  CHECK(encoded[0] == 0x11 && encoded[2] == 0x00 && encoded[3] == 0x33);
+  // a zero code, or a code that runs past the end of the block
+  uint8_t zeroCode[] = {0x02, 0x11, 0x00, 0x22};
+  CHECK(MESSAGE_BINARY::CobsDecode(zeroCode, sizeof(zeroCode)) == -1);
+  uint8_t truncated[] = {0x05, 0x11, 0x22};
+  CHECK(MESSAGE_BINARY::CobsDecode(truncated, sizeof(truncated)) == -1);
+
+  // runs of more than 254 bytes without a zero need extra codes
+  std::mt19937 rng(3);
+  for (uint32_t length : {0u, 1u, 253u, 254u, 255u, 300u})
+  {
+    Bytes data(length);
+    for (uint8_t &byte : data)
+    {
+      byte = static_cast<uint8_t>(rng() % 8 == 0 ? 0 : 1 + rng() % 255);
+    }
+    Bytes out(length + length / 254 + 2);
+    uint32_t written = MESSAGE_BINARY::CobsEncode(data.data(), length, &out[0]);
+    CHECK(written <= out.size());
+    CHECK(memchr(out.data(), 0, written - 1) == nullptr);
+    CHECK(out[written - 1] == MESSAGE_BINARY::FRAME_DELIMITER);
+    CHECK(MESSAGE_BINARY::CobsDecode(&out[0], written - 1) ==
+          static_cast<int32_t>(length));
+    CHECK(std::equal(data.begin(), data.end(), out.begin()));
+  }
+}
+
+void checkRoundTrip()
+{
+  std::mt19937 rng(1);
+  Bytes stream;
+  std::vector<Frame> expected;
+  for (uint32_t frame = 0; frame < 2000; frame++)
+  {
+    std::vector<int32_t> args(rng() % 11);
+    for (int32_t &arg : args)
+    {
+      uint32_t kind = rng() % 4;
+      arg = kind == 0   ? static_cast<int32_t>(rng())
+            : kind == 1 ? (rng() % 2 == 0 ? INT32_MIN : INT32_MAX)
+                        : static_cast<int32_t>(rng() % 300) - 150;
+    }
+    appendFrame(stream, args);
+    // a frame with no args still has its CRC, so it isn't skipped
+    bool overflow = args.size() > 8;
+    if (overflow)
+    {
+      args.resize(8);
+    }
+    expected.push_back(Frame{args, overflow});
+  }
+  Parser parser;
+  CHECK(parseAll(parser, stream, rng) == expected);
+}
+
+void checkCorruptFrames()
+{
+  Bytes stream;
+  const Frame good{{7, -2, 300}, false};
+  // a payload byte flipped after the CRC was taken
+  appendPayload(stream, {14, 3}, true);
+  appendFrame(stream, good.args);
+  // COBS whose code runs past the delimiter
+  stream.insert(stream.end(), {0x09, 0x0E, 0x03, 0x00});
+  appendFrame(stream, good.args);
+  // the 5th byte of a varint with more than the top 4 bits set
+  appendPayload(stream, {14, 0xFF, 0xFF, 0xFF, 0xFF, 0x10});
+  appendFrame(stream, good.args);
+  // a varint that doesn't end within 5 bytes
+  appendPayload(stream, {14, 0x80, 0x80, 0x80, 0x80, 0x80, 0x01});
+  appendFrame(stream, good.args);
+  // a varint that runs into the CRC
+  appendPayload(stream, {14, 0x80});
+  appendFrame(stream, good.args);
+  // more bytes than the parser has room for
+  appendPayload(stream, Bytes(100, 0x02));
+  appendFrame(stream, good.args);
+  // the biggest 5 byte varint is INT32_MIN once unzigzagged
+  appendPayload(stream, {14, 0xFF, 0xFF, 0xFF, 0xFF, 0x0F});
+
+  std::mt19937 rng(2);
+  Parser parser;
+  std::vector<Frame> frames = parseAll(parser, stream, rng);
+  std::vector<Frame> expected(6, good);
+  expected.push_back(Frame{{7, INT32_MIN}, false});
+  CHECK(frames == expected);
+#ifdef MESSAGE_ENABLE_STATS
+  CHECK(parser.GetStats().parseErrors == 5);
+  CHECK(parser.GetStats().truncatedFrames == 1);
+#endif
+}
+
+void checkMessages()
+{
+  using Binary = MESSAGE_INTF::BinaryProtocol;
+  char wire[256];
+  BufferMessage<64, 8, 2, 1, Binary> sender;
+  sender.SetOutput(wire, sizeof(wire));
+  CHECK(sender.Send(9, -1, 1000000, INT32_MIN));
+  CHECK(sender.Send(9, 0));
+
+  BufferMessage<64, 8, 2, 1, Binary> receiver;
+  std::vector<std::vector<int32_t>> received;
+  std::vector<std::vector<int32_t>> *target = &received;
+  CHECK(receiver.RegisterCallback(
+    {9,
+     [target](const int32_t *args, uint32_t length)
+     {
+       target->push_back(std::vector<int32_t>(args, args + length));
+       return true;
+     },
+     nullptr}));
+  receiver.SetInput(wire, sender.GetOutputLength());
+  while (receiver.GetRemainingInput() > 0)
+  {
+    receiver.Update();
+  }
+  CHECK(received.size() == 2);
+  CHECK((received[0] == std::vector<int32_t>{9, -1, 1000000, INT32_MIN}));
+  CHECK((received[1] == std::vector<int32_t>{9, 0}));
+}
+} // namespace
+
+int main()
+{
+  checkPrimitives();
+  checkRoundTrip();
+  checkCorruptFrames();
+  checkMessages();
+  return CheckFailures();
+}
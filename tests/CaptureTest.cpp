@@ -0,0 +1,246 @@
+/**
+ * @file CaptureTest.cpp
+ * @brief Records a BufferMessage, which parses in place, and an FdMessage,
+ * which reads chunks, while their queues keep filling up and reading keeps
+ * stopping. Checks that the capture holds every received byte once and in
+ * order, that each chunk was recorded before any of its frames were parsed,
+ * and that ReplayMessage parses the same frames back out of the capture.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "BufferMessage.h"
+#include "Check.h"
+#include "FdMessage.h"
+#include "ReplayMessage.h"
+
+namespace
+{
+using Frames = std::vector<std::vector<int32_t>>;
+
+const uint32_t FRAME_COUNT = 60;
+
+uint32_t fakeMicros = 0;
+uint32_t parsedFrames = 0;
+
+uint32_t fakeClock()
+{
+  return fakeMicros += 10;
+}
+
+/**
+ * @brief Counts the frame and leaves it in the queue
+ */
+bool countFrame(const int32_t *, uint32_t)
+{
+  parsedFrames++;
+  return false;
+}
+
+void appendBytes(void *context, const uint8_t *data, uint32_t length)
+{
+  static_cast<std::string *>(context)->append(
+    reinterpret_cast<const char *>(data), length);
+}
+
+/**
+ * @brief Passes chunks on to a CaptureWriter and notes whether the link had
+ * already parsed a frame from a chunk when the chunk arrived
+ */
+class CheckedSink : public MESSAGE_INTF::CaptureSink
+{
+public:
+  explicit CheckedSink(std::string &capture)
+      : writer(fakeClock, appendBytes, &capture)
+  {
+  }
+
+  void Record(const char *data, uint32_t length) override
+  {
+    // every frame parsed so far has to be in the bytes recorded so far
+    late += parsedFrames > completeFrames ? 1 : 0;
+    for (uint32_t i = 0; i < length; i++)
+    {
+      completeFrames += data[i] == ';' ? 1 : 0;
+    }
+    writer.Record(data, length);
+  }
+
+  CaptureWriter<128> writer;
+  uint32_t completeFrames{0}; // the frames whose ';' has been recorded
+  uint32_t late{0};           // chunks recorded after their frames parsed
+};
+
+std::string makeInput()
+{
+  std::string input;
+  for (uint32_t i = 0; i < FRAME_COUNT; i++)
+  {
+    input += "!1," + std::to_string(i) + "," +
+             std::to_string(-3 * static_cast<int32_t>(i)) + ";";
+    if (i % 7 == 0)
+    {
+      input += "noise\r\n";
+    }
+  }
+  return input;
+}
+
+/**
+ * @brief Moves every queued frame of message into frames
+ */
+template <typename MESSAGE>
+void popFrames(MESSAGE &message, Frames &frames)
+{
+  MESSAGE_INTF::Frame<8> frame;
+  while (message.PopFrame(frame))
+  {
+    frames.emplace_back(
+      frame.args.begin(), frame.args.begin() + frame.populatedArgs);
+  }
+}
+
+/**
+ * @brief Returns the bytes of every record of capture, one after the other
+ * @return false if capture isn't a whole capture
+ */
+bool readCapture(const std::string &capture, std::string &bytes)
+{
+  const uint8_t *position = reinterpret_cast<const uint8_t *>(capture.data());
+  const uint8_t *end = position + capture.size();
+  if (!MESSAGE_CAPTURE::CheckHeader(
+        position, static_cast<uint32_t>(capture.size())))
+  {
+    return false;
+  }
+  position += MESSAGE_CAPTURE::HEADER_SIZE;
+  MESSAGE_CAPTURE::Record record;
+  while (MESSAGE_CAPTURE::ReadRecord(position, end, record))
+  {
+    bytes.append(record.data, record.length);
+  }
+  return position == end;
+}
+
+/**
+ * @brief Replays capture and returns the frames it parses
+ */
+Frames replay(const std::string &capture)
+{
+  Frames frames;
+  char path[] = "/tmp/CaptureTestXXXXXX";
+  int fd = mkstemp(path);
+  CHECK(fd >= 0);
+  if (fd < 0)
+  {
+    return frames;
+  }
+  CHECK(
+    write(fd, capture.data(), capture.size()) ==
+    static_cast<ssize_t>(capture.size()));
+  close(fd);
+
+  ReplayMessage<64, 8, 2, 2> message;
+  message.SetOverflowPolicy(MESSAGE_INTF::OVERFLOW_STOP_READING);
+  CHECK(message.Open(path));
+  for (uint32_t i = 0; i < 10 * FRAME_COUNT && !message.IsFinished(); i++)
+  {
+    message.Update();
+    popFrames(message, frames);
+  }
+  CHECK(message.IsFinished());
+  message.Close();
+  unlink(path);
+  return frames;
+}
+
+void checkFrames(const Frames &frames)
+{
+  CHECK(frames.size() == FRAME_COUNT);
+  bool right = true;
+  for (uint32_t i = 0; i < frames.size(); i++)
+  {
+    int32_t sequence = static_cast<int32_t>(i);
+    right &= frames[i].size() == 3 && frames[i][1] == sequence &&
+             frames[i][2] == -3 * sequence;
+  }
+  CHECK(right);
+}
+
+void checkInPlace()
+{
+  const std::string input = makeInput();
+  std::string capture;
+  Frames frames;
+  CheckedSink sink(capture);
+  parsedFrames = 0;
+
+  // the callback leaves every frame queued, so the queue of 2 fills up over
+  // and over
+  BufferMessage<64, 8, 2, 2> message;
+  CHECK(message.RegisterCallback({1, countFrame, nullptr}));
+  message.SetOverflowPolicy(MESSAGE_INTF::OVERFLOW_STOP_READING);
+  message.SetCapture(&sink);
+  message.SetInput(input.data(), static_cast<uint32_t>(input.size()));
+  for (uint32_t i = 0; i < 10 * FRAME_COUNT; i++)
+  {
+    message.Update();
+    popFrames(message, frames);
+  }
+  sink.writer.Flush();
+  checkFrames(frames);
+  CHECK(sink.late == 0);
+
+  std::string recorded;
+  CHECK(readCapture(capture, recorded));
+  CHECK(recorded == input);
+  CHECK(replay(capture) == frames);
+}
+
+void checkChunks()
+{
+  const std::string input = makeInput();
+  std::string capture;
+  Frames frames;
+  CheckedSink sink(capture);
+  parsedFrames = 0;
+
+  int fds[2];
+  CHECK(pipe(fds) == 0);
+  CHECK(
+    write(fds[1], input.data(), input.size()) ==
+    static_cast<ssize_t>(input.size()));
+  close(fds[1]);
+  FdMessage<64, 8, 2, 2> message(fds[0]);
+  message.Init(0);
+  CHECK(message.RegisterCallback({1, countFrame, nullptr}));
+  message.SetOverflowPolicy(MESSAGE_INTF::OVERFLOW_STOP_READING);
+  message.SetCapture(&sink);
+  for (uint32_t i = 0; i < 10 * FRAME_COUNT; i++)
+  {
+    message.Update();
+    popFrames(message, frames);
+  }
+  close(fds[0]);
+  sink.writer.Flush();
+  checkFrames(frames);
+  CHECK(sink.late == 0);
+
+  std::string recorded;
+  CHECK(readCapture(capture, recorded));
+  CHECK(recorded == input);
+  CHECK(replay(capture) == frames);
+}
+} // namespace
+
+int main()
+{
+  checkInPlace();
+  checkChunks();
+  return CheckFailures();
+}
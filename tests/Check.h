@@ -0,0 +1,43 @@
+/**
+ * @file Check.h
+ * @brief A minimal CHECK() for the host tests. A failed check is printed and
+ * counted, and the test's main() returns CheckFailures() so ctest sees it.
+ */
+
+#pragma once
+
+#include <cstdio>
+
+namespace MESSAGE_TEST
+{
+inline int &Failures()
+{
+  static int failures = 0;
+  return failures;
+}
+} // namespace MESSAGE_TEST
+
+#define CHECK(condition)                                                       \
+  do                                                                           \
+  {                                                                            \
+    if (!(condition))                                                          \
+    {                                                                          \
+      std::printf(                                                             \
+        "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition);          \
+      MESSAGE_TEST::Failures()++;                                              \
+    }                                                                          \
+  } while (0)
+
+/**
+ * @brief Prints a summary and returns the value for main() to return
+ */
+inline int CheckFailures()
+{
+  if (MESSAGE_TEST::Failures() != 0)
+  {
+    std::printf("%d check(s) failed\n", MESSAGE_TEST::Failures());
+    return 1;
+  }
+  std::printf("all checks passed\n");
+  return 0;
+}
@@ -0,0 +1,202 @@
+/**
+ * @file DecimalParserTest.cpp
+ * @brief Checks ParseFloat against strtof(), which rounds correctly, on the
+ * inputs double rounding gets wrong: long mantissas, points exactly halfway
+ * between two floats and a hair either side of them, subnormals and the
+ * overflow boundary. Also spot checks the integer and fixed point parsers.
+ */
+
+#include <cerrno>
+#include <cinttypes>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+
+#include "Check.h"
+#include "DecimalParser.h"
+
+namespace
+{
+uint64_t checked = 0;
+
+/**
+ * @brief Checks that ParseFloat gives what strtof() gives for text, or
+ * fails where strtof() overflows
+ */
+void checkFloat(const std::string &text)
+{
+  errno = 0;
+  float expected = std::strtof(text.c_str(), nullptr);
+  bool overflow = std::isinf(expected);
+
+  float value = 0;
+  bool parsed = MESSAGE_ASCII::ParseFloat(text.data(), text.size(), value);
+  uint32_t expectedBits;
+  uint32_t valueBits;
+  memcpy(&expectedBits, &expected, sizeof(expectedBits));
+  memcpy(&valueBits, &value, sizeof(valueBits));
+  bool match = overflow ? !parsed : parsed && valueBits == expectedBits;
+  if (!match)
+  {
+    std::printf(
+      "ParseFloat(\"%s\") gave %s %08" PRIx32 ", strtof() %08" PRIx32 "\n",
+      text.c_str(),
+      parsed ? "true" : "false",
+      valueBits,
+      expectedBits);
+  }
+  CHECK(match);
+  checked++;
+}
+
+/**
+ * @brief The exact decimal expansion of value, which has to be a float or a
+ * point halfway between two of them
+ */
+std::string exactDecimal(double value)
+{
+  char buffer[256];
+  std::snprintf(buffer, sizeof(buffer), "%.160e", value);
+  return buffer;
+}
+
+/**
+ * @brief The point halfway between the float with bits and the next one up
+ */
+double halfwayAbove(uint32_t bits)
+{
+  float low;
+  float high;
+  uint32_t next = bits + 1;
+  memcpy(&low, &bits, sizeof(low));
+  memcpy(&high, &next, sizeof(high));
+  if (next == 0x7F800000)
+  {
+    return (static_cast<double>(low) + std::ldexp(1.0, 128)) / 2;
+  }
+  return (static_cast<double>(low) + static_cast<double>(high)) / 2;
+}
+
+void checkHalfwayPoints(std::mt19937 &rng)
+{
+  std::uniform_int_distribution<uint32_t> pickBits(0, 0x7F7FFFFF);
+  for (uint32_t i = 0; i < 20000; i++)
+  {
+    uint32_t bits = pickBits(rng);
+    // mostly around subnormals and the top of the range too
+    if (i % 4 == 1)
+    {
+      bits &= 0x00FFFFFF;
+    }
+    else if (i % 4 == 2)
+    {
+      bits = (bits & 0x007FFFFF) | 0x7F000000;
+    }
+    std::string halfway = exactDecimal(halfwayAbove(bits));
+    size_t e = halfway.find('e');
+    std::string digits = halfway.substr(0, e);
+    std::string exponent = halfway.substr(e);
+
+    // exactly halfway, and a hair either side far past the 19th digit
+    checkFloat(halfway);
+    checkFloat(digits + "0000000000000000000001" + exponent);
+    size_t last = digits.find_last_not_of('0');
+    if (digits[last] != '.')
+    {
+      std::string below = digits.substr(0, last + 1);
+      below[last]--;
+      checkFloat(below + "9999999999999999999999" + exponent);
+    }
+    checkFloat("-" + halfway);
+  }
+}
+
+void checkRandomDecimals(std::mt19937 &rng)
+{
+  std::uniform_int_distribution<uint32_t> pick(0, 999);
+  for (uint32_t i = 0; i < 200000; i++)
+  {
+    std::string text = pick(rng) % 3 == 0 ? "-" : "";
+    uint32_t digits = 1 + pick(rng) % (i % 2 == 0 ? 30 : 150);
+    uint32_t point = pick(rng) % (digits + 1);
+    for (uint32_t d = 0; d < digits; d++)
+    {
+      if (d == point)
+      {
+        text += '.';
+      }
+      text += static_cast<char>('0' + pick(rng) % 10);
+    }
+    int exponent = static_cast<int>(pick(rng) % 120) - 70;
+    text += 'e' + std::to_string(exponent);
+    checkFloat(text);
+  }
+}
+
+void checkEdges()
+{
+  static const char *const EDGES[] = {
+    "0",
+    "-0",
+    "1",
+    "0.1",
+    "3.4028234663852886e38", // FLT_MAX
+    "3.4028235677973366e38", // halfway past FLT_MAX, rounds to infinity
+    "3.4028235677973365e38",
+    "3.40282356779733661637539395458142568447999e38",
+    "3.40282356779733661637539395458142568448e38",
+    "3.40282356779733661637539395458142568448000000000001e38",
+    "1e39",
+    "1e-46",
+    "7.006492321624085e-46", // halfway to the smallest subnormal, rounds to 0
+    "7.006492321624086e-46",
+    "7.0064923216240861e-46",
+    "1.401298464324817e-45", // the smallest subnormal
+    "1.1754943508222875e-38", // the smallest normal
+    "1.1754942807573643e-38",
+    "16777217",
+    "16777217.000000000000000000000000000001",
+    "0.000000000000000000000000000000000000000000001",
+    "123456789012345678901234567890123456789",
+    "1e-400",
+    "1e400",
+    " 2.5 ",
+    "+1.5e+3",
+  };
+  for (const char *text : EDGES)
+  {
+    checkFloat(text);
+  }
+}
+
+void checkIntegers()
+{
+  int64_t wide = 0;
+  CHECK(MESSAGE_ASCII::ParseInt64("-9223372036854775808", 20, wide));
+  CHECK(wide == INT64_MIN);
+  CHECK(!MESSAGE_ASCII::ParseInt64("9223372036854775808", 19, wide));
+  uint32_t unsigned32 = 0;
+  CHECK(MESSAGE_ASCII::ParseUint32("4294967295", 10, unsigned32));
+  CHECK(unsigned32 == 0xFFFFFFFFu);
+  CHECK(!MESSAGE_ASCII::ParseUint32("4294967296", 10, unsigned32));
+  MESSAGE_INTF::Fixed<16> fixed;
+  CHECK(MESSAGE_ASCII::ParseFixed("-1.5", 4, fixed));
+  CHECK(fixed.raw == -98304);
+}
+} // namespace
+
+int main()
+{
+  std::mt19937 rng(7);
+  checkEdges();
+  checkHalfwayPoints(rng);
+  checkRandomDecimals(rng);
+  checkIntegers();
+  std::printf(
+    "%llu floats checked\n", static_cast<unsigned long long>(checked));
+  return CheckFailures();
+}
@@ -0,0 +1,194 @@
+/**
+ * @file DelegateTest.cpp
+ * @brief Checks that a CallbackDelegate calls what it was built from after
+ * being copied around, on its own and from the callback table of a Message
+ * whose transport reads through a virtual interface, and that an empty one
+ * says so. GCC 12 at -O2 lost the callable of the second case when the
+ * Delegate built it with placement new.
+ */
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#include "Check.h"
+#include "Message.h"
+
+namespace
+{
+using MESSAGE_INTF::CallbackDelegate;
+
+uint32_t plainCalls = 0;
+
+bool plain(const int32_t *args, uint32_t length)
+{
+  plainCalls += static_cast<uint32_t>(args[0]) + length;
+  return true;
+}
+
+struct Motor
+{
+  int32_t speed{0};
+
+  bool OnMove(const int32_t *args, uint32_t length)
+  {
+    speed = length > 1 ? args[1] : 0;
+    return true;
+  }
+};
+
+void checkCopies()
+{
+  CallbackDelegate empty;
+  CHECK(!empty);
+  CHECK(empty == nullptr);
+  CHECK(!CallbackDelegate(nullptr));
+
+  Motor motor;
+  int32_t seen = 0;
+  int32_t *target = &seen;
+  std::array<CallbackDelegate, 3> table;
+  table[0] = plain;
+  table[1] = CallbackDelegate::Bind<Motor, &Motor::OnMove>(&motor);
+  table[2] = [target, &motor](const int32_t *args, uint32_t length)
+  {
+    *target = args[length - 1] + motor.speed;
+    return false;
+  };
+  std::array<CallbackDelegate, 3> copy = table;
+  table = std::array<CallbackDelegate, 3>();
+
+  int32_t args[3] = {7, 40, 2};
+  CHECK(copy[0] != nullptr);
+  CHECK(copy[0](args, 3));
+  CHECK(plainCalls == 10);
+  CHECK(copy[1](args, 3));
+  CHECK(motor.speed == 40);
+  CHECK(!copy[2](args, 3));
+  CHECK(seen == 42);
+}
+
+/**
+ * @brief Bytes behind a virtual interface, like a driver's receive buffer
+ */
+class Source
+{
+public:
+  virtual ~Source() = default;
+  virtual uint32_t Read(char *buffer, uint32_t length) = 0;
+  virtual uint32_t Available() = 0;
+};
+
+class StringSource : public Source
+{
+public:
+  explicit StringSource(const char *text) : text(text)
+  {
+  }
+
+  uint32_t Read(char *buffer, uint32_t length) override
+  {
+    uint32_t count = 0;
+    while (count < length && text[count] != '\0')
+    {
+      buffer[count] = text[count];
+      count++;
+    }
+    text += count;
+    return count;
+  }
+
+  uint32_t Available() override
+  {
+    return static_cast<uint32_t>(strlen(text));
+  }
+
+private:
+  const char *text;
+};
+
+/**
+ * @brief A transport that reads its bytes from a Source in chunks
+ */
+class SourceMessage : public Message<SourceMessage, 64, 8, 8>
+{
+  friend class Message<SourceMessage, 64, 8, 8>;
+
+public:
+  explicit SourceMessage(Source &source) : source(source)
+  {
+  }
+
+  void Init(uint32_t) override
+  {
+  }
+
+  void PrintArgs() override
+  {
+  }
+
+protected:
+  char getChar()
+  {
+    char c = '\0';
+    source.Read(&c, 1);
+    return c;
+  }
+
+  uint32_t dataAvailable()
+  {
+    return source.Available();
+  }
+
+  uint32_t readBytes(char *buffer, uint32_t length)
+  {
+    return source.Read(buffer, length);
+  }
+
+  void writeBytes(const char *, uint32_t)
+  {
+  }
+
+private:
+  Source &source;
+};
+
+/**
+ * @brief Registers the callbacks from a template, the way a helper in a
+ * program would
+ */
+template <typename MESSAGE>
+void registerAll(MESSAGE &message, Motor &motor)
+{
+  for (uint32_t id = 1; id <= 3; id++)
+  {
+    CHECK(message.RegisterCallback({id, plain, nullptr}));
+  }
+  CHECK(message.RegisterCallback(
+    {4, CallbackDelegate::Bind<Motor, &Motor::OnMove>(&motor), nullptr}));
+}
+
+void checkDispatch()
+{
+  Motor motor;
+  StringSource source("!1,5;!4,-3;!3;!2,9,9;");
+  SourceMessage message(source);
+  registerAll(message, motor);
+  plainCalls = 0;
+  while (source.Available() > 0)
+  {
+    message.Update();
+  }
+  // 1 + 2, 3 + 1 and 2 + 3
+  CHECK(plainCalls == 12);
+  CHECK(motor.speed == -3);
+  CHECK(message.GetQueuedFrames() == 0);
+}
+} // namespace
+
+int main()
+{
+  checkCopies();
+  checkDispatch();
+  return CheckFailures();
+}
@@ -0,0 +1,226 @@
+/**
+ * @file DispatchTest.cpp
+ * @brief Checks that the dispatch table finds every callback registered for
+ * a message ID and only those, in the order they were registered: several
+ * callbacks per ID, IDs on both sides of the direct/hashed boundary, sparse
+ * IDs that all hash to the same slot, negative IDs, and tables filled up to
+ * MAX_CALLBACKS with both sizes of callback index.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "BufferMessage.h"
+#include "Check.h"
+
+namespace
+{
+/**
+ * @brief Notes its tag in log when its callback is called
+ */
+struct Recorder
+{
+  uint32_t tag;
+  std::vector<uint32_t> *log;
+};
+
+/**
+ * @brief Returns the smallest power of two that is at least minimum
+ */
+constexpr uint32_t powerOfTwo(uint32_t minimum, uint32_t size = 1)
+{
+  return size >= minimum ? size : powerOfTwo(minimum, size * 2);
+}
+
+/**
+ * @brief A BufferMessage with up to MAX_CALLBACKS recording callbacks
+ */
+template <uint32_t MAX_CALLBACKS>
+struct Harness
+{
+  // the size of the dispatch table, as Message sizes it
+  static constexpr uint32_t DISPATCH_SIZE = powerOfTwo(2 * MAX_CALLBACKS);
+
+  BufferMessage<64, 4, MAX_CALLBACKS, 4> message;
+  Recorder recorders[MAX_CALLBACKS + 1]; // the last one is never registered
+  uint32_t registered{0};
+  std::vector<uint32_t> log;
+
+  /**
+   * @brief Returns the slot a hashed message ID starts probing at
+   */
+  static uint32_t HashSlot(uint32_t messageID)
+  {
+    return ((messageID * 2654435769u) >> 16) & (DISPATCH_SIZE - 1);
+  }
+
+  bool Register(uint32_t messageID, uint32_t tag)
+  {
+    Recorder *recorder = &recorders[registered];
+    *recorder = Recorder{tag, &log};
+    bool accepted = message.RegisterCallback(
+      {messageID,
+       [recorder](const int32_t *, uint32_t)
+       {
+         recorder->log->push_back(recorder->tag);
+         return true;
+       },
+       nullptr});
+    registered += accepted ? 1 : 0;
+    return accepted;
+  }
+
+  /**
+   * @brief Sends one frame with messageID
+   * @return the tags of the callbacks it reached
+   */
+  std::vector<uint32_t> Feed(int32_t messageID)
+  {
+    log.clear();
+    std::string frame = "!" + std::to_string(messageID) + ",1;";
+    message.SetInput(frame.data(), static_cast<uint32_t>(frame.size()));
+    message.Update();
+    return log;
+  }
+};
+
+void checkSeveralPerID()
+{
+  Harness<8> harness;
+  CHECK(harness.Register(3, 0));
+  CHECK(harness.Register(3, 1));
+  CHECK(harness.Register(5, 2));
+  CHECK(harness.Register(3, 3));
+  CHECK(harness.Register(200, 4));
+  CHECK(harness.Register(200, 5));
+  CHECK((harness.Feed(3) == std::vector<uint32_t>{0, 1, 3}));
+  CHECK((harness.Feed(5) == std::vector<uint32_t>{2}));
+  CHECK((harness.Feed(200) == std::vector<uint32_t>{4, 5}));
+
+  // an ID nobody registered reaches nobody and waits in the queue
+  CHECK(harness.Feed(4).empty());
+  CHECK(harness.message.GetQueuedFrames() == 1);
+}
+
+void checkBoundaries()
+{
+  // with 4 callbacks the table has 8 slots: IDs 0 to 7 index it directly,
+  // 8 and up are hashed
+  using Small = Harness<4>;
+  uint32_t onLast = 8;
+  while (Small::HashSlot(onLast) != 7)
+  {
+    onLast++;
+  }
+
+  Small harness;
+  CHECK(harness.Register(7, 0));
+  // probes past the end of the table and wraps around to slot 0
+  CHECK(harness.Register(onLast, 1));
+  CHECK(harness.Register(0, 2));
+  CHECK(harness.Register(8, 3));
+  CHECK(!harness.Register(1, 4));
+
+  CHECK((harness.Feed(7) == std::vector<uint32_t>{0}));
+  CHECK((harness.Feed(static_cast<int32_t>(onLast)) ==
+         std::vector<uint32_t>{1}));
+  CHECK((harness.Feed(0) == std::vector<uint32_t>{2}));
+  CHECK((harness.Feed(8) == std::vector<uint32_t>{3}));
+  CHECK(harness.Feed(1).empty());
+  CHECK(harness.Feed(6).empty());
+}
+
+void checkCollidingSparseIDs()
+{
+  // every ID starts probing at the same slot, so each lookup walks the run
+  // of the ones registered before it
+  using Sparse = Harness<16>;
+  uint32_t slot = Sparse::HashSlot(1000000);
+  std::vector<uint32_t> ids;
+  for (uint32_t id = 1000000; ids.size() < 17; id++)
+  {
+    if (Sparse::HashSlot(id) == slot)
+    {
+      ids.push_back(id);
+    }
+  }
+
+  Sparse harness;
+  for (uint32_t i = 0; i < 15; i++)
+  {
+    CHECK(harness.Register(ids[i], i));
+  }
+  // a negative ID is hashed as its 32 bits
+  CHECK(harness.Register(0xFFFFFFFFu, 15));
+  CHECK(!harness.Register(ids[15], 16));
+
+  for (uint32_t i = 0; i < 15; i++)
+  {
+    CHECK((harness.Feed(static_cast<int32_t>(ids[i])) ==
+           std::vector<uint32_t>{i}));
+  }
+  CHECK((harness.Feed(-1) == std::vector<uint32_t>{15}));
+  CHECK(harness.Feed(static_cast<int32_t>(ids[15])).empty());
+  CHECK(harness.Feed(static_cast<int32_t>(ids[16])).empty());
+}
+
+/**
+ * @brief Fills a table with random IDs, some of them twice, and checks each
+ * one reaches exactly its own callbacks
+ */
+template <uint32_t MAX_CALLBACKS>
+void checkFullTable(uint32_t seed)
+{
+  std::mt19937 rng(seed);
+  Harness<MAX_CALLBACKS> *harness = new Harness<MAX_CALLBACKS>();
+  std::vector<uint32_t> ids;
+  for (uint32_t i = 0; i < MAX_CALLBACKS; i++)
+  {
+    // small IDs, large ones and repeats of earlier ones
+    uint32_t kind = rng() % 4;
+    uint32_t id = kind == 0   ? static_cast<uint32_t>(rng() % 64)
+                  : kind == 1 ? static_cast<uint32_t>(rng() & 0x7FFFFFFF)
+                  : kind == 2 && !ids.empty()
+                    ? ids[rng() % ids.size()]
+                    : static_cast<uint32_t>(rng() % 100000);
+    ids.push_back(id);
+    CHECK(harness->Register(id, i));
+  }
+  CHECK(!harness->Register(1, MAX_CALLBACKS));
+
+  uint32_t mismatches = 0;
+  for (uint32_t id : ids)
+  {
+    std::vector<uint32_t> expected;
+    for (uint32_t i = 0; i < MAX_CALLBACKS; i++)
+    {
+      if (ids[i] == id)
+      {
+        expected.push_back(i);
+      }
+    }
+    mismatches += harness->Feed(static_cast<int32_t>(id)) == expected ? 0 : 1;
+  }
+  CHECK(mismatches == 0);
+  std::printf(
+    "%u callbacks: %u mismatches\n",
+    static_cast<unsigned>(MAX_CALLBACKS),
+    static_cast<unsigned>(mismatches));
+  delete harness;
+}
+} // namespace
+
+int main()
+{
+  checkSeveralPerID();
+  checkBoundaries();
+  checkCollidingSparseIDs();
+  // 254 callbacks still use 8 bit indexes, 255 and more 16 bit ones
+  checkFullTable<254>(1);
+  checkFullTable<255>(2);
+  checkFullTable<256>(3);
+  return CheckFailures();
+}
@@ -0,0 +1,185 @@
+/**
+ * @file FdMessageTest.cpp
+ * @brief Load tests FdMessage over a pty pair: one thread sends frames into
+ * the master as fast as it can while the other parses them off the slave,
+ * which Init() switched to raw mode. Every frame has to arrive once and in
+ * order. Also checks that a write into a full pipe gives up after the write
+ * timeout, and that writing to a pipe or socket whose reader has gone away
+ * drops the frame without raising SIGPIPE.
+ */
+
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <termios.h>
+#include <thread>
+#include <unistd.h>
+
+#include "Check.h"
+#include "FdMessage.h"
+
+namespace
+{
+using Link = FdMessage<64, 8, 2>;
+using Clock = std::chrono::steady_clock;
+
+const uint32_t FRAME_COUNT = 50000;
+
+/**
+ * @brief Counts the frames that arrive, and those that don't carry the next
+ * sequence number or the args that go with it
+ */
+struct Receiver
+{
+  uint32_t received{0};
+  uint32_t wrong{0};
+
+  bool OnFrame(const int32_t *args, uint32_t length)
+  {
+    int32_t sequence = static_cast<int32_t>(received);
+    bool right = length == 4 && args[1] == sequence &&
+                 args[2] == -sequence && args[3] == sequence % 1000 * 7;
+    wrong += right ? 0 : 1;
+    received++;
+    return true;
+  }
+};
+
+void checkPtyLoad()
+{
+  int master = posix_openpt(O_RDWR | O_NOCTTY);
+  CHECK(master >= 0);
+  if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+  {
+    return;
+  }
+  int slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+  CHECK(slave >= 0);
+  if (slave < 0)
+  {
+    close(master);
+    return;
+  }
+
+  Link sender(master);
+  sender.Init(0);
+  sender.SetWriteTimeout(2000);
+  Link receiver(slave);
+  receiver.Init(115200);
+
+  struct termios tty;
+  CHECK(tcgetattr(slave, &tty) == 0);
+  CHECK((tty.c_lflag & (ICANON | ECHO | ISIG)) == 0);
+  CHECK((tty.c_oflag & OPOST) == 0);
+  CHECK(cfgetispeed(&tty) == B115200);
+  CHECK((fcntl(slave, F_GETFL) & O_NONBLOCK) != 0);
+
+  Receiver frames;
+  CHECK(receiver.RegisterCallback(
+    {1,
+     MESSAGE_INTF::CallbackDelegate::Bind<Receiver, &Receiver::OnFrame>(
+       &frames),
+     nullptr}));
+
+  std::thread writer(
+    [&sender]()
+    {
+      for (uint32_t i = 0; i < FRAME_COUNT; i++)
+      {
+        int32_t sequence = static_cast<int32_t>(i);
+        sender.Send(1, sequence, -sequence, sequence % 1000 * 7);
+      }
+    });
+  Clock::time_point deadline = Clock::now() + std::chrono::seconds(20);
+  struct pollfd readable = {slave, POLLIN, 0};
+  while (frames.received < FRAME_COUNT && Clock::now() < deadline)
+  {
+    if (poll(&readable, 1, 100) > 0)
+    {
+      receiver.Update();
+    }
+  }
+  writer.join();
+
+  std::printf(
+    "pty: %u of %u frames, %u wrong, %u bytes dropped\n",
+    static_cast<unsigned>(frames.received),
+    static_cast<unsigned>(FRAME_COUNT),
+    static_cast<unsigned>(frames.wrong),
+    static_cast<unsigned>(sender.GetDroppedBytes()));
+  CHECK(frames.received == FRAME_COUNT);
+  CHECK(frames.wrong == 0);
+  CHECK(sender.GetDroppedBytes() == 0);
+  close(slave);
+  close(master);
+}
+
+void checkWriteTimeout()
+{
+  int fds[2];
+  CHECK(pipe(fds) == 0);
+  Link sender(fds[1]);
+  sender.Init(0);
+  sender.SetWriteTimeout(20);
+
+  // nobody reads, so the pipe fills up and the writes start timing out
+  Clock::time_point start = Clock::now();
+  uint32_t sent = 0;
+  while (sender.GetDroppedBytes() == 0 && sent < 100000)
+  {
+    sender.Send(1, 123456789, -123456789);
+    sent++;
+  }
+  double seconds =
+    std::chrono::duration<double>(Clock::now() - start).count();
+  CHECK(sender.GetDroppedBytes() > 0);
+  CHECK(seconds < 2.0);
+
+  // once the reader drains the pipe, frames go through again
+  char drain[4096];
+  while (read(fds[0], drain, sizeof(drain)) == sizeof(drain))
+  {
+  }
+  uint32_t dropped = sender.GetDroppedBytes();
+  sender.Send(1, 2, 3);
+  CHECK(sender.GetDroppedBytes() == dropped);
+  close(fds[0]);
+  close(fds[1]);
+}
+
+void checkClosedReader()
+{
+  // the default action of SIGPIPE would end the test right here
+  int fds[2];
+  CHECK(pipe(fds) == 0);
+  close(fds[0]);
+  Link toPipe(fds[1]);
+  toPipe.Init(0);
+  toPipe.Send(1, 2);
+  CHECK(toPipe.GetDroppedBytes() == 5);
+  sigset_t pending;
+  sigpending(&pending);
+  CHECK(sigismember(&pending, SIGPIPE) == 0);
+  close(fds[1]);
+
+  CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+  close(fds[0]);
+  Link toSocket(fds[1]);
+  toSocket.Init(0);
+  toSocket.Send(1, 2);
+  CHECK(toSocket.GetDroppedBytes() == 5);
+  close(fds[1]);
+}
+} // namespace
+
+int main()
+{
+  checkPtyLoad();
+  checkWriteTimeout();
+  checkClosedReader();
+  return CheckFailures();
+}
@@ -0,0 +1,169 @@
+/**
+ * @file FrameQueueTest.cpp
+ * @brief Checks that a handle from Defer() names its own frame and no other
+ * when the overflow policy drops or conflates frames around it, and that
+ * OVERFLOW_CONFLATE leaves the queue alone while it has room.
+ */
+
+#include <cstdint>
+#include <cstring>
+
+#include "BufferMessage.h"
+#include "Check.h"
+
+namespace
+{
+const uint32_t MAX_HANDLES = 8;
+
+bool deferFrames = false;
+MESSAGE_INTF::FrameHandle handles[MAX_HANDLES];
+uint32_t handleCount = 0;
+
+/**
+ * @brief Feeds input to message and handles the frames it completes
+ */
+template <typename MESSAGE>
+void feed(MESSAGE &message, const char *input)
+{
+  message.SetInput(input, strlen(input));
+  while (message.GetRemainingInput() > 0)
+  {
+    message.Update();
+  }
+}
+
+/**
+ * @brief Registers a callback for message ID 2 that defers its frames while
+ * deferFrames is set, and leaves them in the queue otherwise
+ */
+template <typename MESSAGE>
+void registerDeferring(MESSAGE &message)
+{
+  deferFrames = false;
+  handleCount = 0;
+  CHECK(message.RegisterCallback(
+    {2,
+     [&message](const int32_t *args, uint32_t length) {
+       if (deferFrames && handleCount < MAX_HANDLES)
+       {
+         handles[handleCount] = message.Defer();
+         // a second call for the same frame gives the same handle
+         CHECK(message.Defer().sequence == handles[handleCount].sequence);
+         handleCount++;
+       }
+       return false;
+     },
+     nullptr}));
+}
+
+/**
+ * @brief The second arg of the frame with handle, -1 if there is none
+ */
+template <typename MESSAGE>
+int32_t valueOf(MESSAGE &message, MESSAGE_INTF::FrameHandle handle)
+{
+  const MESSAGE_INTF::Frame<8> *frame = message.GetFrame(handle);
+  return frame != nullptr && frame->populatedArgs > 1 ? frame->args[1] : -1;
+}
+
+void checkDropNewest()
+{
+  BufferMessage<64, 8, 2, 2> message;
+  message.SetOverflowPolicy(MESSAGE_INTF::OVERFLOW_DROP_NEWEST);
+  registerDeferring(message);
+
+  feed(message, "!1,10;!1,11;");
+  CHECK(message.GetQueuedFrames() == 2);
+
+  // the queue is full, so the deferred frames push out the queued ones
+  // nobody holds a handle to instead of being dropped themselves
+  deferFrames = true;
+  feed(message, "!2,20;!2,21;");
+  CHECK(handleCount == 2);
+  CHECK(message.GetQueuedFrames() == 2);
+  CHECK(valueOf(message, handles[0]) == 20);
+  CHECK(valueOf(message, handles[1]) == 21);
+
+  // a frame nobody deferred is the newest and goes
+  deferFrames = false;
+  feed(message, "!1,12;");
+  CHECK(valueOf(message, handles[0]) == 20);
+  CHECK(valueOf(message, handles[1]) == 21);
+
+  // with every queued frame deferred the deferred frame is dropped, and its
+  // handle must not turn up on the next frame that is queued
+  deferFrames = true;
+  feed(message, "!2,22;");
+  CHECK(handleCount == 3);
+  CHECK(valueOf(message, handles[2]) == -1);
+  CHECK(message.Complete(handles[0]));
+  deferFrames = false;
+  feed(message, "!1,13;");
+  CHECK(message.GetQueuedFrames() == 2);
+  CHECK(valueOf(message, handles[2]) == -1);
+  CHECK(!message.Complete(handles[2]));
+
+  // completing takes out exactly the frame of the handle
+  CHECK(!message.Complete(handles[0]));
+  CHECK(message.Complete(handles[1]));
+  MESSAGE_INTF::Frame<8> frame{};
+  CHECK(message.PopFrame(frame));
+  CHECK(frame.args[1] == 13);
+  CHECK(!message.PopFrame(frame));
+}
+
+void checkConflate()
+{
+  BufferMessage<64, 8, 2, 3> message;
+  message.SetOverflowPolicy(MESSAGE_INTF::OVERFLOW_CONFLATE);
+  registerDeferring(message);
+
+  // while there is room frames with the same ID are all kept
+  deferFrames = true;
+  feed(message, "!2,20;");
+  deferFrames = false;
+  feed(message, "!2,21;!2,22;");
+  CHECK(message.GetQueuedFrames() == 3);
+  CHECK(valueOf(message, handles[0]) == 20);
+
+  // once it is full the oldest frame with the ID goes, but not the deferred
+  // one, and the handle still names the frame it was given for
+  feed(message, "!2,23;");
+  CHECK(message.GetQueuedFrames() == 3);
+  CHECK(valueOf(message, handles[0]) == 20);
+
+  // a deferred frame conflates an older one nobody holds
+  deferFrames = true;
+  feed(message, "!2,24;");
+  CHECK(handleCount == 2);
+  CHECK(valueOf(message, handles[0]) == 20);
+  CHECK(valueOf(message, handles[1]) == 24);
+
+  MESSAGE_INTF::Frame<8> frame{};
+  CHECK(message.Complete(handles[0]));
+  CHECK(message.PopFrame(frame));
+  CHECK(frame.args[1] == 23);
+  CHECK(!frame.deferred);
+  CHECK(message.PopFrame(frame));
+  CHECK(frame.args[1] == 24);
+  CHECK(frame.deferred);
+  CHECK(!message.Complete(handles[1]));
+
+  // a new ID drops the oldest frame, deferred or not, and its handle stops
+  // working
+  deferFrames = true;
+  feed(message, "!2,25;");
+  deferFrames = false;
+  feed(message, "!1,10;!3,30;!4,40;");
+  CHECK(message.GetQueuedFrames() == 3);
+  CHECK(valueOf(message, handles[2]) == -1);
+  CHECK(!message.Complete(handles[2]));
+}
+} // namespace
+
+int main()
+{
+  checkDropNewest();
+  checkConflate();
+  return CheckFailures();
+}
@@ -0,0 +1,146 @@
+/**
+ * @file MailboxTest.cpp
+ * @brief Checks that a Mailbox keeps the newest frame of its ID and counts
+ * the ones it replaced, and that a reader running against a writer thread
+ * never sees a torn sample or a sample older than the last one it read.
+ *
+ * Usage: MailboxTest [milliseconds]
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include "BufferMessage.h"
+#include "Check.h"
+#include "Mailbox.h"
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+void feed(BufferMessage<64, 8, 4, 2> &message, const char *input)
+{
+  message.SetInput(input, strlen(input));
+  while (message.GetRemainingInput() > 0)
+  {
+    message.Update();
+  }
+}
+
+void checkSemantics()
+{
+  Mailbox<4> imu;
+  BufferMessage<64, 8, 4, 2> message;
+  CHECK(message.RegisterCallback(imu.Bind(7)));
+  MESSAGE_INTF::Frame<4> frame{};
+  CHECK(!imu.Read(frame));
+
+  // the last of three frames wins, its extra args are clamped and flagged,
+  // and an ID without a mailbox still queues
+  feed(message, "!7,1,2,3;!7,4,5,6;!7,7,8,9,10,11;!8,1;");
+  CHECK(imu.Read(frame));
+  CHECK(frame.sequence == 3);
+  CHECK(frame.populatedArgs == 4);
+  CHECK(frame.argOverflow);
+  CHECK(frame.args[0] == 7);
+  CHECK(frame.args[3] == 9);
+  CHECK(imu.GetOverwritten() == 2);
+  CHECK(message.GetQueuedFrames() == 1);
+
+  // samples read before the next arrives aren't overwritten ones
+  feed(message, "!7,1;");
+  CHECK(imu.Read(frame));
+  feed(message, "!7,2;");
+  CHECK(imu.Read(frame));
+  CHECK(frame.sequence == 5);
+  CHECK(frame.populatedArgs == 2);
+  CHECK(!frame.argOverflow);
+  CHECK(frame.args[1] == 2);
+  CHECK(imu.GetOverwritten() == 2);
+  CHECK(imu.GetSequence() == 5);
+}
+
+/**
+ * @brief Stores (7, i, 2i, 3i) from a writer thread for milliseconds while
+ * this one reads, so a sample mixed from two stores shows. Neither thread
+ * yields, so with one CPU the writer is preempted at arbitrary points.
+ */
+void checkConcurrentReads(uint32_t milliseconds)
+{
+  Mailbox<4> box;
+  std::atomic<bool> stop{false};
+  uint32_t stores = 0;
+  std::thread writer([&] {
+    while (!stop.load(std::memory_order_relaxed))
+    {
+      stores++;
+      int32_t args[4] = {7,
+                         static_cast<int32_t>(stores),
+                         static_cast<int32_t>(2 * stores),
+                         static_cast<int32_t>(3 * stores)};
+      box.Store(args, 4);
+    }
+  });
+
+  uint64_t reads = 0;
+  uint64_t torn = 0;
+  uint64_t backwards = 0;
+  uint64_t distinct = 0;
+  uint32_t last = 0;
+  MESSAGE_INTF::Frame<4> frame{};
+  Clock::time_point end =
+    Clock::now() + std::chrono::milliseconds(milliseconds);
+  while (Clock::now() < end)
+  {
+    if (!box.Read(frame))
+    {
+      continue;
+    }
+    reads++;
+    uint32_t value = static_cast<uint32_t>(frame.args[1]);
+    if (
+      frame.populatedArgs != 4 ||
+      static_cast<uint32_t>(frame.args[2]) != 2 * value ||
+      static_cast<uint32_t>(frame.args[3]) != 3 * value ||
+      frame.sequence != value)
+    {
+      torn++;
+    }
+    backwards += frame.sequence < last ? 1 : 0;
+    distinct += frame.sequence != last ? 1 : 0;
+    last = frame.sequence;
+  }
+  stop.store(true, std::memory_order_relaxed);
+  writer.join();
+
+  CHECK(torn == 0);
+  CHECK(backwards == 0);
+  CHECK(box.Read(frame));
+  CHECK(frame.sequence == stores);
+  distinct += frame.sequence != last ? 1 : 0;
+  // a store can count a sample as overwritten while the read of it is
+  // finishing, so the two may add up to a little more than the stores
+  CHECK(distinct <= stores);
+  CHECK(distinct + box.GetOverwritten() >= stores);
+  std::printf(
+    "%u stores, %llu reads, %llu distinct samples read, %u overwritten\n",
+    static_cast<unsigned>(stores),
+    static_cast<unsigned long long>(reads),
+    static_cast<unsigned long long>(distinct),
+    static_cast<unsigned>(box.GetOverwritten()));
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+  uint32_t milliseconds =
+    argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000;
+  checkSemantics();
+  checkConcurrentReads(milliseconds);
+  return CheckFailures();
+}
@@ -0,0 +1,238 @@
+/**
+ * @file MessageExecutorTest.cpp
+ * @brief Runs coroutines against an echo peer on the other end of a
+ * socketpair. Checks that replies reach the right waits in order, that a
+ * burst of replies loses nothing, that waits time out, that frames nobody
+ * waits for still reach the queue, and that waits left over when the
+ * executor goes away are freed.
+ */
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+#include "Check.h"
+#include "FdMessage.h"
+#include "MessageExecutor.h"
+
+namespace
+{
+using Link = FdMessage<64, 8, 4, 4>;
+using Executor = MessageExecutor<1, 8>;
+using Clock = std::chrono::steady_clock;
+
+/**
+ * @brief Answers every !1,x; with !2,x; until it gets !9;
+ */
+void echo(int fd)
+{
+  Link peer(fd);
+  peer.Init(0);
+  // callbacks answer every frame of a burst, the queue would drop some
+  bool done = false;
+  peer.RegisterCallback(
+    {1,
+     [&peer](const int32_t *args, uint32_t length) {
+       return length == 2 && peer.Send(2, args[1]);
+     },
+     nullptr});
+  peer.RegisterCallback({9,
+                         [&done](const int32_t *args, uint32_t length) {
+                           done = true;
+                           return true;
+                         },
+                         nullptr});
+  struct pollfd readable = {fd, POLLIN, 0};
+  while (!done && poll(&readable, 1, -1) > 0)
+  {
+    peer.Update();
+    if ((readable.revents & (POLLHUP | POLLERR)) != 0)
+    {
+      return;
+    }
+  }
+}
+
+uint32_t wrongReplies = 0;
+uint32_t replies = 0;
+
+MESSAGE_INTF::Task roundTrips(Executor &executor, Link &link, int32_t count)
+{
+  for (int32_t i = 0; i < count; i++)
+  {
+    link.Send(1, i);
+    MESSAGE_INTF::Frame<8> reply = co_await executor.Next(&link, 2, 1000);
+    if (reply.populatedArgs != 2 || reply.args[1] != i)
+    {
+      wrongReplies++;
+    }
+    replies++;
+  }
+}
+
+MESSAGE_INTF::Task burst(Executor &executor, Link &link, int32_t count)
+{
+  // every request goes out before the first reply is awaited
+  for (int32_t i = 0; i < count; i++)
+  {
+    link.Send(1, i);
+  }
+  for (int32_t i = 0; i < count; i++)
+  {
+    MESSAGE_INTF::Frame<8> reply = co_await executor.Next(&link, 2, 1000);
+    if (reply.populatedArgs != 2 || reply.args[1] != i)
+    {
+      wrongReplies++;
+    }
+    replies++;
+  }
+}
+
+int32_t order[2];
+uint32_t orderCount = 0;
+
+MESSAGE_INTF::Task waitOnce(Executor &executor, Link &link, int32_t id)
+{
+  MESSAGE_INTF::Frame<8> reply = co_await executor.Next(&link, 2, 1000);
+  order[orderCount++] = id * 100 + reply.args[1];
+}
+
+uint32_t timeouts = 0;
+
+MESSAGE_INTF::Task waitForNothing(Executor &executor, Link &link)
+{
+  MESSAGE_INTF::Frame<8> frame = co_await executor.Next(&link, 77, 50);
+  if (frame.populatedArgs == 0)
+  {
+    timeouts++;
+  }
+}
+
+uint32_t guardsAlive = 0;
+
+/**
+ * @brief Lives in the frame of a coroutine, so it shows when that is freed
+ */
+struct Guard
+{
+  Guard()
+  {
+    guardsAlive++;
+  }
+  ~Guard()
+  {
+    guardsAlive--;
+  }
+};
+
+MESSAGE_INTF::Task waitForever(Executor &executor, Link &link)
+{
+  Guard guard;
+  co_await executor.Next(&link, 78);
+}
+
+void checkRoundTrips(Link &link, int fd)
+{
+  Executor executor;
+  CHECK(executor.Register(&link, fd));
+  CHECK(!executor.Register(&link, fd));
+  replies = 0;
+  roundTrips(executor, link, 2000);
+  executor.Run();
+  CHECK(replies == 2000);
+
+  replies = 0;
+  burst(executor, link, 200);
+  executor.Run();
+  CHECK(replies == 200);
+  CHECK(wrongReplies == 0);
+  CHECK(executor.GetWaitingCount() == 0);
+}
+
+void checkWaitOrder(Link &link, int fd)
+{
+  Executor executor;
+  CHECK(executor.Register(&link, fd));
+  orderCount = 0;
+  waitOnce(executor, link, 1);
+  waitOnce(executor, link, 2);
+  CHECK(executor.GetWaitingCount() == 2);
+  link.Send(1, 5);
+  link.Send(1, 6);
+  executor.Run();
+  CHECK(orderCount == 2);
+  CHECK(order[0] == 105);
+  CHECK(order[1] == 206);
+}
+
+void checkTimeout(Link &link, int fd)
+{
+  Executor executor;
+  CHECK(executor.Register(&link, fd));
+  timeouts = 0;
+  Clock::time_point start = Clock::now();
+  waitForNothing(executor, link);
+  executor.Run();
+  double ms =
+    std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  CHECK(timeouts == 1);
+  CHECK(ms >= 50);
+  CHECK(ms < 1000);
+}
+
+void checkUnawaitedFrames(Link &link, int fd)
+{
+  Executor executor;
+  CHECK(executor.Register(&link, fd));
+  link.Send(1, 42);
+  for (uint32_t i = 0; i < 100 && link.GetQueuedFrames() == 0; i++)
+  {
+    executor.RunOnce(10);
+  }
+  MESSAGE_INTF::Frame<8> frame{};
+  CHECK(link.PopFrame(frame));
+  CHECK(frame.args[0] == 2);
+  CHECK(frame.args[1] == 42);
+}
+
+void checkLeftoverWaits(Link &link, int fd)
+{
+  {
+    Executor executor;
+    CHECK(executor.Register(&link, fd));
+    waitForever(executor, link);
+    waitForever(executor, link);
+    CHECK(guardsAlive == 2);
+    CHECK(executor.GetWaitingCount() == 2);
+  }
+  CHECK(guardsAlive == 0);
+}
+} // namespace
+
+int main()
+{
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+  {
+    std::printf("socketpair() failed\n");
+    return 1;
+  }
+  std::thread peer(echo, fds[1]);
+  Link link(fds[0]);
+  link.Init(0);
+
+  checkRoundTrips(link, fds[0]);
+  checkWaitOrder(link, fds[0]);
+  checkTimeout(link, fds[0]);
+  checkUnawaitedFrames(link, fds[0]);
+  checkLeftoverWaits(link, fds[0]);
+
+  link.Send(9);
+  peer.join();
+  close(fds[0]);
+  close(fds[1]);
+  return CheckFailures();
+}
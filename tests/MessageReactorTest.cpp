@@ -0,0 +1,219 @@
+/**
+ * @file MessageReactorTest.cpp
+ * @brief Runs 32 socketpair links on 4 reactor threads and checks that every
+ * frame reaches its link once and in order, and that no link is updated by
+ * two threads at once. Then checks that a link whose queue is full and whose
+ * policy stops reading is left alone until a frame is taken out, that it
+ * then parses the bytes it had already read, and that a peer closing its end
+ * marks the link as hung up.
+ */
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "Check.h"
+#include "FdMessage.h"
+#include "MessageReactor.h"
+
+namespace
+{
+using Link = FdMessage<64, 4, 2, 2>;
+using Clock = std::chrono::steady_clock;
+
+const uint32_t LINK_COUNT = 32;
+const uint32_t FRAME_COUNT = 2000;
+const int32_t FRAMES_STOPPED = 40;
+
+/**
+ * @brief One link with the counters its callback keeps
+ */
+struct Endpoint
+{
+  int fds[2]{-1, -1};
+  std::atomic<uint32_t> received{0};
+  uint32_t wrong{0};
+  std::atomic<uint32_t> busy{0};
+  std::atomic<uint32_t> overlaps{0};
+
+  bool OnFrame(const int32_t *args, uint32_t length)
+  {
+    // a second thread in here at the same time shows up as busy > 1
+    overlaps += busy.fetch_add(1) != 0 ? 1 : 0;
+    uint32_t count = received.load(std::memory_order_relaxed);
+    wrong += length == 2 && args[1] == static_cast<int32_t>(count) ? 0 : 1;
+    received.store(count + 1, std::memory_order_relaxed);
+    busy.fetch_sub(1);
+    return true;
+  }
+};
+
+/**
+ * @brief Waits until done() is true or a few seconds have passed
+ * @return what done() returned last
+ */
+template <typename DONE>
+bool waitFor(DONE done)
+{
+  Clock::time_point deadline = Clock::now() + std::chrono::seconds(10);
+  while (!done() && Clock::now() < deadline)
+  {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return done();
+}
+
+void checkManyLinks()
+{
+  std::array<Endpoint, LINK_COUNT> endpoints;
+  // the reactor keeps pointers to the links, so they never move
+  std::vector<Link> links;
+  links.reserve(LINK_COUNT);
+  MessageReactor<LINK_COUNT, 4> reactor;
+  for (Endpoint &endpoint : endpoints)
+  {
+    CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, endpoint.fds) == 0);
+    links.emplace_back(endpoint.fds[0]);
+    Link &link = links.back();
+    link.Init(0);
+    CHECK(link.RegisterCallback(
+      {1,
+       MESSAGE_INTF::CallbackDelegate::Bind<Endpoint, &Endpoint::OnFrame>(
+         &endpoint),
+       nullptr}));
+    CHECK(reactor.Register(&link, endpoint.fds[0]));
+  }
+  CHECK(reactor.GetLinkCount() == LINK_COUNT);
+  CHECK(reactor.Start(4));
+
+  // a batch per link per round, so every link is readable most of the time
+  for (uint32_t first = 0; first < FRAME_COUNT; first += 100)
+  {
+    std::string batch;
+    for (uint32_t i = first; i < first + 100; i++)
+    {
+      batch += "!1," + std::to_string(i) + ";";
+    }
+    for (Endpoint &endpoint : endpoints)
+    {
+      CHECK(
+        write(endpoint.fds[1], batch.data(), batch.size()) ==
+        static_cast<ssize_t>(batch.size()));
+    }
+  }
+  CHECK(waitFor(
+    [&endpoints]()
+    {
+      for (Endpoint &endpoint : endpoints)
+      {
+        if (endpoint.received.load() < FRAME_COUNT)
+        {
+          return false;
+        }
+      }
+      return true;
+    }));
+  reactor.Stop();
+
+  uint64_t cpuNs = 0;
+  for (uint32_t thread = 0; thread < 4; thread++)
+  {
+    cpuNs += reactor.GetThreadCpuNs(thread);
+  }
+  CHECK(cpuNs > 0);
+  for (uint32_t i = 0; i < LINK_COUNT; i++)
+  {
+    Endpoint &endpoint = endpoints[i];
+    MESSAGE_INTF::LinkStats stats = reactor.GetLinkStats(i);
+    CHECK(endpoint.received.load() == FRAME_COUNT);
+    CHECK(endpoint.wrong == 0);
+    CHECK(endpoint.overlaps.load() == 0);
+    CHECK(stats.updates > 0);
+    CHECK(stats.maxUpdateNs <= stats.totalUpdateNs);
+    CHECK(!stats.hungUp);
+    close(endpoint.fds[0]);
+    close(endpoint.fds[1]);
+  }
+}
+
+void checkStoppedReading()
+{
+  int fds[2];
+  CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+  Link link(fds[0]);
+  link.Init(0);
+  link.SetOverflowPolicy(MESSAGE_INTF::OVERFLOW_STOP_READING);
+  MessageReactor<1, 2> reactor;
+  CHECK(reactor.Register(&link, fds[0]));
+  CHECK(reactor.Start(2));
+
+  // no callbacks, so the 2 frame queue fills up while some of the bytes are
+  // read ahead into the link and more than a read's worth are still in the
+  // socket
+  std::string frames;
+  for (int32_t i = 0; i < FRAMES_STOPPED; i++)
+  {
+    frames += "!5," + std::to_string(i) + ";";
+  }
+  CHECK(
+    write(fds[1], frames.data(), frames.size()) ==
+    static_cast<ssize_t>(frames.size()));
+  CHECK(waitFor([&link]() { return link.IsReadingStopped(); }));
+
+  // the link stays readable, but nobody updates it while it is stopped
+  uint64_t updates = reactor.GetLinkStats(0).updates;
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  uint64_t idleUpdates = reactor.GetLinkStats(0).updates - updates;
+  std::printf(
+    "updates while stopped: %llu\n",
+    static_cast<unsigned long long>(idleUpdates));
+  CHECK(idleUpdates <= 1);
+
+  int32_t next = 0;
+  bool inOrder = true;
+  while (next < FRAMES_STOPPED && link.IsReadingStopped())
+  {
+    // taking a frame out hands the link back for exactly one Update()
+    updates = reactor.GetLinkStats(0).updates;
+    MESSAGE_INTF::Frame<4> frame{};
+    CHECK(link.PopFrame(frame));
+    inOrder &= frame.args[1] == next;
+    next++;
+    CHECK(waitFor([&]() { return reactor.GetLinkStats(0).updates > updates; }));
+  }
+  // the last frame doesn't fill the queue, so the reactor is idle again
+  MESSAGE_INTF::Frame<4> frame{};
+  while (link.PopFrame(frame))
+  {
+    inOrder &= frame.args[1] == next;
+    next++;
+  }
+  CHECK(next == FRAMES_STOPPED);
+  CHECK(inOrder);
+
+  // reading goes on normally once the queue has room
+  CHECK(write(fds[1], "!5,-1;", 6) == 6);
+  CHECK(waitFor([&link]() { return link.GetQueuedFrames() == 1; }));
+  CHECK(link.PopFrame(frame));
+  CHECK(frame.args[1] == -1);
+
+  close(fds[1]);
+  CHECK(waitFor([&reactor]() { return reactor.GetLinkStats(0).hungUp; }));
+  reactor.Stop();
+  close(fds[0]);
+}
+} // namespace
+
+int main()
+{
+  checkManyLinks();
+  checkStoppedReading();
+  return CheckFailures();
+}
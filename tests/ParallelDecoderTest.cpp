@@ -0,0 +1,200 @@
+/**
+ * @file ParallelDecoderTest.cpp
+ * @brief Checks ParallelDecoder against a FrameParser fed the same log in
+ * random pieces, for several dialects, noise rates, thread counts and chunk
+ * sizes. Every frame and the number of bytes consumed have to match. The
+ * logs also have long runs without an endMarker, which cover many chunks,
+ * and built with a small MESSAGE_PARALLEL_MAX_PIECE the frames longer than
+ * a piece take the splitting path.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Check.h"
+#include "ParallelDecoder.h"
+
+namespace
+{
+struct Frame
+{
+  std::vector<int32_t> args;
+  bool argOverflow;
+
+  bool operator==(const Frame &other) const
+  {
+    return args == other.args && argOverflow == other.argOverflow;
+  }
+};
+
+/**
+ * @brief The frames a Message object would get from log when it arrives a
+ * few bytes at a time
+ */
+template <typename DIALECT>
+std::vector<Frame> referenceFrames(const std::string &log, std::mt19937 &rng)
+{
+  FrameParser<64, 8, DIALECT> parser;
+  std::vector<Frame> frames;
+  std::uniform_int_distribution<uint32_t> pickPiece(1, 100);
+  size_t offset = 0;
+  while (offset < log.size())
+  {
+    uint32_t piece = pickPiece(rng);
+    if (piece > log.size() - offset)
+    {
+      piece = static_cast<uint32_t>(log.size() - offset);
+    }
+    uint32_t parsed = 0;
+    while (parsed < piece)
+    {
+      parsed += parser.Parse(log.data() + offset + parsed, piece - parsed);
+      if (parser.IsFrameComplete())
+      {
+        const int32_t *args = parser.GetArgs();
+        frames.push_back(Frame{
+          std::vector<int32_t>(args, args + parser.GetPopulatedArgs()),
+          parser.HasArgOverflow()});
+      }
+    }
+    offset += piece;
+  }
+  return frames;
+}
+
+/**
+ * @brief Encoded frames with odd bits mixed in: values too long for the
+ * buffer, spaces, junk between frames, long runs without an endMarker and
+ * bytes replaced at the rate noise
+ */
+template <typename DIALECT>
+std::string randomLog(uint32_t frameCount, double noise, std::mt19937 &rng)
+{
+  static const char ALPHABET[] = "0123456789,;!$|-+ *\n\rAEx.";
+  std::uniform_int_distribution<uint32_t> pick(0, 999);
+  std::uniform_real_distribution<double> chance(0, 1);
+  std::string log;
+  char encoded[256];
+  for (uint32_t frame = 0; frame < frameCount; frame++)
+  {
+    int32_t args[12];
+    uint32_t count = pick(rng) % 12;
+    for (uint32_t i = 0; i < count; i++)
+    {
+      args[i] = pick(rng) % 3 == 0
+                  ? static_cast<int32_t>(rng())
+                  : static_cast<int32_t>(pick(rng));
+    }
+    std::string text(
+      encoded, DIALECT::Encode(args, count, encoded, sizeof(encoded)));
+    uint32_t kind = pick(rng);
+    if (kind < 20)
+    {
+      text.insert(text.size() / 2, std::string(pick(rng) % 200, '7'));
+    }
+    else if (kind < 45 && text.size() > 2)
+    {
+      text.insert(1 + pick(rng) % (text.size() - 1), " ");
+    }
+    else if (kind < 60)
+    {
+      text += "junk";
+    }
+    else if (kind < 62)
+    {
+      // a run far longer than a chunk with no endMarker in it
+      text += DIALECT::startMarker;
+      text += std::string(1000 + pick(rng) * 20, '5');
+    }
+    log += text;
+  }
+  for (char &c : log)
+  {
+    if (chance(rng) < noise)
+    {
+      c = ALPHABET[pick(rng) % (sizeof(ALPHABET) - 1)];
+    }
+  }
+  // a frame that hasn't finished arriving
+  log += DIALECT::startMarker;
+  log += "1,2";
+  return log;
+}
+
+template <typename DIALECT>
+void checkDialect(const char *name, double noise, uint32_t seed)
+{
+  std::mt19937 rng(seed);
+  std::string log = randomLog<DIALECT>(3000, noise, rng);
+  std::vector<Frame> expected = referenceFrames<DIALECT>(log, rng);
+  uint64_t unfinished = log.size() - 4;
+
+  for (uint32_t threads : {1u, 2u, 3u, 8u})
+  {
+    for (uint32_t chunkSize : {1u, 7u, 64u, 1000u, 65536u, 1u << 24})
+    {
+      // a handoff per few bytes only shows how slow that is
+      if (threads > 1 && chunkSize < 64 / threads)
+      {
+        continue;
+      }
+      ParallelDecoder<64, 8, DIALECT> decoder(threads, chunkSize);
+      std::vector<Frame> frames;
+      uint64_t consumed = decoder.Decode(
+        log.data(),
+        log.size(),
+        [&frames](const int32_t *args, uint32_t populatedArgs, bool overflow) {
+          frames.push_back(Frame{
+            std::vector<int32_t>(args, args + populatedArgs), overflow});
+        });
+      bool match = frames == expected && consumed == unfinished;
+      if (!match)
+      {
+        std::printf(
+          "%s threads %u chunk %u: %zu frames, %zu expected, consumed %llu\n",
+          name,
+          static_cast<unsigned>(threads),
+          static_cast<unsigned>(chunkSize),
+          frames.size(),
+          expected.size(),
+          static_cast<unsigned long long>(consumed));
+      }
+      CHECK(match);
+    }
+  }
+  std::printf(
+    "%s, noise %g: %zu frames matched\n", name, noise, expected.size());
+}
+
+void checkEdges()
+{
+  ParallelDecoder<64, 8> decoder(4, 3);
+  uint32_t frames = 0;
+  auto count = [&frames](const int32_t *, uint32_t, bool) { frames++; };
+  CHECK(decoder.Decode("", 0, count) == 0);
+  CHECK(decoder.Decode(";;;;;;;", 7, count) == 7);
+  CHECK(frames == 0);
+  CHECK(decoder.Decode("!1;!2;!3;", 9, count) == 9);
+  CHECK(frames == 3);
+}
+} // namespace
+
+int main()
+{
+  std::printf(
+    "MESSAGE_PARALLEL_MAX_PIECE %llu\n",
+    static_cast<unsigned long long>(MESSAGE_PARALLEL_MAX_PIECE));
+  checkEdges();
+  uint32_t seed = 1;
+  for (double noise : {0.0, 0.001, 0.02})
+  {
+    checkDialect<MESSAGE_INTF::AsciiProtocol>("ascii", noise, seed++);
+    checkDialect<MESSAGE_INTF::CheckedAsciiProtocol>("checked", noise, seed++);
+    checkDialect<MESSAGE_INTF::AsciiDialect<'!', ';', ',', false, false>>(
+      "strict", noise, seed++);
+  }
+  return CheckFailures();
+}
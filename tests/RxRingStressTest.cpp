@@ -0,0 +1,258 @@
+/**
+ * @file RxRingStressTest.cpp
+ * @brief Runs a producer thread against the RxRing consumer the way a UART
+ * interrupt runs against the main loop. Every byte the producer managed to
+ * push has to come out once and in order, every byte it couldn't push has to
+ * be counted as dropped, and RingMessage has to deliver the frames in order.
+ *
+ * Usage: RxRingStressTest [baud] [frames]
+ * A baud of 0 pushes as fast as the producer can.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+
+#include "Check.h"
+#include "RingMessage.h"
+#include "RxRing.h"
+
+namespace
+{
+using Clock = std::chrono::steady_clock;
+
+/**
+ * @brief The byte at position of the stream the producer pushes
+ */
+char patternByte(uint64_t position)
+{
+  return static_cast<char>(position % 251);
+}
+
+/**
+ * @brief Pushes bytes of the pattern as fast as it can, with Push() or with
+ * WriteSpan()/CommitWrite() like a DMA transfer, and checks them on the way
+ * out with Pop() or ReadSpan()/Consume()
+ */
+template <uint32_t SIZE>
+void checkRawRing(bool dma, uint64_t total)
+{
+  StaticRxRing<SIZE> ring;
+  std::atomic<bool> done{false};
+  uint64_t attempted = 0;
+  uint64_t pushed = 0;
+
+  std::thread producer([&] {
+    std::mt19937 rng(dma ? 2 : 1);
+    char chunk[SIZE * 2];
+    while (attempted < total)
+    {
+      uint32_t length = 1 + rng() % (SIZE * 2);
+      uint64_t before = pushed;
+      if (dma)
+      {
+        // write into the ring directly, what doesn't fit is lost like a
+        // transfer that completed into its own buffer
+        uint32_t room;
+        char *span = ring.WriteSpan(room);
+        uint32_t count = room < length ? room : length;
+        for (uint32_t i = 0; i < count; i++)
+        {
+          span[i] = patternByte(pushed + i);
+        }
+        ring.CommitWrite(count);
+        ring.CountDropped(length - count);
+        pushed += count;
+      }
+      else
+      {
+        for (uint32_t i = 0; i < length; i++)
+        {
+          chunk[i] = patternByte(pushed + i);
+        }
+        pushed += ring.Push(chunk, length);
+      }
+      attempted += length;
+      // let the consumer catch up now and then, with one CPU it would
+      // otherwise only run once the producer is done
+      if (pushed - before < length && rng() % 4 != 0)
+      {
+        std::this_thread::yield();
+      }
+    }
+    done.store(true, std::memory_order_release);
+  });
+
+  std::mt19937 rng(3);
+  uint64_t received = 0;
+  uint64_t mismatches = 0;
+  char buffer[SIZE];
+  for (;;)
+  {
+    bool finished = done.load(std::memory_order_acquire);
+    uint32_t count;
+    if (rng() % 2 == 0)
+    {
+      count = ring.Pop(buffer, 1 + rng() % SIZE);
+      for (uint32_t i = 0; i < count; i++)
+      {
+        mismatches += buffer[i] != patternByte(received + i) ? 1 : 0;
+      }
+    }
+    else
+    {
+      const char *span = ring.ReadSpan(count);
+      for (uint32_t i = 0; i < count; i++)
+      {
+        mismatches += span[i] != patternByte(received + i) ? 1 : 0;
+      }
+      ring.Consume(count);
+    }
+    received += count;
+    if (finished && ring.Available() == 0)
+    {
+      break;
+    }
+    if (count == 0)
+    {
+      std::this_thread::yield();
+    }
+  }
+  producer.join();
+
+  CHECK(mismatches == 0);
+  CHECK(received == pushed);
+  CHECK(attempted - pushed == ring.GetDropped());
+  CHECK(ring.GetHighWater() <= SIZE);
+  std::printf(
+    "%s ring of %u: %llu bytes pushed, %u dropped, high water %u\n",
+    dma ? "DMA" : "Push",
+    static_cast<unsigned>(SIZE),
+    static_cast<unsigned long long>(pushed),
+    static_cast<unsigned>(ring.GetDropped()),
+    static_cast<unsigned>(ring.GetHighWater()));
+}
+
+uint32_t nextSequence = 0;
+uint32_t framesReceived = 0;
+uint32_t framesCorrupt = 0;
+uint32_t framesOutOfOrder = 0;
+
+bool onFrame(const int32_t *args, uint32_t length)
+{
+  // !1,sequence,~sequence; so a frame that lost bytes in the middle shows
+  if (length != 3 || args[2] != ~args[1])
+  {
+    framesCorrupt++;
+    return true;
+  }
+  uint32_t sequence = static_cast<uint32_t>(args[1]);
+  if (sequence < nextSequence)
+  {
+    framesOutOfOrder++;
+  }
+  nextSequence = sequence + 1;
+  framesReceived++;
+  return true;
+}
+
+/**
+ * @brief Feeds frames through a RingMessage, with the producer pushing a
+ * 16 byte FIFO's worth at a time paced to baud
+ */
+void checkRingMessage(uint32_t baud, uint32_t frameCount)
+{
+  StaticRxRing<1024> ring;
+  RingMessage<64, 4, 2> message(&ring);
+  CHECK(message.RegisterCallback({1, onFrame, nullptr}));
+  nextSequence = 0;
+  framesReceived = 0;
+  framesCorrupt = 0;
+  framesOutOfOrder = 0;
+
+  std::atomic<bool> done{false};
+  std::thread producer([&] {
+    std::string stream;
+    for (uint32_t i = 0; i < frameCount; i++)
+    {
+      stream += "!1," + std::to_string(static_cast<int32_t>(i)) + "," +
+                std::to_string(~static_cast<int32_t>(i)) + ";";
+    }
+    // one start bit, eight data bits and one stop bit per byte
+    double bytesPerSecond = baud / 10.0;
+    Clock::time_point start = Clock::now();
+    for (size_t offset = 0; offset < stream.size(); offset += 16)
+    {
+      if (baud != 0)
+      {
+        std::this_thread::sleep_until(
+          start + std::chrono::duration_cast<Clock::duration>(
+                    std::chrono::duration<double>(offset / bytesPerSecond)));
+      }
+      size_t length = stream.size() - offset;
+      length = length < 16 ? length : 16;
+      if (ring.Push(stream.data() + offset, length) < length)
+      {
+        std::this_thread::yield();
+      }
+    }
+    done.store(true, std::memory_order_release);
+  });
+
+  for (;;)
+  {
+    bool finished = done.load(std::memory_order_acquire);
+    message.Update();
+    if (finished && ring.Available() == 0)
+    {
+      break;
+    }
+    std::this_thread::yield();
+  }
+  producer.join();
+
+  // bytes are only ever lost when the ring is full, and then counted
+  CHECK(framesOutOfOrder == 0);
+  if (ring.GetDropped() == 0)
+  {
+    CHECK(framesReceived == frameCount);
+    CHECK(framesCorrupt == 0);
+  }
+  else
+  {
+    CHECK(framesReceived < frameCount);
+  }
+  std::printf(
+    "RingMessage at %u baud: %u of %u frames, %u corrupt, %u bytes "
+    "dropped, high water %u\n",
+    static_cast<unsigned>(baud),
+    static_cast<unsigned>(framesReceived),
+    static_cast<unsigned>(frameCount),
+    static_cast<unsigned>(framesCorrupt),
+    static_cast<unsigned>(ring.GetDropped()),
+    static_cast<unsigned>(ring.GetHighWater()));
+}
+} // namespace
+
+int main(int argc, char **argv)
+{
+  if (argc > 1)
+  {
+    uint32_t baud = std::strtoul(argv[1], nullptr, 10);
+    uint32_t frames = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 20000;
+    checkRingMessage(baud, frames);
+    return CheckFailures();
+  }
+
+  checkRawRing<64>(false, 4000000);
+  checkRawRing<64>(true, 4000000);
+  checkRawRing<4096>(false, 20000000);
+  checkRingMessage(2000000, 20000);
+  checkRingMessage(0, 100000);
+  return CheckFailures();
+}
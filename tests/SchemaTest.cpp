@@ -0,0 +1,149 @@
+/**
+ * @file SchemaTest.cpp
+ * @brief Checks that schema fields are converted from the text of live ASCII
+ * frames, from the bits of binary frames, that an int32_t field refuses a
+ * value that doesn't fit instead of taking the clamped arg, and that wide
+ * fields refuse the clamped args of a queued ASCII frame instead of returning
+ * garbage.
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+
+#include "BinaryFrameParser.h"
+#include "BufferMessage.h"
+#include "Check.h"
+#include "Schema.h"
+
+namespace
+{
+using Sensor = MESSAGE_INTF::
+  Schema<5, float, MESSAGE_INTF::Fixed<16>, int64_t, uint32_t, int16_t>;
+
+Sensor::Fields received;
+uint32_t receivedCount = 0;
+
+bool onSensor(const Sensor::Fields &fields)
+{
+  received = fields;
+  receivedCount++;
+  return true;
+}
+
+void checkLiveAsciiFrame()
+{
+  static const char input[] = "!5,1.5,-2.25,9000000000,4000000000,-7;";
+  BufferMessage<64, 8, 2> message;
+  CHECK(message.RegisterCallback(Sensor::Bind<onSensor>()));
+  message.SetInput(input, sizeof(input) - 1);
+  receivedCount = 0;
+  message.Update();
+  CHECK(receivedCount == 1);
+  CHECK(std::get<0>(received) == 1.5f);
+  CHECK(std::get<1>(received).raw == -2 * 65536 - 16384);
+  CHECK(std::get<2>(received) == 9000000000LL);
+  CHECK(std::get<3>(received) == 4000000000u);
+  CHECK(std::get<4>(received) == -7);
+}
+
+using Counter = MESSAGE_INTF::Schema<42, int32_t>;
+
+int32_t counter = 0;
+uint32_t counterCount = 0;
+
+bool onCounter(const Counter::Fields &fields)
+{
+  counter = std::get<0>(fields);
+  counterCount++;
+  return true;
+}
+
+void checkInt32Overflow()
+{
+  static const char input[] =
+    "!42,9999999999;!42,-2147483649;!42,2147483647;!42,-2147483648;!42,7;";
+  BufferMessage<64, 8, 2> message;
+  CHECK(message.RegisterCallback(Counter::Bind<onCounter>()));
+  message.SetInput(input, sizeof(input) - 1);
+  counterCount = 0;
+  while (message.GetRemainingInput() > 0)
+  {
+    message.Update();
+  }
+  // the first two are clamped by the parser, and are turned away
+  CHECK(counterCount == 3);
+  CHECK(counter == 7);
+}
+
+void checkQueuedAsciiFrame()
+{
+  // with no callback the frame waits in the queue without its text, and its
+  // int64_t and uint32_t args have been clamped to INT32_MAX
+  static const char input[] = "!5,1.5,-2.25,9000000000,4000000000,-7;";
+  BufferMessage<64, 8, 2, 2> message;
+  message.SetInput(input, sizeof(input) - 1);
+  message.Update();
+  MESSAGE_INTF::Frame<8> frame;
+  CHECK(message.PopFrame(frame));
+  CHECK(frame.args[3] == INT32_MAX);
+
+  Sensor::Fields fields;
+  CHECK(!Sensor::Decode(frame.args.data(), frame.populatedArgs, fields));
+
+  // narrow fields only need the args, which can't tell a clamped value from
+  // INT32_MAX once the text is gone
+  using Narrow =
+    MESSAGE_INTF::Schema<5, int32_t, int32_t, int32_t, int32_t, int32_t>;
+  Narrow::Fields narrow;
+  CHECK(Narrow::Decode(frame.args.data(), frame.populatedArgs, narrow));
+  CHECK(std::get<0>(narrow) == 1);
+}
+
+void checkBinaryFrame()
+{
+  // a binary sender puts the bits of the float and the raw Fixed in the args
+  float value = -0.375f;
+  int32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  int32_t args[] = {5, bits, 3 * 65536, -123456, -1, 300};
+
+  char wire[64];
+  BufferMessage<64, 8, 2, 1, MESSAGE_INTF::BinaryProtocol> sender;
+  sender.SetOutput(wire, sizeof(wire));
+  CHECK(sender.Send(args, 6));
+
+  BufferMessage<64, 8, 2, 2, MESSAGE_INTF::BinaryProtocol> live;
+  CHECK(live.RegisterCallback(Sensor::Bind<onSensor>()));
+  live.SetInput(wire, sender.GetOutputLength());
+  receivedCount = 0;
+  live.Update();
+  CHECK(receivedCount == 1);
+  CHECK(std::get<0>(received) == -0.375f);
+  CHECK(std::get<1>(received).raw == 3 * 65536);
+  CHECK(std::get<2>(received) == -123456);
+  CHECK(std::get<3>(received) == 0xFFFFFFFFu);
+  CHECK(std::get<4>(received) == 300);
+
+  // a queued binary frame decodes once the caller says its args are raw
+  BufferMessage<64, 8, 2, 2, MESSAGE_INTF::BinaryProtocol> queued;
+  queued.SetInput(wire, sender.GetOutputLength());
+  queued.Update();
+  MESSAGE_INTF::Frame<8> frame;
+  CHECK(queued.PopFrame(frame));
+  Sensor::Fields fields;
+  CHECK(!Sensor::Decode(frame.args.data(), frame.populatedArgs, fields));
+  CHECK(Sensor::Decode(frame.args.data(), frame.populatedArgs, fields, true));
+  CHECK(std::get<0>(fields) == -0.375f);
+  CHECK(std::get<3>(fields) == 0xFFFFFFFFu);
+}
+} // namespace
+
+int main()
+{
+  checkLiveAsciiFrame();
+  checkInt32Overflow();
+  checkQueuedAsciiFrame();
+  checkBinaryFrame();
+  return CheckFailures();
+}
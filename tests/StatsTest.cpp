@@ -0,0 +1,159 @@
+/**
+ * @file StatsTest.cpp
+ * @brief Feeds BufferMessage input whose every garbage byte, bad token,
+ * oversized frame, full queue and checksum failure is known, and checks
+ * that GetStats() counts exactly those. Built with MESSAGE_ENABLE_STATS.
+ */
+
+#include <cstdint>
+#include <string>
+
+#include "BufferMessage.h"
+#include "Check.h"
+
+#ifndef MESSAGE_ENABLE_STATS
+#error "StatsTest has to be built with -DMESSAGE_ENABLE_STATS"
+#endif
+
+namespace
+{
+/**
+ * @brief Parses all of input
+ */
+template <typename MESSAGE>
+void feed(MESSAGE &message, const std::string &input)
+{
+  message.SetInput(input.data(), static_cast<uint32_t>(input.size()));
+  while (message.GetRemainingInput() > 0)
+  {
+    message.Update();
+  }
+}
+
+bool handled(const int32_t *, uint32_t)
+{
+  return true;
+}
+
+void checkGarbage()
+{
+  BufferMessage<32, 3, 2, 4> message;
+  CHECK(message.RegisterCallback({1, handled, nullptr}));
+  feed(
+    message,
+    // 3 bytes before the frame
+    "xyz!1,2;"
+    // 4 more, and a non-numeric arg
+    "ab\r\n!1,q,3;"
+    // a sign without digits
+    "!1,-;"
+    // 2 more, and a value that is clamped
+    "  !1,99999999999;"
+    // 5 args, 3 are kept, and nobody handles ID 2
+    "!2,5,6,7,8;"
+    // 35 bytes of text, the 31 that are kept end in a clamped value
+    "!1,2,3456789012345678901234567890123;"
+    // 8 more
+    "trailing");
+  MESSAGE_INTF::Stats stats = message.GetStats();
+  CHECK(stats.framesCompleted == 6);
+  CHECK(stats.bytesDiscarded == 3 + 4 + 2 + 4 + 8);
+  CHECK(stats.parseErrors == 2);
+  CHECK(stats.valueOverflows == 2);
+  CHECK(stats.argOverflows == 1);
+  CHECK(stats.truncatedFrames == 1);
+  CHECK(stats.unmatchedIDs == 1);
+  CHECK(stats.framesQueued == 1);
+  CHECK(stats.checksumErrors == 0);
+
+  message.ResetStats();
+  stats = message.GetStats();
+  CHECK(stats.framesCompleted == 0);
+  CHECK(stats.bytesDiscarded == 0);
+  CHECK(stats.parseErrors == 0);
+}
+
+/**
+ * @brief Sends 5 frames nobody handles into a queue of 2 with policy
+ */
+MESSAGE_INTF::Stats overflow(
+  MESSAGE_INTF::OverflowPolicy policy,
+  const std::string &input)
+{
+  BufferMessage<32, 3, 1, 2> message;
+  message.SetOverflowPolicy(policy);
+  feed(message, input);
+  CHECK(message.GetQueuedFrames() == 2);
+  return message.GetStats();
+}
+
+void checkQueueFull()
+{
+  const std::string frames = "!7,0;!7,1;!7,2;!7,3;!7,4;";
+  MESSAGE_INTF::Stats stats =
+    overflow(MESSAGE_INTF::OVERFLOW_DROP_OLDEST, frames);
+  CHECK(stats.framesQueued == 5);
+  CHECK(stats.droppedOldest == 3);
+  CHECK(stats.droppedNewest == 0);
+  CHECK(stats.queueHighWater == 2);
+  CHECK(stats.unmatchedIDs == 5);
+
+  stats = overflow(MESSAGE_INTF::OVERFLOW_DROP_NEWEST, frames);
+  CHECK(stats.framesQueued == 2);
+  CHECK(stats.droppedOldest == 0);
+  CHECK(stats.droppedNewest == 3);
+
+  // 7,1 replaces 7,0, 7,2 replaces 7,1 and 8,1 replaces 8,0
+  stats = overflow(
+    MESSAGE_INTF::OVERFLOW_CONFLATE, "!7,0;!8,0;!7,1;!7,2;!8,1;");
+  CHECK(stats.conflatedFrames == 3);
+  CHECK(stats.droppedOldest == 0);
+  CHECK(stats.droppedNewest == 0);
+
+  BufferMessage<32, 3, 1, 2> stopped;
+  stopped.SetOverflowPolicy(MESSAGE_INTF::OVERFLOW_STOP_READING);
+  stopped.SetInput(frames.data(), static_cast<uint32_t>(frames.size()));
+  stopped.Update();
+  stopped.Update();
+  stopped.Update();
+  stats = stopped.GetStats();
+  CHECK(stopped.GetRemainingInput() == 15);
+  CHECK(stats.framesQueued == 2);
+  CHECK(stats.readStalls == 2);
+  CHECK(stats.droppedOldest == 0);
+  CHECK(stats.droppedNewest == 0);
+}
+
+void checkChecksums()
+{
+  using Checked = MESSAGE_INTF::CheckedAsciiProtocol;
+  char wire[64];
+  BufferMessage<32, 3, 1, 1, Checked> sender;
+  sender.SetOutput(wire, sizeof(wire));
+  CHECK(sender.Send(1, 25));
+  std::string good(wire, sender.GetOutputLength()); // !1,25*XX;
+
+  std::string corrupt = good;
+  corrupt[3] = '6';
+  const std::string unchecked = "!1,25;";
+  const std::string cut = "!1,2";
+
+  BufferMessage<32, 3, 1, 1, Checked> receiver;
+  CHECK(receiver.RegisterCallback({1, handled, nullptr}));
+  feed(receiver, good + corrupt + unchecked + cut + good);
+  MESSAGE_INTF::Stats stats = receiver.GetStats();
+  CHECK(stats.framesCompleted == 2);
+  CHECK(stats.checksumErrors == 2);
+  CHECK(stats.resyncs == 1);
+  CHECK(stats.bytesDiscarded == corrupt.size() + unchecked.size() + 4);
+  CHECK(stats.parseErrors == 0);
+}
+} // namespace
+
+int main()
+{
+  checkGarbage();
+  checkQueueFull();
+  checkChecksums();
+  return CheckFailures();
+}
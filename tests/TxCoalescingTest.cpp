@@ -0,0 +1,90 @@
+/**
+ * @file TxCoalescingTest.cpp
+ * @brief Checks that SetTxCoalescing() gathers sent frames until the buffer
+ * is full, the deadline passes or Flush() is called, and that a buffer
+ * without a clock is refused and leaves every frame going straight out.
+ */
+
+#include <cstdint>
+#include <cstring>
+
+#include "BufferMessage.h"
+#include "Check.h"
+
+namespace
+{
+uint32_t now = 0;
+
+uint32_t fakeMicros()
+{
+  return now;
+}
+
+void checkGathering()
+{
+  char wire[256];
+  char gathered[32];
+  BufferMessage<64, 8, 2> message;
+  message.SetOutput(wire, sizeof(wire));
+  now = 1000;
+  CHECK(message.SetTxCoalescing(gathered, sizeof(gathered), fakeMicros, 500));
+
+  // "!1,2;\r\n" style frames wait in the buffer
+  CHECK(message.Send(1, 2));
+  CHECK(message.Send(1, 3));
+  CHECK(message.GetOutputLength() == 0);
+
+  // until the oldest has waited the deadline
+  now += 499;
+  message.Update();
+  CHECK(message.GetOutputLength() == 0);
+  now += 1;
+  message.Update();
+  uint32_t written = message.GetOutputLength();
+  CHECK(written > 0);
+
+  // or the next frame doesn't fit
+  for (uint32_t i = 0; i < 8 && message.GetOutputLength() == written; i++)
+  {
+    CHECK(message.Send(1, 1000 + i));
+  }
+  CHECK(message.GetOutputLength() > written);
+
+  // or Flush() is called
+  written = message.GetOutputLength();
+  CHECK(message.Send(1, 4));
+  message.Flush();
+  CHECK(message.GetOutputLength() > written);
+  CHECK(memcmp(wire, "!1,2;", 5) == 0);
+}
+
+void checkNoClock()
+{
+  char wire[256];
+  char gathered[32];
+  BufferMessage<64, 8, 2> message;
+  message.SetOutput(wire, sizeof(wire));
+
+  // with no clock the deadline can't be kept, so nothing is gathered
+  CHECK(!message.SetTxCoalescing(gathered, sizeof(gathered), nullptr, 500));
+  CHECK(message.Send(1, 2));
+  uint32_t written = message.GetOutputLength();
+  CHECK(written > 0);
+  message.Update();
+  CHECK(message.Send(1, 3));
+  CHECK(message.GetOutputLength() > written);
+
+  // no buffer needs no clock
+  CHECK(message.SetTxCoalescing(nullptr, 0, nullptr, 0));
+  written = message.GetOutputLength();
+  CHECK(message.Send(1, 4));
+  CHECK(message.GetOutputLength() > written);
+}
+} // namespace
+
+int main()
+{
+  checkGathering();
+  checkNoClock();
+  return CheckFailures();
+}